@@ -48,6 +48,7 @@ int dll_trap_SysFlashWindow;
 int dll_trap_CommandComplete;
 int dll_trap_CmdBackup_Ext;
 int dll_trap_MatchPaused;
+int dll_trap_Cvar_GetModified;
 
 /**
  * @brief This is the only way control passes into the module.
@@ -699,8 +700,9 @@ static cvarTable_t cvarTable[] =
 	{ &cg_commandMapTime,                     "cg_commandMapTime",                     "0",           CVAR_ARCHIVE,                 0 },
 };
 
-static const unsigned int cvarTableSize = sizeof(cvarTable) / sizeof(cvarTable[0]);
-static qboolean           cvarsLoaded   = qfalse;
+static const unsigned int cvarTableSize      = sizeof(cvarTable) / sizeof(cvarTable[0]);
+static qboolean           cvarsLoaded        = qfalse;
+static int                cvarChangeSequence = -1;  ///< position in the engine cvar change log, -1 updates the whole cvarTable
 void CG_setClientFlags(void);
 
 static qboolean CG_RegisterOrUpdateCvars(cvarTable_t *cv)
@@ -739,6 +741,8 @@ void CG_RegisterCvars(void)
 
 	CG_Printf("%d client cvars in use\n", cvarTableSize);
 
+	cvarChangeSequence = -1;
+
 	trap_Cvar_Set("cg_letterbox", "0");   // force this for people who might have it in their cfg
 
 	// custom fonts, register here since these are ETL-specific features
@@ -797,15 +801,24 @@ void CG_UpdateCvars(void)
 	unsigned int i;
 	qboolean     fSetFlags = qfalse;
 	cvarTable_t  *cv;
+	int          changed[MAX_CVAR_CHANGES];
+	int          numChanged;
 
 	if (!cvarsLoaded)
 	{
 		return;
 	}
 
+	// only look at the cvars changed since the last call
+	numChanged = trap_Cvar_GetModified(&cvarChangeSequence, changed, MAX_CVAR_CHANGES);
+	if (!numChanged)
+	{
+		return;
+	}
+
 	for (i = 0, cv = cvarTable ; i < cvarTableSize ; i++, cv++)
 	{
-		if (cv->vmCvar)
+		if (cv->vmCvar && Com_CvarModified(cv->vmCvar, changed, numChanged))
 		{
 			trap_Cvar_Update(cv->vmCvar);
 			if (cv->modificationCount != cv->vmCvar->modificationCount)
@@ -865,6 +878,7 @@ void CG_UpdateCvars(void)
 						// wait for the next frame, otherwise the hud load
 						// will erase the forced value
 						cv->modificationCount = -1;
+						cvarChangeSequence    = -1;
 					}
 					else
 					{
@@ -879,7 +893,7 @@ void CG_UpdateCvars(void)
 		}
 	}
 
-	if (cg.etLegacyClient)
+	if (cg.etLegacyClient && (Com_CvarModified(&cg_customFont1, changed, numChanged) || Com_CvarModified(&cg_customFont2, changed, numChanged)))
 	{
 		static int cg_customFont1_lastMod = 1;
 		static int cg_customFont2_lastMod = 1;
@@ -2885,6 +2899,7 @@ static ID_INLINE void CG_SetupExtensions(void)
 		CG_SetupExtensionTrap(value, MAX_CVAR_VALUE_STRING, &dll_trap_CommandComplete, "trap_CommandComplete_Legacy");
 		CG_SetupExtensionTrap(value, MAX_CVAR_VALUE_STRING, &dll_trap_CmdBackup_Ext, "trap_CmdBackup_Ext_Legacy");
 		CG_SetupExtensionTrap(value, MAX_CVAR_VALUE_STRING, &dll_trap_MatchPaused, "trap_MatchPaused_Legacy");
+		CG_SetupExtensionTrap(value, MAX_CVAR_VALUE_STRING, &dll_trap_Cvar_GetModified, "trap_Cvar_GetModified_Legacy");
 	}
 }
 
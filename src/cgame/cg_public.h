@@ -290,6 +290,7 @@ typedef enum
 	CG_CMDBACKUP_EXT,
 	CG_MATCHPAUSED,
 
+	CG_CVAR_GETMODIFIED,
 } cgameImport_t;
 
 /**
@@ -1983,3 +1983,21 @@ void trap_MatchPaused(qboolean matchPaused)
 		SystemCall(dll_trap_MatchPaused, matchPaused);
 	}
 }
+
+/**
+ * @brief Extension for listing the cvars changed since the last call,
+ * so that not every registered cvar has to be updated each frame
+ * @param[in,out] sequence
+ * @param[out] handles
+ * @param[in] maxHandles
+ * @return Number of changed cvar handles, -1 if all cvars have to be updated
+ */
+int trap_Cvar_GetModified(int *sequence, int *handles, int maxHandles)
+{
+	if (dll_trap_Cvar_GetModified)
+	{
+		return (int)SystemCall(dll_trap_Cvar_GetModified, sequence, handles, maxHandles);
+	}
+
+	return -1;
+}
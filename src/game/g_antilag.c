@@ -119,72 +119,158 @@ static qboolean G_AntilagSafe(gentity_t *ent)
 }
 
 /**
- * @brief Store client entity's position and other related data which is required to shift time (B2TF)
- * @param[in,out] ent target client entity
+ * @brief Store the part of a client's state that is restored from the closest marker
+ * @param[in] ent client entity
+ * @param[in] eFlags entity flags to store
+ * @param[out] pose
  */
-void G_StoreClientPosition(gentity_t *ent)
+static void G_StoreMarkerPose(gentity_t *ent, int eFlags, clientMarkerPose_t *pose)
 {
-	int top;
+	pose->eFlags          = eFlags;
+	pose->pm_flags        = ent->client->ps.pm_flags;
+	pose->viewheight      = ent->client->ps.viewheight;
+	pose->groundEntityNum = ent->client->ps.groundEntityNum;
 
-	if (!G_AntilagSafe(ent))
+	// Torso Markers
+	pose->torsoOldFrameModel     = ent->torsoFrame.oldFrameModel;
+	pose->torsoFrameModel        = ent->torsoFrame.frameModel;
+	pose->torsoOldFrame          = ent->torsoFrame.oldFrame;
+	pose->torsoFrame             = ent->torsoFrame.frame;
+	pose->torsoOldFrameTime      = ent->torsoFrame.oldFrameTime;
+	pose->torsoFrameTime         = ent->torsoFrame.frameTime;
+	pose->torsoYawAngle          = ent->torsoFrame.yawAngle;
+	pose->torsoPitchAngle        = ent->torsoFrame.pitchAngle;
+	pose->torsoYawing            = ent->torsoFrame.yawing;
+	pose->torsoPitching          = ent->torsoFrame.pitching;
+	pose->torsoAnimationMovetype = ent->torsoFrame.animation ? ent->torsoFrame.animation->movetype : 0;
+
+	// Legs Markers
+	pose->legsOldFrameModel     = ent->legsFrame.oldFrameModel;
+	pose->legsFrameModel        = ent->legsFrame.frameModel;
+	pose->legsOldFrame          = ent->legsFrame.oldFrame;
+	pose->legsFrame             = ent->legsFrame.frame;
+	pose->legsOldFrameTime      = ent->legsFrame.oldFrameTime;
+	pose->legsFrameTime         = ent->legsFrame.frameTime;
+	pose->legsYawAngle          = ent->legsFrame.yawAngle;
+	pose->legsPitchAngle        = ent->legsFrame.pitchAngle;
+	pose->legsYawing            = ent->legsFrame.yawing;
+	pose->legsPitching          = ent->legsFrame.pitching;
+	pose->legsAnimationMovetype = ent->legsFrame.animation ? ent->legsFrame.animation->movetype : 0;
+}
+
+/**
+ * @brief Apply a stored pose to a client
+ * @param[in,out] ent client entity
+ * @param[in] pose
+ */
+static void G_RestoreMarkerPose(gentity_t *ent, const clientMarkerPose_t *pose)
+{
+	ent->client->ps.eFlags          = pose->eFlags;
+	ent->client->ps.pm_flags        = pose->pm_flags;
+	ent->client->ps.viewheight      = pose->viewheight;
+	ent->client->ps.groundEntityNum = pose->groundEntityNum;
+
+	// Torso Markers
+	ent->torsoFrame.oldFrameModel = pose->torsoOldFrameModel;
+	ent->torsoFrame.frameModel    = pose->torsoFrameModel;
+	ent->torsoFrame.oldFrame      = pose->torsoOldFrame;
+	ent->torsoFrame.frame         = pose->torsoFrame;
+	ent->torsoFrame.oldFrameTime  = pose->torsoOldFrameTime;
+	ent->torsoFrame.frameTime     = pose->torsoFrameTime;
+	ent->torsoFrame.yawAngle      = pose->torsoYawAngle;
+	ent->torsoFrame.pitchAngle    = pose->torsoPitchAngle;
+	ent->torsoFrame.yawing        = pose->torsoYawing;
+	ent->torsoFrame.pitching      = pose->torsoPitching;
+	if (pose->torsoAnimationMovetype && ent->torsoFrame.animation)
 	{
-		return;
+		ent->torsoFrame.animation->movetype = pose->torsoAnimationMovetype;
 	}
 
-	ent->client->topMarker++;
-	if (ent->client->topMarker >= MAX_CLIENT_MARKERS)
+	// Legs Markers
+	ent->legsFrame.oldFrameModel = pose->legsOldFrameModel;
+	ent->legsFrame.frameModel    = pose->legsFrameModel;
+	ent->legsFrame.oldFrame      = pose->legsOldFrame;
+	ent->legsFrame.frame         = pose->legsFrame;
+	ent->legsFrame.oldFrameTime  = pose->legsOldFrameTime;
+	ent->legsFrame.frameTime     = pose->legsFrameTime;
+	ent->legsFrame.yawAngle      = pose->legsYawAngle;
+	ent->legsFrame.pitchAngle    = pose->legsPitchAngle;
+	ent->legsFrame.yawing        = pose->legsYawing;
+	ent->legsFrame.pitching      = pose->legsPitching;
+	if (pose->legsAnimationMovetype && ent->legsFrame.animation)
 	{
-		ent->client->topMarker = 0;
+		ent->legsFrame.animation->movetype = pose->legsAnimationMovetype;
 	}
+}
 
-	top = ent->client->topMarker;
+/**
+ * @brief Ring buffer slot of a marker
+ * @param[in] history
+ * @param[in] age 0 for the oldest marker, MAX_CLIENT_MARKERS - 1 for the newest
+ * @return
+ */
+static ID_INLINE int G_MarkerSlot(const clientMarkerHistory_t *history, int age)
+{
+	return (history->head + 1 + age) % MAX_CLIENT_MARKERS;
+}
 
-	VectorCopy(ent->r.mins, ent->client->clientMarkers[top].mins);
-	VectorCopy(ent->r.maxs, ent->client->clientMarkers[top].maxs);
-	VectorCopy(ent->s.pos.trBase, ent->client->clientMarkers[top].origin);
-	ent->client->clientMarkers[top].time = level.time;
+/**
+ * @brief Binary search for the newest marker stored at or before "time"
+ * @param[in] history
+ * @param[in] time
+ * @return Age of the marker as used by G_MarkerSlot, -1 if all markers are newer
+ */
+static int G_FindMarker(const clientMarkerHistory_t *history, int time)
+{
+	int low   = 0;
+	int high  = MAX_CLIENT_MARKERS - 1;
+	int found = -1;
+	int mid;
 
-	// store all angles & frame info
+	while (low <= high)
+	{
+		mid = (low + high) >> 1;
 
-	VectorCopy(ent->s.apos.trBase, ent->client->clientMarkers[top].viewangles);
+		if (history->time[G_MarkerSlot(history, mid)] <= time)
+		{
+			found = mid;
+			low   = mid + 1;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
 
-	ent->client->clientMarkers[top].eFlags     = ent->s.eFlags;
-	ent->client->clientMarkers[top].pm_flags   = ent->client->ps.pm_flags;
-	ent->client->clientMarkers[top].viewheight = ent->client->ps.viewheight;
+	return found;
+}
 
-	ent->client->clientMarkers[top].groundEntityNum = ent->client->ps.groundEntityNum;
+/**
+ * @brief Store client entity's position and other related data which is required to shift time (B2TF)
+ * @param[in,out] ent target client entity
+ */
+void G_StoreClientPosition(gentity_t *ent)
+{
+	clientMarkerHistory_t *history;
+	int                   top;
 
-	// Torso Markers
-	ent->client->clientMarkers[top].torsoOldFrameModel = ent->torsoFrame.oldFrameModel;
-	ent->client->clientMarkers[top].torsoFrameModel    = ent->torsoFrame.frameModel;
-	ent->client->clientMarkers[top].torsoOldFrame      = ent->torsoFrame.oldFrame;
-	ent->client->clientMarkers[top].torsoFrame         = ent->torsoFrame.frame;
-	ent->client->clientMarkers[top].torsoOldFrameTime  = ent->torsoFrame.oldFrameTime;
-	ent->client->clientMarkers[top].torsoFrameTime     = ent->torsoFrame.frameTime;
-	ent->client->clientMarkers[top].torsoYawAngle      = ent->torsoFrame.yawAngle;
-	ent->client->clientMarkers[top].torsoPitchAngle    = ent->torsoFrame.pitchAngle;
-	ent->client->clientMarkers[top].torsoYawing        = ent->torsoFrame.yawing;
-	ent->client->clientMarkers[top].torsoPitching      = ent->torsoFrame.pitching;
-	if (ent->torsoFrame.animation)
-	{
-		ent->client->clientMarkers[top].torsoAnimationMovetype = ent->torsoFrame.animation->movetype;
+	if (!G_AntilagSafe(ent))
+	{
+		return;
 	}
 
-	// Legs Markers
-	ent->client->clientMarkers[top].legsOldFrameModel = ent->legsFrame.oldFrameModel;
-	ent->client->clientMarkers[top].legsFrameModel    = ent->legsFrame.frameModel;
-	ent->client->clientMarkers[top].legsOldFrame      = ent->legsFrame.oldFrame;
-	ent->client->clientMarkers[top].legsFrame         = ent->legsFrame.frame;
-	ent->client->clientMarkers[top].legsOldFrameTime  = ent->legsFrame.oldFrameTime;
-	ent->client->clientMarkers[top].legsFrameTime     = ent->legsFrame.frameTime;
-	ent->client->clientMarkers[top].legsYawAngle      = ent->legsFrame.yawAngle;
-	ent->client->clientMarkers[top].legsPitchAngle    = ent->legsFrame.pitchAngle;
-	ent->client->clientMarkers[top].legsYawing        = ent->legsFrame.yawing;
-	ent->client->clientMarkers[top].legsPitching      = ent->legsFrame.pitching;
-	if (ent->legsFrame.animation)
-	{
-		ent->client->clientMarkers[top].legsAnimationMovetype = ent->legsFrame.animation->movetype;
-	}
+	history       = &ent->client->markers;
+	history->head = (history->head + 1) % MAX_CLIENT_MARKERS;
+	top           = history->head;
+
+	VectorCopy(ent->r.mins, history->mins[top]);
+	VectorCopy(ent->r.maxs, history->maxs[top]);
+	VectorCopy(ent->s.pos.trBase, history->origin[top]);
+	history->time[top] = level.time;
+
+	// store all angles & frame info
+	VectorCopy(ent->s.apos.trBase, history->viewangles[top]);
+	G_StoreMarkerPose(ent, ent->s.eFlags, &history->pose[top]);
 }
 
 /**
@@ -195,7 +281,8 @@ void G_StoreClientPosition(gentity_t *ent)
  */
 static qboolean G_AdjustSingleClientPosition(gentity_t *ent, int time)
 {
-	int i, j;
+	clientMarkerHistory_t *history;
+	int                   age, i, j;
 
 	if (time > level.time)
 	{
@@ -208,24 +295,10 @@ static qboolean G_AdjustSingleClientPosition(gentity_t *ent, int time)
 	}
 
 	// find a pair of markers which bound the requested time
-	i = j = ent->client->topMarker;
-	do
-	{
-		if (ent->client->clientMarkers[i].time <= time)
-		{
-			break;
-		}
-
-		j = i;
-		i--;
-		if (i < 0)
-		{
-			i = MAX_CLIENT_MARKERS - 1;
-		}
-	}
-	while (i != ent->client->topMarker);
+	history = &ent->client->markers;
+	age     = G_FindMarker(history, time);
 
-	if (i == j)     // oops, no valid stored markers
+	if (age == MAX_CLIENT_MARKERS - 1)     // oops, no valid stored markers
 	{
 		return qfalse;
 	}
@@ -239,245 +312,56 @@ static qboolean G_AdjustSingleClientPosition(gentity_t *ent, int time)
 
 		// Head, Legs
 		VectorCopy(ent->client->ps.viewangles, ent->client->backupMarker.viewangles);
-		ent->client->backupMarker.eFlags     = ent->client->ps.eFlags;
-		ent->client->backupMarker.pm_flags   = ent->client->ps.pm_flags;
-		ent->client->backupMarker.viewheight = ent->client->ps.viewheight;
+		G_StoreMarkerPose(ent, ent->client->ps.eFlags, &ent->client->backupMarker.pose);
 
 		ent->client->backupMarker.time = level.time;
-
-		ent->client->backupMarker.groundEntityNum = ent->client->ps.groundEntityNum;
-
-		// Torso Markers
-		ent->client->backupMarker.torsoOldFrameModel = ent->torsoFrame.oldFrameModel;
-		ent->client->backupMarker.torsoFrameModel    = ent->torsoFrame.frameModel;
-		ent->client->backupMarker.torsoOldFrame      = ent->torsoFrame.oldFrame;
-		ent->client->backupMarker.torsoFrame         = ent->torsoFrame.frame;
-		ent->client->backupMarker.torsoOldFrameTime  = ent->torsoFrame.oldFrameTime;
-		ent->client->backupMarker.torsoFrameTime     = ent->torsoFrame.frameTime;
-		ent->client->backupMarker.torsoYawAngle      = ent->torsoFrame.yawAngle;
-		ent->client->backupMarker.torsoPitchAngle    = ent->torsoFrame.pitchAngle;
-		ent->client->backupMarker.torsoYawing        = ent->torsoFrame.yawing;
-		ent->client->backupMarker.torsoPitching      = ent->torsoFrame.pitching;
-		if (ent->torsoFrame.animation)
-		{
-			ent->client->backupMarker.torsoAnimationMovetype = ent->torsoFrame.animation->movetype;
-		}
-
-		// Legs Markers
-		ent->client->backupMarker.legsOldFrameModel = ent->legsFrame.oldFrameModel;
-		ent->client->backupMarker.legsFrameModel    = ent->legsFrame.frameModel;
-		ent->client->backupMarker.legsOldFrame      = ent->legsFrame.oldFrame;
-		ent->client->backupMarker.legsFrame         = ent->legsFrame.frame;
-		ent->client->backupMarker.legsOldFrameTime  = ent->legsFrame.oldFrameTime;
-		ent->client->backupMarker.legsFrameTime     = ent->legsFrame.frameTime;
-		ent->client->backupMarker.legsYawAngle      = ent->legsFrame.yawAngle;
-		ent->client->backupMarker.legsPitchAngle    = ent->legsFrame.pitchAngle;
-		ent->client->backupMarker.legsYawing        = ent->legsFrame.yawing;
-		ent->client->backupMarker.legsPitching      = ent->legsFrame.pitching;
-		if (ent->legsFrame.animation)
-		{
-			ent->client->backupMarker.legsAnimationMovetype = ent->legsFrame.animation->movetype;
-		}
 	}
 
-	// if we haven't wrapped back to the head, we've sandwiched, so
+	// if the requested time isn't older than all markers, we've sandwiched, so
 	// we shift the client's position back to where he was at "time"
-	if (i != ent->client->topMarker)
+	if (age >= 0)
 	{
-		float frac = (float)(time - ent->client->clientMarkers[i].time) /
-		             (float)(ent->client->clientMarkers[j].time - ent->client->clientMarkers[i].time);
+		float frac;
+
+		i    = G_MarkerSlot(history, age);
+		j    = G_MarkerSlot(history, age + 1);
+		frac = (float)(time - history->time[i]) / (float)(history->time[j] - history->time[i]);
+
 		// Using TimeShiftLerp since it follows the client exactly meaning less roundoff error instead of LerpPosition()
-		TimeShiftLerp(
-			ent->client->clientMarkers[i].origin,
-			ent->client->clientMarkers[j].origin,
-			frac,
-			ent->r.currentOrigin);
-		TimeShiftLerp(
-			ent->client->clientMarkers[i].mins,
-			ent->client->clientMarkers[j].mins,
-			frac,
-			ent->r.mins);
-		TimeShiftLerp(
-			ent->client->clientMarkers[i].maxs,
-			ent->client->clientMarkers[j].maxs,
-			frac,
-			ent->r.maxs);
+		TimeShiftLerp(history->origin[i], history->origin[j], frac, ent->r.currentOrigin);
+		TimeShiftLerp(history->mins[i], history->mins[j], frac, ent->r.mins);
+		TimeShiftLerp(history->maxs[i], history->maxs[j], frac, ent->r.maxs);
 
 		// These are for Head / Legs
-		ent->client->ps.viewangles[0] = LerpAngle(
-			ent->client->clientMarkers[i].viewangles[0],
-			ent->client->clientMarkers[j].viewangles[0],
-			frac);
-		ent->client->ps.viewangles[1] = LerpAngle(
-			ent->client->clientMarkers[i].viewangles[1],
-			ent->client->clientMarkers[j].viewangles[1],
-			frac);
-		ent->client->ps.viewangles[2] = LerpAngle(
-			ent->client->clientMarkers[i].viewangles[2],
-			ent->client->clientMarkers[j].viewangles[2],
-			frac);
+		ent->client->ps.viewangles[0] = LerpAngle(history->viewangles[i][0], history->viewangles[j][0], frac);
+		ent->client->ps.viewangles[1] = LerpAngle(history->viewangles[i][1], history->viewangles[j][1], frac);
+		ent->client->ps.viewangles[2] = LerpAngle(history->viewangles[i][2], history->viewangles[j][2], frac);
+
 		// Set the ints to the closest ones in time since you can't lerp them.
-		if ((ent->client->clientMarkers[j].time - time) < (time - ent->client->clientMarkers[i].time))
+		if ((history->time[j] - time) < (time - history->time[i]))
 		{
-			ent->client->ps.eFlags     = ent->client->clientMarkers[j].eFlags;
-			ent->client->ps.pm_flags   = ent->client->clientMarkers[j].pm_flags;
-			ent->client->ps.viewheight = ent->client->clientMarkers[j].viewheight;
-
-			ent->client->ps.groundEntityNum = ent->client->clientMarkers[j].groundEntityNum;
-
-			// Torso Markers
-			ent->torsoFrame.oldFrameModel = ent->client->clientMarkers[j].torsoOldFrameModel;
-			ent->torsoFrame.frameModel    = ent->client->clientMarkers[j].torsoFrameModel;
-			ent->torsoFrame.oldFrame      = ent->client->clientMarkers[j].torsoOldFrame;
-			ent->torsoFrame.frame         = ent->client->clientMarkers[j].torsoFrame;
-			ent->torsoFrame.oldFrameTime  = ent->client->clientMarkers[j].torsoOldFrameTime;
-			ent->torsoFrame.frameTime     = ent->client->clientMarkers[j].torsoFrameTime;
-			ent->torsoFrame.yawAngle      = ent->client->clientMarkers[j].torsoYawAngle;
-			ent->torsoFrame.pitchAngle    = ent->client->clientMarkers[j].torsoPitchAngle;
-			ent->torsoFrame.yawing        = ent->client->clientMarkers[j].torsoYawing;
-			ent->torsoFrame.pitching      = ent->client->clientMarkers[j].torsoPitching;
-			if (ent->client->clientMarkers[j].torsoAnimationMovetype)
-			{
-				ent->torsoFrame.animation->movetype = ent->client->clientMarkers[j].torsoAnimationMovetype;
-			}
-
-			// Legs Markers
-			ent->legsFrame.oldFrameModel = ent->client->clientMarkers[j].legsOldFrameModel;
-			ent->legsFrame.frameModel    = ent->client->clientMarkers[j].legsFrameModel;
-			ent->legsFrame.oldFrame      = ent->client->clientMarkers[j].legsOldFrame;
-			ent->legsFrame.frame         = ent->client->clientMarkers[j].legsFrame;
-			ent->legsFrame.oldFrameTime  = ent->client->clientMarkers[j].legsOldFrameTime;
-			ent->legsFrame.frameTime     = ent->client->clientMarkers[j].legsFrameTime;
-			ent->legsFrame.yawAngle      = ent->client->clientMarkers[j].legsYawAngle;
-			ent->legsFrame.pitchAngle    = ent->client->clientMarkers[j].legsPitchAngle;
-			ent->legsFrame.yawing        = ent->client->clientMarkers[j].legsYawing;
-			ent->legsFrame.pitching      = ent->client->clientMarkers[j].legsPitching;
-			if (ent->client->clientMarkers[j].legsAnimationMovetype)
-			{
-				ent->legsFrame.animation->movetype = ent->client->clientMarkers[j].legsAnimationMovetype;
-			}
-
-			// time stamp for BuildHead/Leg
-			ent->timeShiftTime = ent->client->clientMarkers[j].time;
-
+			i = j;
 		}
-		else
-		{
-			ent->client->ps.eFlags     = ent->client->clientMarkers[i].eFlags;
-			ent->client->ps.pm_flags   = ent->client->clientMarkers[i].pm_flags;
-			ent->client->ps.viewheight = ent->client->clientMarkers[i].viewheight;
-
-			ent->client->ps.groundEntityNum = ent->client->clientMarkers[i].groundEntityNum;
-
-			// Torso Markers
-			ent->torsoFrame.oldFrameModel = ent->client->clientMarkers[i].torsoOldFrameModel;
-			ent->torsoFrame.frameModel    = ent->client->clientMarkers[i].torsoFrameModel;
-			ent->torsoFrame.oldFrame      = ent->client->clientMarkers[i].torsoOldFrame;
-			ent->torsoFrame.frame         = ent->client->clientMarkers[i].torsoFrame;
-			ent->torsoFrame.oldFrameTime  = ent->client->clientMarkers[i].torsoOldFrameTime;
-			ent->torsoFrame.frameTime     = ent->client->clientMarkers[i].torsoFrameTime;
-			ent->torsoFrame.yawAngle      = ent->client->clientMarkers[i].torsoYawAngle;
-			ent->torsoFrame.pitchAngle    = ent->client->clientMarkers[i].torsoPitchAngle;
-			ent->torsoFrame.yawing        = ent->client->clientMarkers[i].torsoYawing;
-			ent->torsoFrame.pitching      = ent->client->clientMarkers[i].torsoPitching;
-			if (ent->client->clientMarkers[i].torsoAnimationMovetype)
-			{
-				ent->torsoFrame.animation->movetype = ent->client->clientMarkers[i].torsoAnimationMovetype;
-			}
-
-			// Legs Markers
-			ent->legsFrame.oldFrameModel = ent->client->clientMarkers[i].legsOldFrameModel;
-			ent->legsFrame.frameModel    = ent->client->clientMarkers[i].legsFrameModel;
-			ent->legsFrame.oldFrame      = ent->client->clientMarkers[i].legsOldFrame;
-			ent->legsFrame.frame         = ent->client->clientMarkers[i].legsFrame;
-			ent->legsFrame.oldFrameTime  = ent->client->clientMarkers[i].legsOldFrameTime;
-			ent->legsFrame.frameTime     = ent->client->clientMarkers[i].legsFrameTime;
-			ent->legsFrame.yawAngle      = ent->client->clientMarkers[i].legsYawAngle;
-			ent->legsFrame.pitchAngle    = ent->client->clientMarkers[i].legsPitchAngle;
-			ent->legsFrame.yawing        = ent->client->clientMarkers[i].legsYawing;
-			ent->legsFrame.pitching      = ent->client->clientMarkers[i].legsPitching;
-			if (ent->client->clientMarkers[i].legsAnimationMovetype)
-			{
-				ent->legsFrame.animation->movetype = ent->client->clientMarkers[i].legsAnimationMovetype;
-			}
 
-			// time stamp for BuildHead/Leg
-			ent->timeShiftTime = ent->client->clientMarkers[i].time;
-		}
+		G_RestoreMarkerPose(ent, &history->pose[i]);
 
-		/* FIXME
-		if ( debugger && debugger->client) {
-		    // print some debugging stuff exactly like what the client does
-		    // it starts with "Rec:" to let you know it backward-reconciled
-		    char msg[2048];
-		    Com_sprintf( msg, sizeof(msg),
-		        "print \"^1Rec: time: %d, j: %d, k: %d, origin: %0.2f %0.2f %0.2f\n"
-		        "^2frac: %0.4f, origin1: %0.2f %0.2f %0.2f, origin2: %0.2f %0.2f %0.2f\n"
-		        "^7level.time: %d, est time: %d, level.time delta: %d, est real ping: %d\n\"",
-		        time, ent->client->clientMarkers[i].time, ent->client->clientMarkers[j].time,
-		        ent->r.currentOrigin[0], ent->r.currentOrigin[1], ent->r.currentOrigin[2],
-		        frac,
-		        ent->client->clientMarkers[i].origin[0],
-		        ent->client->clientMarkers[i].origin[1],
-		        ent->client->clientMarkers[i].origin[2],
-		        ent->client->clientMarkers[j].origin[0],
-		        ent->client->clientMarkers[j].origin[1],
-		        ent->client->clientMarkers[j].origin[2],
-		        level.time, level.time + debugger->client->frameOffset,
-		        level.time - time, level.time + debugger->client->frameOffset - time);
-
-		    trap_SendServerCommand( debugger - g_entities, msg );
-		}
-		*/
+		// time stamp for BuildHead/Leg
+		ent->timeShiftTime = history->time[i];
 	}
 	else
 	{
-		VectorCopy(ent->client->clientMarkers[j].origin, ent->r.currentOrigin);
-		VectorCopy(ent->client->clientMarkers[j].mins, ent->r.mins);
-		VectorCopy(ent->client->clientMarkers[j].maxs, ent->r.maxs);
+		j = G_MarkerSlot(history, 0);
 
-		// BuildHead/Legs uses these
-		VectorCopy(ent->client->clientMarkers[j].viewangles, ent->client->ps.viewangles);
-		ent->client->ps.eFlags     = ent->client->clientMarkers[j].eFlags;
-		ent->client->ps.pm_flags   = ent->client->clientMarkers[j].pm_flags;
-		ent->client->ps.viewheight = ent->client->clientMarkers[j].viewheight;
-
-		ent->client->ps.groundEntityNum = ent->client->clientMarkers[j].groundEntityNum;
-
-		// Torso Markers
-		ent->torsoFrame.oldFrameModel = ent->client->clientMarkers[j].torsoOldFrameModel;
-		ent->torsoFrame.frameModel    = ent->client->clientMarkers[j].torsoFrameModel;
-		ent->torsoFrame.oldFrame      = ent->client->clientMarkers[j].torsoOldFrame;
-		ent->torsoFrame.frame         = ent->client->clientMarkers[j].torsoFrame;
-		ent->torsoFrame.oldFrameTime  = ent->client->clientMarkers[j].torsoOldFrameTime;
-		ent->torsoFrame.frameTime     = ent->client->clientMarkers[j].torsoFrameTime;
-		ent->torsoFrame.yawAngle      = ent->client->clientMarkers[j].torsoYawAngle;
-		ent->torsoFrame.pitchAngle    = ent->client->clientMarkers[j].torsoPitchAngle;
-		ent->torsoFrame.yawing        = ent->client->clientMarkers[j].torsoYawing;
-		ent->torsoFrame.pitching      = ent->client->clientMarkers[j].torsoPitching;
-		if (ent->client->clientMarkers[j].torsoAnimationMovetype)
-		{
-			ent->torsoFrame.animation->movetype = ent->client->clientMarkers[j].torsoAnimationMovetype;
-		}
+		VectorCopy(history->origin[j], ent->r.currentOrigin);
+		VectorCopy(history->mins[j], ent->r.mins);
+		VectorCopy(history->maxs[j], ent->r.maxs);
 
-		// Legs Markers
-		ent->legsFrame.oldFrameModel = ent->client->clientMarkers[j].legsOldFrameModel;
-		ent->legsFrame.frameModel    = ent->client->clientMarkers[j].legsFrameModel;
-		ent->legsFrame.oldFrame      = ent->client->clientMarkers[j].legsOldFrame;
-		ent->legsFrame.frame         = ent->client->clientMarkers[j].legsFrame;
-		ent->legsFrame.oldFrameTime  = ent->client->clientMarkers[j].legsOldFrameTime;
-		ent->legsFrame.frameTime     = ent->client->clientMarkers[j].legsFrameTime;
-		ent->legsFrame.yawAngle      = ent->client->clientMarkers[j].legsYawAngle;
-		ent->legsFrame.pitchAngle    = ent->client->clientMarkers[j].legsPitchAngle;
-		ent->legsFrame.yawing        = ent->client->clientMarkers[j].legsYawing;
-		ent->legsFrame.pitching      = ent->client->clientMarkers[j].legsPitching;
-		if (ent->client->clientMarkers[j].legsAnimationMovetype)
-		{
-			ent->legsFrame.animation->movetype = ent->client->clientMarkers[j].legsAnimationMovetype;
-		}
+		// BuildHead/Legs uses these
+		VectorCopy(history->viewangles[j], ent->client->ps.viewangles);
+		G_RestoreMarkerPose(ent, &history->pose[j]);
 
 		// time stamp for BuildHead/Leg
-		ent->timeShiftTime = ent->client->clientMarkers[j].time;
+		ent->timeShiftTime = history->time[j];
 	}
 
 	trap_LinkEntity(ent);
@@ -506,45 +390,10 @@ qboolean G_ReAdjustSingleClientPosition(gentity_t *ent)
 
 		// Head, Legs stuff
 		VectorCopy(ent->client->backupMarker.viewangles, ent->client->ps.viewangles);
-
-		ent->client->ps.eFlags     = ent->client->backupMarker.eFlags;
-		ent->client->ps.pm_flags   = ent->client->backupMarker.pm_flags;
-		ent->client->ps.viewheight = ent->client->backupMarker.viewheight;
-
-		ent->client->ps.groundEntityNum = ent->client->backupMarker.groundEntityNum;
+		G_RestoreMarkerPose(ent, &ent->client->backupMarker.pose);
 
 		ent->client->backupMarker.time = 0;
 
-		// Torso Markers
-		ent->torsoFrame.oldFrameModel = ent->client->backupMarker.torsoOldFrameModel;
-		ent->torsoFrame.frameModel    = ent->client->backupMarker.torsoFrameModel;
-		ent->torsoFrame.oldFrame      = ent->client->backupMarker.torsoOldFrame;
-		ent->torsoFrame.frame         = ent->client->backupMarker.torsoFrame;
-		ent->torsoFrame.oldFrameTime  = ent->client->backupMarker.torsoOldFrameTime;
-		ent->torsoFrame.frameTime     = ent->client->backupMarker.torsoFrameTime;
-		ent->torsoFrame.yawAngle      = ent->client->backupMarker.torsoYawAngle;
-		ent->torsoFrame.pitchAngle    = ent->client->backupMarker.torsoPitchAngle;
-		ent->torsoFrame.yawing        = ent->client->backupMarker.torsoYawing;
-		ent->torsoFrame.pitching      = ent->client->backupMarker.torsoPitching;
-		if (ent->client->backupMarker.torsoAnimationMovetype)
-		{
-			ent->torsoFrame.animation->movetype = ent->client->backupMarker.torsoAnimationMovetype;
-		}
-
-		// Legs Markers
-		ent->legsFrame.oldFrameModel = ent->client->backupMarker.legsOldFrameModel;
-		ent->legsFrame.frameModel    = ent->client->backupMarker.legsFrameModel;
-		ent->legsFrame.oldFrame      = ent->client->backupMarker.legsOldFrame;
-		ent->legsFrame.frame         = ent->client->backupMarker.legsFrame;
-		ent->legsFrame.oldFrameTime  = ent->client->backupMarker.legsOldFrameTime;
-		ent->legsFrame.frameTime     = ent->client->backupMarker.legsFrameTime;
-		ent->legsFrame.yawAngle      = ent->client->backupMarker.legsYawAngle;
-		ent->legsFrame.pitchAngle    = ent->client->backupMarker.legsPitchAngle;
-		if (ent->client->backupMarker.legsAnimationMovetype)
-		{
-			ent->legsFrame.animation->movetype = ent->client->backupMarker.legsAnimationMovetype;
-		}
-
 		// time stamp for BuildHead/Leg
 		ent->timeShiftTime = 0;
 
@@ -594,9 +443,10 @@ static void G_AdjustClientPositions(gentity_t *skip, int time, qboolean backward
  */
 void G_ResetMarkers(gentity_t *ent)
 {
-	int   i, time;
-	float period = sv_fps.value;
-	int   eFlags;
+	clientMarkerHistory_t *history = &ent->client->markers;
+	int                   i, time;
+	float                 period = sv_fps.value;
+	int                   eFlags;
 
 	if (period <= 0.f)
 	{
@@ -614,63 +464,190 @@ void G_ResetMarkers(gentity_t *ent)
 		eFlags &= ~EF_MOUNTEDTANK;
 	}
 
-	ent->client->topMarker = MAX_CLIENT_MARKERS - 1;
+	history->head = MAX_CLIENT_MARKERS - 1;
 	for (i = MAX_CLIENT_MARKERS - 1, time = level.time; i >= 0; i--, time -= period)
 	{
-		VectorCopy(ent->r.mins, ent->client->clientMarkers[i].mins);
-		VectorCopy(ent->r.maxs, ent->client->clientMarkers[i].maxs);
-		VectorCopy(ent->r.currentOrigin, ent->client->clientMarkers[i].origin);
-		ent->client->clientMarkers[i].time = time;
-		VectorCopy(ent->client->ps.viewangles, ent->client->clientMarkers[i].viewangles);
-		ent->client->clientMarkers[i].eFlags          = eFlags;
-		ent->client->clientMarkers[i].pm_flags        = ent->client->ps.pm_flags;
-		ent->client->clientMarkers[i].viewheight      = ent->client->ps.viewheight;
-		ent->client->clientMarkers[i].groundEntityNum = ent->client->ps.groundEntityNum;
-
-		// Torso Markers
-		ent->client->clientMarkers[i].torsoOldFrameModel = ent->torsoFrame.oldFrameModel;
-		ent->client->clientMarkers[i].torsoFrameModel    = ent->torsoFrame.frameModel;
-		ent->client->clientMarkers[i].torsoOldFrame      = ent->torsoFrame.oldFrame;
-		ent->client->clientMarkers[i].torsoFrame         = ent->torsoFrame.frame;
-		ent->client->clientMarkers[i].torsoOldFrameTime  = ent->torsoFrame.oldFrameTime;
-		ent->client->clientMarkers[i].torsoFrameTime     = ent->torsoFrame.frameTime;
-		ent->client->clientMarkers[i].torsoYawAngle      = ent->torsoFrame.yawAngle;
-		ent->client->clientMarkers[i].torsoPitchAngle    = ent->torsoFrame.pitchAngle;
-		ent->client->clientMarkers[i].torsoYawing        = ent->torsoFrame.yawing;
-		ent->client->clientMarkers[i].torsoPitching      = ent->torsoFrame.pitching;
-		if (ent->torsoFrame.animation)
+		VectorCopy(ent->r.mins, history->mins[i]);
+		VectorCopy(ent->r.maxs, history->maxs[i]);
+		VectorCopy(ent->r.currentOrigin, history->origin[i]);
+		history->time[i] = time;
+		VectorCopy(ent->client->ps.viewangles, history->viewangles[i]);
+		G_StoreMarkerPose(ent, eFlags, &history->pose[i]);
+	}
+	// time stamp for BuildHead/Leg
+	ent->timeShiftTime = 0;
+}
+
+/**
+ * @var antilagRewind
+ * @brief The rewind in effect, shared by all historical traces of the same shooter and time
+ *
+ * Clients are only moved once a trace of the rewind passes close to where they
+ * have been since "time", see G_RewindClientsAlongTrace.
+ */
+static struct
+{
+	gentity_t *shooter;
+	int time;
+	int depth;                          ///< number of G_HistoricalTraceBegin calls sharing the rewind
+	int suspended;                      ///< rewinds of other shooters nested into this one
+	qboolean rewound[MAX_CLIENTS];      ///< clients moved back in time by this rewind
+	int numRewound;
+
+	int rewinds;                        ///< number of rewinds (shots)
+	int shared;                         ///< rewinds saved by sharing
+	int traces;                         ///< traces done in a rewind
+	int clientsRewound;                 ///< clients moved back in time, summed over all rewinds
+	int clientsSkipped;                 ///< clients left alone by the bounds check, summed over all rewinds
+	int maxRewound;                     ///< most clients moved back in time by a single rewind
+	int lastRewound;                    ///< clients moved back in time by the last rewind
+	int bodyParts;                      ///< clients given head and leg boxes for a trace
+} antilagRewind;
+
+#define ANTILAG_BODYPART_MARGIN 64.f    ///< how far head and leg boxes may reach out of the player bounds
+
+/**
+ * @brief Check if a trace passes through a box
+ * @param[in] absmin
+ * @param[in] absmax
+ * @param[in] margin added to all sides of the box
+ * @param[in] start
+ * @param[in] mins may be NULL
+ * @param[in] maxs may be NULL
+ * @param[in] end
+ * @return
+ */
+static qboolean G_BoxTouchesTrace(const vec3_t absmin, const vec3_t absmax, float margin, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end)
+{
+	float enter = 0.f, leave = 1.f;
+	float boxMin, boxMax, delta, t1, t2, t;
+	int   i;
+
+	for (i = 0; i < 3; i++)
+	{
+		// expand by the trace box, so the trace can be handled as a line
+		boxMin = absmin[i] - margin - (maxs ? maxs[i] : 0.f);
+		boxMax = absmax[i] + margin - (mins ? mins[i] : 0.f);
+		delta  = end[i] - start[i];
+
+		if (delta > -0.0001f && delta < 0.0001f)
+		{
+			if (start[i] < boxMin || start[i] > boxMax)
+			{
+				return qfalse;
+			}
+			continue;
+		}
+
+		t1 = (boxMin - start[i]) / delta;
+		t2 = (boxMax - start[i]) / delta;
+		if (t1 > t2)
 		{
-			ent->client->clientMarkers[i].torsoAnimationMovetype = ent->torsoFrame.animation->movetype;
+			t  = t1;
+			t1 = t2;
+			t2 = t;
 		}
 
-		// Legs Markers
-		ent->client->clientMarkers[i].legsOldFrameModel = ent->legsFrame.oldFrameModel;
-		ent->client->clientMarkers[i].legsFrameModel    = ent->legsFrame.frameModel;
-		ent->client->clientMarkers[i].legsOldFrame      = ent->legsFrame.oldFrame;
-		ent->client->clientMarkers[i].legsFrame         = ent->legsFrame.frame;
-		ent->client->clientMarkers[i].legsOldFrameTime  = ent->legsFrame.oldFrameTime;
-		ent->client->clientMarkers[i].legsFrameTime     = ent->legsFrame.frameTime;
-		ent->client->clientMarkers[i].legsYawAngle      = ent->legsFrame.yawAngle;
-		ent->client->clientMarkers[i].legsPitchAngle    = ent->legsFrame.pitchAngle;
-		ent->client->clientMarkers[i].legsYawing        = ent->legsFrame.yawing;
-		ent->client->clientMarkers[i].legsPitching      = ent->legsFrame.pitching;
-		if (ent->legsFrame.animation)
+		enter = MAX(enter, t1);
+		leave = MIN(leave, t2);
+		if (enter > leave)
 		{
-			ent->client->clientMarkers[i].legsAnimationMovetype = ent->legsFrame.animation->movetype;
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Bounds of a client over the time from "time" until now
+ * @param[in] ent client entity
+ * @param[in] time
+ * @param[out] absmin
+ * @param[out] absmax
+ */
+static void G_LagWindowBounds(gentity_t *ent, int time, vec3_t absmin, vec3_t absmax)
+{
+	clientMarkerHistory_t *history = &ent->client->markers;
+	int                   age, slot;
+	vec3_t                point;
+
+	VectorCopy(ent->r.absmin, absmin);
+	VectorCopy(ent->r.absmax, absmax);
+
+	// the markers bracketing "time" and all newer ones
+	for (age = MAX(G_FindMarker(history, time), 0); age < MAX_CLIENT_MARKERS; age++)
+	{
+		slot = G_MarkerSlot(history, age);
+
+		VectorAdd(history->origin[slot], history->mins[slot], point);
+		AddPointToBounds(point, absmin, absmax);
+		VectorAdd(history->origin[slot], history->maxs[slot], point);
+		AddPointToBounds(point, absmin, absmax);
+	}
+}
+
+/**
+ * @brief Move the clients a trace passes close to back in time, if they aren't already
+ * @param[in] start
+ * @param[in] mins
+ * @param[in] maxs
+ * @param[in] end
+ */
+static void G_RewindClientsAlongTrace(const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end)
+{
+	int       i;
+	gentity_t *list;
+	vec3_t    absmin, absmax;
+
+	if (!antilagRewind.depth || antilagRewind.suspended)
+	{
+		return;
+	}
+
+	antilagRewind.traces++;
+
+	for (i = 0; i < level.numConnectedClients; i++)
+	{
+		list = g_entities + level.sortedClients[i];
+
+		if (list == antilagRewind.shooter || antilagRewind.rewound[level.sortedClients[i]])
+		{
+			continue;
+		}
+
+		if (!G_AntilagSafe(list))
+		{
+			continue;
+		}
+
+		G_LagWindowBounds(list, antilagRewind.time, absmin, absmax);
+
+		if (!G_BoxTouchesTrace(absmin, absmax, ANTILAG_BODYPART_MARGIN, start, mins, maxs, end))
+		{
+			continue;
+		}
+
+		if (G_AdjustSingleClientPosition(list, antilagRewind.time))
+		{
+			antilagRewind.rewound[level.sortedClients[i]] = qtrue;
+			antilagRewind.numRewound++;
 		}
 	}
-	// time stamp for BuildHead/Leg
-	ent->timeShiftTime = 0;
 }
 
 // This variable needs to be here in order for G_BuildLeg() to access it..
 static grefEntity_t refent;
 
 /**
- * @brief G_AttachBodyParts
+ * @brief Give the clients near a trace head and leg boxes
  * @param[in] ent
+ * @param[in] start
+ * @param[in] mins
+ * @param[in] maxs
+ * @param[in] end
  */
-static void G_AttachBodyParts(gentity_t *ent)
+static void G_AttachBodyParts(gentity_t *ent, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end)
 {
 	int       i;
 	gentity_t *list;
@@ -684,11 +661,13 @@ static void G_AttachBodyParts(gentity_t *ent)
 		    (list != ent) &&
 		    list->r.linked &&
 		    !(list->client->ps.pm_flags & PMF_LIMBO) &&
-		    (list->client->ps.pm_type == PM_NORMAL || list->client->ps.pm_type == PM_DEAD)
+		    (list->client->ps.pm_type == PM_NORMAL || list->client->ps.pm_type == PM_DEAD) &&
+		    G_BoxTouchesTrace(list->r.absmin, list->r.absmax, ANTILAG_BODYPART_MARGIN, start, mins, maxs, end)
 		    )
 		{
 			list->client->tempHead = G_BuildHead(list, &refent, qtrue);
 			list->client->tempLeg  = G_BuildLeg(list, &refent, qfalse);
+			antilagRewind.bodyParts++;
 		}
 		else
 		{
@@ -747,6 +726,143 @@ static int G_SwitchBodyPartEntity(gentity_t *ent)
 			results->entityNum = res;                             \
 		}
 
+#define ANTILAG_RECORDED_SHOTS 256
+
+/**
+ * @struct antilagShot_s
+ * @typedef antilagShot_t
+ * @brief A historical trace recorded for antilag_bench
+ */
+typedef struct antilagShot_s
+{
+	int shooter;
+	int lag;                            ///< level.time minus the time rewound to
+	qboolean sharedRewind;              ///< traced in the same rewind as the previous shot
+	qboolean box;
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	int passEntityNum;
+	int contentmask;
+} antilagShot_t;
+
+static antilagShot_t antilagShots[ANTILAG_RECORDED_SHOTS];
+static int           antilagShotsRecorded;
+static int           antilagLastRewind;     ///< rewinds counter at the previously recorded shot
+static qboolean      antilagReplaying;
+
+/**
+ * @brief Remember a trace done while clients are rewound, so antilag_bench can replay it
+ * @param[in] start
+ * @param[in] mins
+ * @param[in] maxs
+ * @param[in] end
+ * @param[in] passEntityNum
+ * @param[in] contentmask
+ */
+static void G_RecordHistoricalShot(const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask)
+{
+	antilagShot_t *shot;
+
+	if (antilagReplaying || !antilagRewind.shooter)
+	{
+		return;
+	}
+
+	shot = &antilagShots[antilagShotsRecorded++ % ANTILAG_RECORDED_SHOTS];
+
+	shot->shooter      = antilagRewind.shooter - g_entities;
+	shot->lag          = level.time - antilagRewind.time;
+	shot->sharedRewind = (antilagShotsRecorded > 1 && antilagLastRewind == antilagRewind.rewinds);
+	shot->box          = (mins && maxs);
+	VectorCopy(start, shot->start);
+	VectorCopy(end, shot->end);
+	if (shot->box)
+	{
+		VectorCopy(mins, shot->mins);
+		VectorCopy(maxs, shot->maxs);
+	}
+	shot->passEntityNum = passEntityNum;
+	shot->contentmask   = contentmask;
+
+	antilagLastRewind = antilagRewind.rewinds;
+}
+
+/**
+ * @brief Start rewinding all clients but the shooter to "time", unless that rewind is in effect already
+ * @param[in] ent shooter
+ * @param[in] time
+ * @return qfalse if a different rewind was in effect and the clients have been
+ * moved on their own, in which case G_RewindEnd must be called with qfalse too
+ */
+static qboolean G_RewindBegin(gentity_t *ent, int time)
+{
+	if (antilagRewind.depth)
+	{
+		if (antilagRewind.shooter == ent && antilagRewind.time == time && !antilagRewind.suspended)
+		{
+			antilagRewind.depth++;
+			antilagRewind.shared++;
+			return qtrue;
+		}
+
+		// somebody else is shooting in the middle of this rewind, do it the old way
+		antilagRewind.suspended++;
+		G_AdjustClientPositions(ent, time, qtrue);
+		return qfalse;
+	}
+
+	antilagRewind.shooter    = ent;
+	antilagRewind.time       = time;
+	antilagRewind.depth      = 1;
+	antilagRewind.numRewound = 0;
+	Com_Memset(antilagRewind.rewound, 0, sizeof(antilagRewind.rewound));
+	antilagRewind.rewinds++;
+
+	// clients are moved by the traces, see G_RewindClientsAlongTrace
+	return qtrue;
+}
+
+/**
+ * @brief Restore the rewound clients once the last trace sharing the rewind is done
+ * @param[in] ent shooter
+ * @param[in] shared return value of the matching G_RewindBegin
+ */
+static void G_RewindEnd(gentity_t *ent, qboolean shared)
+{
+	int i;
+
+	if (!shared)
+	{
+		G_AdjustClientPositions(ent, 0, qfalse);
+		if (antilagRewind.suspended)
+		{
+			antilagRewind.suspended--;
+		}
+		return;
+	}
+
+	if (--antilagRewind.depth > 0)
+	{
+		return;
+	}
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (antilagRewind.rewound[i])
+		{
+			G_ReAdjustSingleClientPosition(g_entities + i);
+		}
+	}
+
+	antilagRewind.clientsRewound += antilagRewind.numRewound;
+	antilagRewind.clientsSkipped += MAX(level.numConnectedClients - 1 - antilagRewind.numRewound, 0);
+	antilagRewind.lastRewound     = antilagRewind.numRewound;
+	antilagRewind.maxRewound      = MAX(antilagRewind.maxRewound, antilagRewind.numRewound);
+
+	antilagRewind.shooter = NULL;
+	antilagRewind.depth   = 0;
+}
+
 /**
  * @brief Run a trace with players in historical positions.
  * @param[in] ent
@@ -760,22 +876,27 @@ static int G_SwitchBodyPartEntity(gentity_t *ent)
  */
 void G_HistoricalTrace(gentity_t *ent, trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask)
 {
+	qboolean shared;
+
 	if (!g_antilag.integer || !ent->client || ent->r.svFlags & SVF_BOT)
 	{
 		G_Trace(ent, results, start, mins, maxs, end, passEntityNum, contentmask);
 		return;
 	}
 
-	G_AdjustClientPositions(ent, ent->client->pers.cmd.serverTime, qtrue);
+	shared = G_RewindBegin(ent, ent->client->pers.cmd.serverTime);
 
 	G_Trace(ent, results, start, mins, maxs, end, passEntityNum, contentmask);
 
-	G_AdjustClientPositions(ent, 0, qfalse);
+	G_RewindEnd(ent, shared);
 }
 
 /**
  * @brief G_HistoricalTraceBegin
  * @param[in] ent
+ *
+ * @note Historical traces of the same shooter until the matching
+ * G_HistoricalTraceEnd share this rewind instead of doing their own
  */
 void G_HistoricalTraceBegin(gentity_t *ent)
 {
@@ -784,7 +905,8 @@ void G_HistoricalTraceBegin(gentity_t *ent)
 	{
 		return;
 	}
-	G_AdjustClientPositions(ent, ent->client->pers.cmd.serverTime, qtrue);
+
+	G_RewindBegin(ent, ent->client->pers.cmd.serverTime);
 }
 
 /**
@@ -798,16 +920,144 @@ void G_HistoricalTraceEnd(gentity_t *ent)
 	{
 		return;
 	}
-	G_AdjustClientPositions(ent, 0, qfalse);
+
+	if (!antilagRewind.depth || antilagRewind.shooter != ent)
+	{
+		// paired with a rewind nested into another shooter's one
+		G_RewindEnd(ent, qfalse);
+		return;
+	}
+
+	G_RewindEnd(ent, qtrue);
+}
+
+/**
+ * @brief Replay the recently recorded historical traces and print how long they took
+ *
+ * Usage: antilag_bench [iterations]
+ */
+void Svcmd_AntilagBench_f(void)
+{
+	char          arg[MAX_TOKEN_CHARS];
+	int           iterations = 10;
+	int           count      = MIN(antilagShotsRecorded, ANTILAG_RECORDED_SHOTS);
+	int           first      = antilagShotsRecorded - count;
+	int           traced     = 0;
+	int           rewinds    = antilagRewind.rewinds;
+	int           shared     = antilagRewind.shared;
+	int           rewound    = antilagRewind.clientsRewound;
+	int           i, n, startTime, msec;
+	qboolean      open = qfalse, sharedRewind = qfalse;
+	gentity_t     *ent, *shooter = NULL;
+	antilagShot_t *shot;
+	trace_t       tr;
+
+	if (!count)
+	{
+		G_Printf("antilag_bench: no historical traces recorded yet\n");
+		return;
+	}
+
+	if (trap_Argc() > 1)
+	{
+		trap_Argv(1, arg, sizeof(arg));
+		iterations = MAX(1, Q_atoi(arg));
+	}
+
+	antilagReplaying = qtrue;
+	startTime        = trap_Milliseconds();
+
+	for (n = 0; n < iterations; n++)
+	{
+		for (i = 0; i < count; i++)
+		{
+			shot = &antilagShots[(first + i) % ANTILAG_RECORDED_SHOTS];
+			ent  = g_entities + shot->shooter;
+
+			if (!ent->inuse || !ent->client)
+			{
+				continue;
+			}
+
+			// rewind the way the shots were fired, sharing it where they did
+			if (open && (!shot->sharedRewind || ent != shooter))
+			{
+				G_RewindEnd(shooter, sharedRewind);
+				open = qfalse;
+			}
+
+			if (!open)
+			{
+				shooter      = ent;
+				sharedRewind = G_RewindBegin(ent, level.time - shot->lag);
+				open         = qtrue;
+			}
+
+			G_Trace(ent, &tr, shot->start, shot->box ? shot->mins : NULL, shot->box ? shot->maxs : NULL, shot->end, shot->passEntityNum, shot->contentmask);
+			traced++;
+		}
+
+		if (open)
+		{
+			G_RewindEnd(shooter, sharedRewind);
+			open = qfalse;
+		}
+	}
+
+	msec             = trap_Milliseconds() - startTime;
+	antilagReplaying = qfalse;
+
+	G_Printf("antilag_bench: %i traces of %i recorded shots, %i rewinds, %i shared\n", traced, count, antilagRewind.rewinds - rewinds, antilagRewind.shared - shared);
+	G_Printf("antilag_bench: %i clients rewound, %i msec, %.2f usec per trace\n", antilagRewind.clientsRewound - rewound, msec, traced ? (msec * 1000.f) / traced : 0.f);
+}
+
+/**
+ * @brief Print how many clients the historical traces had to move back in time
+ *
+ * Usage: antilag_stats [reset]
+ */
+void Svcmd_AntilagStats_f(void)
+{
+	char arg[MAX_TOKEN_CHARS];
+	int  shots = antilagRewind.rewinds;
+
+	if (trap_Argc() > 1)
+	{
+		trap_Argv(1, arg, sizeof(arg));
+		if (!Q_stricmp(arg, "reset"))
+		{
+			antilagRewind.rewinds        = 0;
+			antilagRewind.shared         = 0;
+			antilagRewind.traces         = 0;
+			antilagRewind.clientsRewound = 0;
+			antilagRewind.clientsSkipped = 0;
+			antilagRewind.maxRewound     = 0;
+			antilagRewind.lastRewound    = 0;
+			antilagRewind.bodyParts      = 0;
+			G_Printf("antilag_stats: counters reset\n");
+			return;
+		}
+	}
+
+	G_Printf("Antilag rewinds    : %i (%i more shared), %i traces\n", shots, antilagRewind.shared, antilagRewind.traces);
+	G_Printf("Clients rewound    : %i, %.2f per shot, max %i, last %i\n", antilagRewind.clientsRewound,
+	         shots ? antilagRewind.clientsRewound / (float)shots : 0.f, antilagRewind.maxRewound, antilagRewind.lastRewound);
+	G_Printf("Clients skipped    : %i, %.2f per shot\n", antilagRewind.clientsSkipped,
+	         shots ? antilagRewind.clientsSkipped / (float)shots : 0.f);
+	G_Printf("Body parts attached: %i\n", antilagRewind.bodyParts);
 }
 
 static float maxsBackup[MAX_CLIENTS] = { 0 };
 
 /**
- * @brief G_AdjustClientHeight
+ * @brief Raise the bounds of the clients near a trace to their hitbox height
  * @param[in] ent
+ * @param[in] start
+ * @param[in] mins
+ * @param[in] maxs
+ * @param[in] end
  */
-void G_AdjustClientHeight(gentity_t *ent)
+static void G_AdjustClientHeight(gentity_t *ent, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end)
 {
 	int i;
 
@@ -820,7 +1070,8 @@ void G_AdjustClientHeight(gentity_t *ent)
 		    (client != ent) &&
 		    client->r.linked &&
 		    !(client->client->ps.pm_flags & PMF_LIMBO) &&
-		    (client->client->ps.pm_type == PM_NORMAL || client->client->ps.pm_type == PM_DEAD)
+		    (client->client->ps.pm_type == PM_NORMAL || client->client->ps.pm_type == PM_DEAD) &&
+		    G_BoxTouchesTrace(client->r.absmin, client->r.absmax, ANTILAG_BODYPART_MARGIN, start, mins, maxs, end)
 		    )
 		{
 			maxsBackup[level.sortedClients[i]] = client->r.maxs[2];
@@ -843,7 +1094,7 @@ void G_AdjustClientHeight(gentity_t *ent)
 /**
  * @brief G_ResetClientHeight
  */
-void G_ResetClientHeight(void)
+static void G_ResetClientHeight(void)
 {
 	int i;
 
@@ -879,9 +1130,13 @@ void G_Trace(gentity_t *ent, trace_t *results, const vec3_t start, const vec3_t
 	vec3_t dir;
 	int    res;
 
-	G_AttachBodyParts(ent);
+	G_RecordHistoricalShot(start, mins, maxs, end, passEntityNum, contentmask);
+
+	G_RewindClientsAlongTrace(start, mins, maxs, end);
+
+	G_AttachBodyParts(ent, start, mins, maxs, end);
 
-	G_AdjustClientHeight(ent);
+	G_AdjustClientHeight(ent, start, mins, maxs, end);
 
 	trap_Trace(results, start, mins, maxs, end, passEntityNum, contentmask);
 
@@ -543,6 +543,7 @@ void CopyToBodyQue(gentity_t *ent)
 
 	body->s.eType   = ET_CORPSE;
 	body->classname = "corpse";
+	G_MarkEntityIndexDirty(body);
 
 	body->s.powerups    = 0; // clear powerups
 	body->s.loopSound   = 0; // clear lava burning
@@ -3097,6 +3098,7 @@ void ClientSpawn(gentity_t *ent, qboolean revived, qboolean teamChange, qboolean
 	ent->classname         = "player";
 	ent->r.contents        = CONTENTS_BODY;
 	ent->clipmask          = MASK_PLAYERSOLID;
+	G_MarkEntityIndexDirty(ent);
 
 	// Init to -1 on first spawn;
 	if (!revived)
@@ -3575,6 +3577,8 @@ void ClientDisconnect(int clientNum)
 	ent->client->sess.sessionTeam          = TEAM_FREE;
 	ent->active                            = 0;
 
+	G_MarkEntityIndexDirty(ent);
+
 	// this needs to be cleared
 	ent->r.svFlags &= ~SVF_BOT;
 
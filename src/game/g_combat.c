@@ -644,7 +644,7 @@ void player_die(gentity_t *self, gentity_t *inflictor, gentity_t *attacker, int
 	}
 
 	// prepare scoreboard
-	CalculateRanks();
+	QueueCalculateRanks(NULL);
 
 	// send a fancy "MEDIC!" scream.  Sissies, ain' they?
 	if (self->health > GIB_HEALTH &&
@@ -753,7 +753,7 @@ void player_die(gentity_t *self, gentity_t *inflictor, gentity_t *attacker, int
 		self->die = body_die;
 	}
 
-	CalculateRanks();
+	QueueCalculateRanks(NULL);
 
 	// automatically go to limbo from tank
 	if (killedintank)
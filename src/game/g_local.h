@@ -859,27 +859,21 @@ typedef struct
 
 } clientPersistant_t;
 
+#define MAX_CLIENT_MARKERS 40
+
 /**
- * @struct clientMarker_t
- * @brief Contains all the variables that are tracked in historical markers for antilag functionality.
+ * @struct clientMarkerPose_t
+ * @brief State of a historical marker that can't be interpolated, restored from the marker closest in time.
  */
 typedef struct
 {
-	vec3_t mins;
-	vec3_t maxs;
-
-	vec3_t origin;
-
 	// for BuildHead/Legs
 	int eFlags;             ///< s.eFlags to ps.eFlags
 	int viewheight;         ///< ps for both
 	int pm_flags;           ///< ps for both
-	vec3_t viewangles;      ///< s.apos.trBase to ps.viewangles
 
 	int groundEntityNum;
 
-	int time;
-
 	// torso markers
 	qhandle_t torsoOldFrameModel;
 	qhandle_t torsoFrameModel;
@@ -905,9 +899,43 @@ typedef struct
 	int legsYawing;
 	qboolean legsPitching;
 	int legsAnimationMovetype;
+} clientMarkerPose_t;
+
+/**
+ * @struct clientMarker_t
+ * @brief Contains all the variables that are tracked in historical markers for antilag functionality.
+ */
+typedef struct
+{
+	vec3_t mins;
+	vec3_t maxs;
+
+	vec3_t origin;
+	vec3_t viewangles;      ///< s.apos.trBase to ps.viewangles
+
+	int time;
+
+	clientMarkerPose_t pose;
 } clientMarker_t;
 
-#define MAX_CLIENT_MARKERS 40
+/**
+ * @struct clientMarkerHistory_t
+ * @brief Ring buffer of historical markers for antilag functionality.
+ *
+ * Every field is kept in its own array, so looking up a time only touches
+ * the timestamps and a rewind only the two markers bracketing it.
+ * The markers are ordered by time, starting with the one after head.
+ */
+typedef struct
+{
+	int head;                                   ///< newest marker
+	int time[MAX_CLIENT_MARKERS];
+	vec3_t origin[MAX_CLIENT_MARKERS];
+	vec3_t mins[MAX_CLIENT_MARKERS];
+	vec3_t maxs[MAX_CLIENT_MARKERS];
+	vec3_t viewangles[MAX_CLIENT_MARKERS];
+	clientMarkerPose_t pose[MAX_CLIENT_MARKERS];
+} clientMarkerHistory_t;
 
 #define FIELDOPS_SPECIAL_PICKUP_MOD 3   ///< Number of times (minus one for modulo) field ops must drop ammo before scoring a point
 #define MEDIC_SPECIAL_PICKUP_MOD    4   ///< Same thing for medic
@@ -1021,8 +1049,7 @@ struct gclient_s
 	unsigned int combatState;
 
 	// antilag
-	int topMarker;
-	clientMarker_t clientMarkers[MAX_CLIENT_MARKERS];
+	clientMarkerHistory_t markers;
 	clientMarker_t backupMarker;
 
 	// zinx etpro antiwarp
@@ -1229,6 +1256,8 @@ typedef struct level_locals_s
 	int numPlayingClients;                      ///< connected, non-spectators
 	uint64_t playingClientsMask;                ///< connected, non-spectators, bitmask
 	int sortedClients[MAX_CLIENTS];             ///< sorted by score
+	qboolean ranksQueued;                       ///< counts and order have to be rebuilt, see QueueCalculateRanks
+	qboolean ranksResort;                       ///< a score changed, only the order has to be restored, see QueueCalculateRanks
 
 	int warmupModificationCount;                ///< for detecting if g_warmup is changed
 
@@ -1534,6 +1563,8 @@ void Spawn_Shard(gentity_t *ent, gentity_t *inflictor, float quantity, int type)
 // g_utils.c
 int G_FindConfigstringIndex(const char *name, int start, int max, qboolean create);
 void G_RemoveConfigstringIndex(const char *name, int start, int max);
+void G_ResetConfigstringIndexes(void);
+void G_ConfigstringIndexChanged(int num, const char *string);
 
 int G_ModelIndex(const char *name);
 int G_SoundIndex(const char *name);
@@ -1552,6 +1583,9 @@ gentity_t *G_FindFloat(gentity_t *from, int fieldofs, float match);
 gentity_t *G_FindVector(gentity_t *from, int fieldofs, const vec3_t match);
 gentity_t *G_FindByTargetname(gentity_t *from, const char *match);
 gentity_t *G_FindByTargetnameFast(gentity_t *from, const char *match, int hash);
+void G_MarkEntityIndexDirty(gentity_t *ent);
+void G_SyncEntityIndex(void);
+void G_ResetEntityIndex(void);
 gentity_t *G_PickTarget(const char *targetname);
 void G_UseTargets(gentity_t *ent, gentity_t *activator);
 void G_SetMovedir(vec3_t angles, vec3_t movedir);
@@ -1740,6 +1774,8 @@ void ClientSpawn(gentity_t *ent, qboolean revived, qboolean teamChange, qboolean
 void player_die(gentity_t *self, gentity_t *inflictor, gentity_t *attacker, int damage, meansOfDeath_t meansOfDeath);
 void AddKillScore(gentity_t *ent, int score);
 void CalculateRanks(void);
+void QueueCalculateRanks(gclient_t *client);
+void CheckQueuedRanks(void);
 qboolean SpotWouldTelefrag(gentity_t *spot);
 void AddMedicTeamBonus(gclient_t *client);
 
@@ -1810,10 +1846,12 @@ qboolean trap_GetValue(char *value, int valueSize, const char *key);
 void trap_DemoSupport(const char *commands);
 void trap_SnapshotCallbackExt(void);
 void trap_SnapshotSetClientMask(int clientNum, uint64_t mask);
+int trap_Cvar_GetModified(int *sequence, int *handles, int maxHandles);
 extern int dll_com_trapGetValue;
 extern int dll_trap_DemoSupport;
 extern int dll_trap_SnapshotCallbackExt;
 extern int dll_trap_SnapshotSetClientMask;
+extern int dll_trap_Cvar_GetModified;
 
 // g_demo_legacy.c
 void G_DemoStateChanged(demoState_t demoState, int demoClientsNum);
@@ -1851,6 +1889,9 @@ qboolean OnSameTeam(gentity_t *ent1, gentity_t *ent2);
 
 // g_mem.c
 void *G_Alloc(unsigned int size);
+void G_SetMemoryOwner(gentity_t *ent);
+void G_DisownMemory(void);
+void G_FreeEntityMemory(gentity_t *ent);
 void G_InitMemory(void);
 void Svcmd_GameMem_f(void);
 
@@ -2160,6 +2201,8 @@ extern vmCvar_t g_maxWarp;
 extern vmCvar_t lua_modules;
 extern vmCvar_t lua_allowedModules;
 extern vmCvar_t g_luaModuleList;
+extern vmCvar_t lua_budget;                 ///< milliseconds a Lua module may spend in callbacks per frame, 0 = off
+extern vmCvar_t lua_budgetDefer;            ///< skip non-critical callbacks of modules over lua_budget
 #endif
 
 extern vmCvar_t g_guidCheck;
@@ -2369,6 +2412,8 @@ void G_ResetMarkers(gentity_t *ent);
 void G_HistoricalTrace(gentity_t *ent, trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask);
 void G_HistoricalTraceBegin(gentity_t *ent);
 void G_HistoricalTraceEnd(gentity_t *ent);
+void Svcmd_AntilagBench_f(void);
+void Svcmd_AntilagStats_f(void);
 void G_Trace(gentity_t *ent, trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask);
 void G_PredictPmove(gentity_t *ent, float frametime);
 
@@ -2400,6 +2445,7 @@ typedef struct mapEntityData_s
 
 	int entNum;
 	struct mapEntityData_s *next, *prev;
+	struct mapEntityData_s *entNext, *entPrev;          ///< chain of all entries sharing entNum
 } mapEntityData_t;
 
 /**
@@ -2412,19 +2458,25 @@ typedef struct mapEntityData_Team_s
 	mapEntityData_t mapEntityData_Team[MAX_GENTITIES];
 	mapEntityData_t *freeMapEntityData;                 ///< single linked list
 	mapEntityData_t activeMapEntityData;                ///< double linked list
+	mapEntityData_t *entityMapEntityData[MAX_GENTITIES];    ///< active entries by entity number
 } mapEntityData_Team_t;
 
 extern mapEntityData_Team_t mapEntityData[2];
 
 void G_InitMapEntityData(mapEntityData_Team_t *teamList);
 mapEntityData_t *G_FreeMapEntityData(mapEntityData_Team_t *teamList, mapEntityData_t *mEnt);
-mapEntityData_t *G_AllocMapEntityData(mapEntityData_Team_t *teamList);
+mapEntityData_t *G_AllocMapEntityData(mapEntityData_Team_t *teamList, int entNum);
 mapEntityData_t *G_FindMapEntityData(mapEntityData_Team_t *teamList, int entNum);
 mapEntityData_t *G_FindMapEntityDataSingleClient(mapEntityData_Team_t *teamList, mapEntityData_t *start, int entNum, int clientNum);
 
 void G_ResetTeamMapData(void);
 void G_UpdateTeamMapData(void);
 
+void G_ResetLandMineGrid(void);
+void G_LinkLandMine(gentity_t *ent);
+void G_UnlinkLandMine(gentity_t *ent);
+int G_FindLandMines(const vec3_t mins, const vec3_t maxs, int *list, int maxcount);
+
 void G_SetupFrustum(gentity_t *ent);
 void G_SetupFrustum_ForBinoculars(gentity_t *ent);
 qboolean G_VisibleFromBinoculars(gentity_t *viewer, gentity_t *ent, vec3_t origin);
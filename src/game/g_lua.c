@@ -21,10 +21,19 @@
 #include "g_etbot_interface.h"
 #endif
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 extern field_t fields[];
 
 lua_vm_t *lVM[LUA_NUM_VM];
 
+static void G_LuaCountHooks(void);
+static void G_LuaPushProfile(lua_State *L, lua_vm_t *vm);
+
 /**
  * @param addr pointer to a gentity (gentity*)
  * @returns the entity number.
@@ -148,7 +157,7 @@ static int _et_IPCSend(lua_State *L)
 	}
 
 	// Find callback
-	if (!G_LuaGetNamedFunction(vm, "et_IPCReceive"))
+	if (!G_LuaGetHookFunction(vm, LUAHOOK_IPCRECEIVE))
 	{
 		lua_pushinteger(L, 0);
 		return 1;
@@ -166,7 +175,7 @@ static int _et_IPCSend(lua_State *L)
 	lua_pushstring(vm->L, message);
 
 	// Call
-	if (!G_LuaCall(vm, "et.IPCSend", 2, 0))
+	if (!G_LuaCallHook(vm, LUAHOOK_IPCRECEIVE, 2, 0))
 	{
 		//G_LuaStopVM(vm);
 		lua_pushinteger(L, 0);
@@ -855,6 +864,43 @@ static int _et_G_ClientSound(lua_State *L)
 
 // Miscellaneous {{{
 
+/**
+ * Returns the callback profile of a Lua module, times are in microseconds.
+ *
+ * The table holds 'lastframe', 'peakframe' (time spent in callbacks per server frame),
+ * 'overruns' (frames over `lua_budget`), 'budget', 'buckets' (upper bounds of the
+ * histogram buckets) and 'hooks', indexed by callback name, with 'calls', 'total',
+ * 'max', 'skipped' and 'histogram' of each callback that has been called.
+ *
+ * @lua_def_prototype et.LuaProfile(vmnumber)
+ * @lua_def ---@param vmnumber number|nil the VM slot number, defaults to the calling module.
+ * @lua_def ---@return table|nil profile the profile or 'nil' if there is no module in the slot.
+ */
+static int _et_LuaProfile(lua_State *L)
+{
+	lua_vm_t *vm;
+
+	if (lua_isnoneornil(L, 1))
+	{
+		vm = G_LuaGetVM(L);
+	}
+	else
+	{
+		int vmnumber = (int)luaL_checkinteger(L, 1);
+
+		vm = (vmnumber >= 0 && vmnumber < LUA_NUM_VM) ? lVM[vmnumber] : NULL;
+	}
+
+	if (!vm)
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	G_LuaPushProfile(L, vm);
+	return 1;
+}
+
 /**
  * Returns level time.
  *
@@ -2166,6 +2212,12 @@ static int _et_gentity_set(lua_State *L)
 			Com_Dealloc(*(char **)addr);
 			*(char **)addr = Com_Allocate(strlen(buffer) + 1);
 			Q_strncpyz(*(char **)addr, buffer, strlen(buffer));
+
+			// classname and targetname lookups must see the new name in this frame already
+			if (field->flags & FIELD_FLAG_GENTITY)
+			{
+				G_MarkEntityIndexDirty(ent);
+			}
 		}
 		break;
 	case FIELD_FLOAT:
@@ -2494,6 +2546,7 @@ static const luaL_Reg etlib[] =
 	{ "G_ClientSound",           _et_G_ClientSound           },
 	// Miscellaneous
 	{ "trap_Milliseconds",       _et_trap_Milliseconds       },
+	{ "LuaProfile",              _et_LuaProfile              },
 	{ "isBitSet",                _et_isBitSet                },
 	{ "G_Damage",                _et_G_Damage                },
 	{ "G_AddSkillPoints",        _et_G_AddSkillPoints        },
@@ -2624,6 +2677,7 @@ qboolean G_LuaRunIsolated(const char *modName)
 		{
 			vm->id      = freeVM;
 			lVM[freeVM] = vm;
+			G_LuaCountHooks();
 			return qtrue;
 		}
 		else
@@ -2787,6 +2841,608 @@ qboolean G_LuaGetNamedFunction(lua_vm_t *vm, const char *name)
 	return qfalse;
 }
 
+/*
+ * Callback dispatch
+ *
+ * The callbacks of a module are not stored in its _G table. A metatable set on _G
+ * before the script runs catches their definitions and keeps them as registry
+ * references, so dispatching a hook needs neither a string lookup nor a call into
+ * VMs that don't handle it. Reading and redefining them from Lua works as usual.
+ */
+
+static const char *luaHookNames[LUAHOOK_NUM] =
+{
+	"et_IPCReceive",
+	"et_Quit",
+	"et_InitGame",
+	"et_ShutdownGame",
+	"et_RunFrame",
+	"et_ClientConnect",
+	"et_ClientDisconnect",
+	"et_ClientBegin",
+	"et_ClientUserinfoChanged",
+	"et_ClientSpawn",
+	"et_ClientCommand",
+	"et_ConsoleCommand",
+	"et_UpgradeSkill",
+	"et_SetPlayerSkill",
+	"et_Print",
+	"et_DPrint",
+	"et_Error",
+	"et_Obituary",
+	"et_Revive",
+	"et_Damage",
+	"et_WeaponFire",
+	"et_FixedMGFire",
+	"et_MountedMGFire",
+	"et_AAGunFire",
+	"et_SpawnEntitiesFromString",
+	"et_Chat",
+};
+
+static int luaHookVMs[LUAHOOK_NUM];     ///< number of running VMs handling each callback
+
+/// upper bounds in microseconds of the call time histogram buckets, the last bucket takes the rest
+static const unsigned int luaProfBounds[LUA_PROF_BUCKETS - 1] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+/**
+ * @brief G_LuaMicroseconds
+ * @return Wall clock time in microseconds
+ */
+static uint64_t G_LuaMicroseconds(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER        counter;
+
+	if (!frequency.QuadPart)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+
+	return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000
+	       + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/**
+ * @brief G_LuaHookForName
+ * @param[in] name
+ * @return The callback with the given global name, -1 if it isn't one
+ */
+static int G_LuaHookForName(const char *name)
+{
+	int i;
+
+	if (strncmp(name, "et_", 3))
+	{
+		return -1;
+	}
+
+	for (i = 0; i < LUAHOOK_NUM; i++)
+	{
+		if (!strcmp(name, luaHookNames[i]))
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Counts the running VMs handling each callback
+ */
+static void G_LuaCountHooks(void)
+{
+	int      i, j;
+	lua_vm_t *vm;
+
+	Com_Memset(luaHookVMs, 0, sizeof(luaHookVMs));
+
+	for (i = 0; i < LUA_NUM_VM; i++)
+	{
+		vm = lVM[i];
+		if (!vm || vm->id < 0 || !vm->L)
+		{
+			continue;
+		}
+
+		for (j = 0; j < LUAHOOK_NUM; j++)
+		{
+			if (!vm->hooksCached || vm->hookRef[j] != LUA_NOREF)
+			{
+				luaHookVMs[j]++;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Clears the hook statistics and profile of a VM
+ * @param[in,out] vm
+ */
+static void G_LuaResetProfile(lua_vm_t *vm)
+{
+	Com_Memset(vm->hookCalls, 0, sizeof(vm->hookCalls));
+	Com_Memset(vm->hookTime, 0, sizeof(vm->hookTime));
+	Com_Memset(vm->hookMax, 0, sizeof(vm->hookMax));
+	Com_Memset(vm->hookSkipped, 0, sizeof(vm->hookSkipped));
+	Com_Memset(vm->hookHist, 0, sizeof(vm->hookHist));
+	vm->frameTime         = 0;
+	vm->lastFrameTime     = 0;
+	vm->peakFrameTime     = 0;
+	vm->overruns          = 0;
+	vm->lastBudgetWarning = 0;
+	vm->overBudget        = qfalse;
+}
+
+/**
+ * @brief Callbacks left out while a VM is over lua_budget and lua_budgetDefer is set,
+ * nothing depends on their results and et_RunFrame runs again on the next frame
+ * @param[in] hook
+ * @return
+ */
+static qboolean G_LuaHookDeferrable(luaHook_t hook)
+{
+	switch (hook)
+	{
+	case LUAHOOK_RUNFRAME:
+	case LUAHOOK_PRINT:
+	case LUAHOOK_DPRINT:
+		return qtrue;
+	default:
+		return qfalse;
+	}
+}
+
+/**
+ * @brief __index of _G, returns the cached callbacks
+ * @param[in] L
+ * @return
+ */
+static int G_LuaGlobalsIndex(lua_State *L)
+{
+	lua_vm_t *vm = (lua_vm_t *)lua_touserdata(L, lua_upvalueindex(1));
+	int      hook;
+
+	if (lua_type(L, 2) == LUA_TSTRING)
+	{
+		hook = G_LuaHookForName(lua_tostring(L, 2));
+		if (hook >= 0 && vm->hookRef[hook] != LUA_NOREF)
+		{
+			lua_rawgeti(L, LUA_REGISTRYINDEX, vm->hookRef[hook]);
+			return 1;
+		}
+	}
+
+	lua_pushnil(L);
+	return 1;
+}
+
+/**
+ * @brief __newindex of _G, keeps callbacks as registry references and stores everything else
+ * @param[in] L
+ * @return
+ */
+static int G_LuaGlobalsNewIndex(lua_State *L)
+{
+	lua_vm_t *vm = (lua_vm_t *)lua_touserdata(L, lua_upvalueindex(1));
+	int      hook;
+
+	if (lua_type(L, 2) == LUA_TSTRING)
+	{
+		hook = G_LuaHookForName(lua_tostring(L, 2));
+		if (hook >= 0)
+		{
+			luaL_unref(L, LUA_REGISTRYINDEX, vm->hookRef[hook]);
+			vm->hookRef[hook] = LUA_NOREF;
+
+			if (!lua_isnil(L, 3))
+			{
+				lua_pushvalue(L, 3);
+				vm->hookRef[hook] = luaL_ref(L, LUA_REGISTRYINDEX);
+			}
+
+			G_LuaCountHooks();
+			return 0;
+		}
+	}
+
+	lua_rawset(L, 1);
+	return 0;
+}
+
+/**
+ * @brief Sets up the callback references of a new VM, must be called before the script runs
+ * @param[in,out] vm
+ */
+static void G_LuaInitHooks(lua_vm_t *vm)
+{
+	int i;
+
+	for (i = 0; i < LUAHOOK_NUM; i++)
+	{
+		vm->hookRef[i] = LUA_NOREF;
+	}
+	vm->hooksCached = qtrue;
+	G_LuaResetProfile(vm);
+
+	lua_pushglobaltable(vm->L);
+	lua_newtable(vm->L);
+	lua_pushlightuserdata(vm->L, vm);
+	lua_pushcclosure(vm->L, G_LuaGlobalsIndex, 1);
+	lua_setfield(vm->L, -2, "__index");
+	lua_pushlightuserdata(vm->L, vm);
+	lua_pushcclosure(vm->L, G_LuaGlobalsNewIndex, 1);
+	lua_setfield(vm->L, -2, "__newindex");
+	lua_pushvalue(vm->L, -1);
+	vm->globalsMeta = luaL_ref(vm->L, LUA_REGISTRYINDEX);
+	lua_setmetatable(vm->L, -2);
+	lua_pop(vm->L, 1);
+}
+
+/**
+ * @brief Falls back to looking callbacks up by name in VMs whose script replaced
+ * the metatable of _G, the cached callbacks are moved back into _G then
+ */
+static void G_LuaCheckHooks(void)
+{
+	int      i, j;
+	qboolean replaced;
+	lua_vm_t *vm;
+
+	for (i = 0; i < LUA_NUM_VM; i++)
+	{
+		vm = lVM[i];
+		if (!vm || vm->id < 0 || !vm->L || !vm->hooksCached)
+		{
+			continue;
+		}
+
+		lua_pushglobaltable(vm->L);
+		if (lua_getmetatable(vm->L, -1))
+		{
+			lua_rawgeti(vm->L, LUA_REGISTRYINDEX, vm->globalsMeta);
+			replaced = !lua_rawequal(vm->L, -1, -2);
+			lua_pop(vm->L, 2);
+		}
+		else
+		{
+			replaced = qtrue;
+		}
+
+		if (replaced)
+		{
+			G_DPrintf("%s API: %s%s replaced the metatable of _G, looking up its callbacks by name\n", LUA_VERSION, S_COLOR_BLUE, vm->file_name);
+
+			for (j = 0; j < LUAHOOK_NUM; j++)
+			{
+				if (vm->hookRef[j] != LUA_NOREF)
+				{
+					// raw, the __newindex of the script must not run outside a protected call
+					lua_pushstring(vm->L, luaHookNames[j]);
+					lua_rawgeti(vm->L, LUA_REGISTRYINDEX, vm->hookRef[j]);
+					lua_rawset(vm->L, -3);
+					luaL_unref(vm->L, LUA_REGISTRYINDEX, vm->hookRef[j]);
+					vm->hookRef[j] = LUA_NOREF;
+				}
+			}
+			vm->hooksCached = qfalse;
+			G_LuaCountHooks();
+		}
+
+		lua_pop(vm->L, 1);
+	}
+}
+
+/**
+ * @brief Puts a callback of the VM onto the stack
+ * @param[in] vm
+ * @param[in] hook
+ * @return qfalse if the VM doesn't define it
+ */
+qboolean G_LuaGetHookFunction(lua_vm_t *vm, luaHook_t hook)
+{
+	if (!vm->L)
+	{
+		return qfalse;
+	}
+
+	if (vm->overBudget && lua_budgetDefer.integer && G_LuaHookDeferrable(hook))
+	{
+		vm->hookSkipped[hook]++;
+		return qfalse;
+	}
+
+	if (!vm->hooksCached)
+	{
+		return G_LuaGetNamedFunction(vm, luaHookNames[hook]);
+	}
+
+	if (vm->hookRef[hook] == LUA_NOREF)
+	{
+		return qfalse;
+	}
+
+	lua_rawgeti(vm->L, LUA_REGISTRYINDEX, vm->hookRef[hook]);
+	if (!lua_isfunction(vm->L, -1))
+	{
+		lua_pop(vm->L, 1);
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Calls a callback put onto the stack by G_LuaGetHookFunction and accounts its time
+ * @param[in] vm
+ * @param[in] hook
+ * @param[in] nargs
+ * @param[in] nresults
+ * @return
+ */
+qboolean G_LuaCallHook(lua_vm_t *vm, luaHook_t hook, int nargs, int nresults)
+{
+	uint64_t     start = G_LuaMicroseconds();
+	unsigned int elapsed;
+	qboolean     ret;
+	int          bucket;
+
+	ret = G_LuaCall(vm, luaHookNames[hook], nargs, nresults);
+
+	elapsed = (unsigned int)(G_LuaMicroseconds() - start);
+
+	for (bucket = 0; bucket < LUA_PROF_BUCKETS - 1 && elapsed >= luaProfBounds[bucket]; bucket++)
+		;
+
+	vm->hookCalls[hook]++;
+	vm->hookTime[hook] += elapsed;
+	vm->hookHist[hook][bucket]++;
+	if (elapsed > vm->hookMax[hook])
+	{
+		vm->hookMax[hook] = elapsed;
+	}
+
+	vm->frameTime += elapsed;
+	if (lua_budget.value > 0 && vm->frameTime > lua_budget.value * 1000)
+	{
+		vm->overBudget = qtrue;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Closes the profiling frame of each VM and warns about VMs over lua_budget,
+ * called before et_RunFrame
+ */
+static void G_LuaProfileFrame(void)
+{
+	int      i;
+	lua_vm_t *vm;
+
+	for (i = 0; i < LUA_NUM_VM; i++)
+	{
+		vm = lVM[i];
+		if (!vm)
+		{
+			continue;
+		}
+
+		vm->lastFrameTime = vm->frameTime;
+		if (vm->frameTime > vm->peakFrameTime)
+		{
+			vm->peakFrameTime = vm->frameTime;
+		}
+
+		if (lua_budget.value > 0 && vm->frameTime > lua_budget.value * 1000)
+		{
+			vm->overruns++;
+			vm->overBudget = qtrue;
+
+			if (!vm->lastBudgetWarning || level.time - vm->lastBudgetWarning >= 10000)
+			{
+				G_Printf("%s API: %sLua module [%s] [%s] took %.2f ms of the %.2f ms frame budget (%u frames over budget)\n", LUA_VERSION, S_COLOR_BLUE,
+				         vm->file_name, vm->mod_name, vm->frameTime / 1000.0, lua_budget.value, vm->overruns);
+				vm->lastBudgetWarning = level.time;
+			}
+		}
+		else
+		{
+			vm->overBudget = qfalse;
+		}
+
+		vm->frameTime = 0;
+	}
+}
+
+/**
+ * @brief Prints call counts and time spent in the callbacks of each VM,
+ * executed by the "lua_hookstats" server command
+ */
+void G_LuaHookStats(void)
+{
+	char     arg[MAX_TOKEN_CHARS];
+	int      i, j;
+	lua_vm_t *vm;
+
+	trap_Argv(1, arg, sizeof(arg));
+	if (!Q_stricmp(arg, "reset"))
+	{
+		for (i = 0; i < LUA_NUM_VM; i++)
+		{
+			if (lVM[i])
+			{
+				G_LuaResetProfile(lVM[i]);
+			}
+		}
+		G_Printf("%s API: %shook statistics reset\n", LUA_VERSION, S_COLOR_BLUE);
+		return;
+	}
+
+	G_Printf("%-2s %-24s %-26s %10s %12s %10s\n", "VM", "Modname", "Hook", "Calls", "Total ms", "Avg usec");
+	G_Printf("-- ------------------------ -------------------------- ---------- ------------ ----------\n");
+	for (i = 0; i < LUA_NUM_VM; i++)
+	{
+		vm = lVM[i];
+		if (!vm)
+		{
+			continue;
+		}
+
+		for (j = 0; j < LUAHOOK_NUM; j++)
+		{
+			if (!vm->hookCalls[j])
+			{
+				continue;
+			}
+
+			G_Printf("%2d %-24s %-26s %10u %12.2f %10.1f\n", vm->id, vm->mod_name, luaHookNames[j], vm->hookCalls[j],
+			         vm->hookTime[j] / 1000.0, (double)vm->hookTime[j] / vm->hookCalls[j]);
+		}
+	}
+	G_Printf("-- ------------------------ -------------------------- ---------- ------------ ----------\n");
+}
+
+/**
+ * @brief Prints the frame budget use and call time histograms of each VM,
+ * executed by the "lua_profile" server command
+ */
+void G_LuaProfile(void)
+{
+	char     arg[MAX_TOKEN_CHARS];
+	char     line[MAX_STRING_CHARS];
+	int      i, j, k;
+	lua_vm_t *vm;
+
+	trap_Argv(1, arg, sizeof(arg));
+	if (!Q_stricmp(arg, "reset"))
+	{
+		for (i = 0; i < LUA_NUM_VM; i++)
+		{
+			if (lVM[i])
+			{
+				G_LuaResetProfile(lVM[i]);
+			}
+		}
+		G_Printf("%s API: %sprofile reset\n", LUA_VERSION, S_COLOR_BLUE);
+		return;
+	}
+
+	if (lua_budget.value > 0)
+	{
+		G_Printf("%s API: %sframe budget %.2f ms per module%s\n", LUA_VERSION, S_COLOR_BLUE, lua_budget.value,
+		         lua_budgetDefer.integer ? ", non-critical callbacks are skipped when over it" : "");
+	}
+	else
+	{
+		G_Printf("%s API: %sno frame budget set (lua_budget)\n", LUA_VERSION, S_COLOR_BLUE);
+	}
+
+	line[0] = '\0';
+	for (k = 0; k < LUA_PROF_BUCKETS - 1; k++)
+	{
+		Q_strcat(line, sizeof(line), va(" %6s", va("<%u", luaProfBounds[k])));
+	}
+	Q_strcat(line, sizeof(line), va(" %6s", va(">=%u", luaProfBounds[LUA_PROF_BUCKETS - 2])));
+
+	for (i = 0; i < LUA_NUM_VM; i++)
+	{
+		vm = lVM[i];
+		if (!vm)
+		{
+			continue;
+		}
+
+		G_Printf("%2d %-24s %-24s last %.2f ms, peak %.2f ms, %u frames over budget\n", vm->id, vm->mod_name, vm->file_name,
+		         vm->lastFrameTime / 1000.0, vm->peakFrameTime / 1000.0, vm->overruns);
+		G_Printf("   %-26s %8s %8s %8s%s (usec)\n", "Hook", "Calls", "Max", "Skipped", line);
+
+		for (j = 0; j < LUAHOOK_NUM; j++)
+		{
+			if (!vm->hookCalls[j] && !vm->hookSkipped[j])
+			{
+				continue;
+			}
+
+			G_Printf("   %-26s %8u %8u %8u", luaHookNames[j], vm->hookCalls[j], vm->hookMax[j], vm->hookSkipped[j]);
+			for (k = 0; k < LUA_PROF_BUCKETS; k++)
+			{
+				G_Printf(" %6u", vm->hookHist[j][k]);
+			}
+			G_Printf("\n");
+		}
+	}
+}
+
+/**
+ * @brief Pushes the profile of a VM as a table, see et.LuaProfile
+ * @param[in] L
+ * @param[in] vm
+ */
+static void G_LuaPushProfile(lua_State *L, lua_vm_t *vm)
+{
+	int i, j;
+
+	lua_newtable(L);
+
+	lua_pushinteger(L, (lua_Integer)vm->lastFrameTime);
+	lua_setfield(L, -2, "lastframe");
+	lua_pushinteger(L, (lua_Integer)vm->peakFrameTime);
+	lua_setfield(L, -2, "peakframe");
+	lua_pushinteger(L, vm->overruns);
+	lua_setfield(L, -2, "overruns");
+	lua_pushinteger(L, (lua_Integer)(lua_budget.value * 1000));
+	lua_setfield(L, -2, "budget");
+
+	lua_newtable(L);
+	for (i = 0; i < LUA_PROF_BUCKETS - 1; i++)
+	{
+		lua_pushinteger(L, luaProfBounds[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_setfield(L, -2, "buckets");
+
+	lua_newtable(L);
+	for (i = 0; i < LUAHOOK_NUM; i++)
+	{
+		if (!vm->hookCalls[i] && !vm->hookSkipped[i])
+		{
+			continue;
+		}
+
+		lua_newtable(L);
+		lua_pushinteger(L, vm->hookCalls[i]);
+		lua_setfield(L, -2, "calls");
+		lua_pushinteger(L, (lua_Integer)vm->hookTime[i]);
+		lua_setfield(L, -2, "total");
+		lua_pushinteger(L, vm->hookMax[i]);
+		lua_setfield(L, -2, "max");
+		lua_pushinteger(L, vm->hookSkipped[i]);
+		lua_setfield(L, -2, "skipped");
+
+		lua_newtable(L);
+		for (j = 0; j < LUA_PROF_BUCKETS; j++)
+		{
+			lua_pushinteger(L, vm->hookHist[i][j]);
+			lua_rawseti(L, -2, j + 1);
+		}
+		lua_setfield(L, -2, "histogram");
+
+		lua_setfield(L, -2, luaHookNames[i]);
+	}
+	lua_setfield(L, -2, "hooks");
+}
+
 /**
  * @brief Dump the lua stack to console
  *        Executed by the ingame "lua_api" command
@@ -3405,6 +4061,8 @@ qboolean G_LuaStartVM(lua_vm_t *vm)
 	lua_pushvalue(vm->L, -1);
 	lua_setglobal(vm->L, "et");
 
+	G_LuaInitHooks(vm);
+
 	res = luaL_loadbuffer(vm->L, vm->code, vm->code_size, vm->file_name);
 
 	switch (res)
@@ -3456,9 +4114,9 @@ void G_LuaStopVM(lua_vm_t *vm)
 	}
 	if (vm->L)
 	{
-		if (G_LuaGetNamedFunction(vm, "et_Quit"))
+		if (G_LuaGetHookFunction(vm, LUAHOOK_QUIT))
 		{
-			G_LuaCall(vm, "et_Quit", 0, 0);
+			G_LuaCallHook(vm, LUAHOOK_QUIT, 0, 0);
 		}
 		lua_close(vm->L);
 		vm->L = NULL;
@@ -3468,6 +4126,7 @@ void G_LuaStopVM(lua_vm_t *vm)
 		if (lVM[vm->id] == vm)
 		{
 			lVM[vm->id] = NULL;
+			G_LuaCountHooks();
 		}
 		if (!vm->err)
 		{
@@ -3599,6 +4258,11 @@ void G_LuaHook_InitGame(int levelTime, int randomSeed, int restart)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_INITGAME])
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3608,7 +4272,7 @@ void G_LuaHook_InitGame(int levelTime, int randomSeed, int restart)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_InitGame"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_INITGAME))
 			{
 				continue;
 			}
@@ -3617,7 +4281,7 @@ void G_LuaHook_InitGame(int levelTime, int randomSeed, int restart)
 			lua_pushinteger(vm->L, randomSeed);
 			lua_pushinteger(vm->L, restart);
 			// Call
-			if (!G_LuaCall(vm, "et_InitGame", 3, 0))
+			if (!G_LuaCallHook(vm, LUAHOOK_INITGAME, 3, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3637,6 +4301,11 @@ void G_LuaHook_ShutdownGame(int restart)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_SHUTDOWNGAME])
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3646,14 +4315,14 @@ void G_LuaHook_ShutdownGame(int restart)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ShutdownGame"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_SHUTDOWNGAME))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, restart);
 			// Call
-			if (!G_LuaCall(vm, "et_ShutdownGame", 1, 0))
+			if (!G_LuaCallHook(vm, LUAHOOK_SHUTDOWNGAME, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3678,6 +4347,14 @@ void G_LuaHook_RunFrame(int levelTime)
 	int      i;
 	lua_vm_t *vm;
 
+	G_LuaCheckHooks();
+	G_LuaProfileFrame();
+
+	if (!luaHookVMs[LUAHOOK_RUNFRAME])
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3687,14 +4364,14 @@ void G_LuaHook_RunFrame(int levelTime)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_RunFrame"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_RUNFRAME))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, levelTime);
 			// Call
-			if (!G_LuaCall(vm, "et_RunFrame", 1, 0))
+			if (!G_LuaCallHook(vm, LUAHOOK_RUNFRAME, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3717,6 +4394,11 @@ qboolean G_LuaHook_ClientConnect(int clientNum, qboolean firstTime, qboolean isB
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_CLIENTCONNECT])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3726,7 +4408,7 @@ qboolean G_LuaHook_ClientConnect(int clientNum, qboolean firstTime, qboolean isB
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientConnect"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_CLIENTCONNECT))
 			{
 				continue;
 			}
@@ -3735,7 +4417,7 @@ qboolean G_LuaHook_ClientConnect(int clientNum, qboolean firstTime, qboolean isB
 			lua_pushinteger(vm->L, (int)firstTime);
 			lua_pushinteger(vm->L, (int)isBot);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientConnect", 3, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_CLIENTCONNECT, 3, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3764,6 +4446,11 @@ void G_LuaHook_ClientDisconnect(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_CLIENTDISCONNECT])
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3773,14 +4460,14 @@ void G_LuaHook_ClientDisconnect(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientDisconnect"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_CLIENTDISCONNECT))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientDisconnect", 1, 0))
+			if (!G_LuaCallHook(vm, LUAHOOK_CLIENTDISCONNECT, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3800,6 +4487,11 @@ void G_LuaHook_ClientBegin(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_CLIENTBEGIN])
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3809,14 +4501,14 @@ void G_LuaHook_ClientBegin(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientBegin"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_CLIENTBEGIN))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientBegin", 1, 0))
+			if (!G_LuaCallHook(vm, LUAHOOK_CLIENTBEGIN, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3838,6 +4530,11 @@ void G_LuaHook_ClientUserinfoChanged(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_CLIENTUSERINFOCHANGED])
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3847,14 +4544,14 @@ void G_LuaHook_ClientUserinfoChanged(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientUserinfoChanged"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_CLIENTUSERINFOCHANGED))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientUserinfoChanged", 1, 0))
+			if (!G_LuaCallHook(vm, LUAHOOK_CLIENTUSERINFOCHANGED, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3877,6 +4574,11 @@ void G_LuaHook_ClientSpawn(int clientNum, qboolean revived, qboolean teamChange,
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_CLIENTSPAWN])
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3886,7 +4588,7 @@ void G_LuaHook_ClientSpawn(int clientNum, qboolean revived, qboolean teamChange,
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientSpawn"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_CLIENTSPAWN))
 			{
 				continue;
 			}
@@ -3896,7 +4598,7 @@ void G_LuaHook_ClientSpawn(int clientNum, qboolean revived, qboolean teamChange,
 			lua_pushinteger(vm->L, (int)teamChange);
 			lua_pushinteger(vm->L, (int)restoreHealth);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientSpawn", 4, 0))
+			if (!G_LuaCallHook(vm, LUAHOOK_CLIENTSPAWN, 4, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3920,6 +4622,11 @@ qboolean G_LuaHook_ClientCommand(int clientNum, char *command)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_CLIENTCOMMAND])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3929,7 +4636,7 @@ qboolean G_LuaHook_ClientCommand(int clientNum, char *command)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientCommand"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_CLIENTCOMMAND))
 			{
 				continue;
 			}
@@ -3937,7 +4644,7 @@ qboolean G_LuaHook_ClientCommand(int clientNum, char *command)
 			lua_pushinteger(vm->L, clientNum);
 			lua_pushstring(vm->L, command);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientCommand", 2, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_CLIENTCOMMAND, 2, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3971,6 +4678,11 @@ qboolean G_LuaHook_ConsoleCommand(char *command)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_CONSOLECOMMAND])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3980,14 +4692,14 @@ qboolean G_LuaHook_ConsoleCommand(char *command)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ConsoleCommand"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_CONSOLECOMMAND))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushstring(vm->L, command);
 			// Call
-			if (!G_LuaCall(vm, "et_ConsoleCommand", 1, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_CONSOLECOMMAND, 1, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -4020,6 +4732,11 @@ qboolean G_LuaHook_UpgradeSkill(int cno, skillType_t skill)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_UPGRADESKILL])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4029,7 +4746,7 @@ qboolean G_LuaHook_UpgradeSkill(int cno, skillType_t skill)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_UpgradeSkill"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_UPGRADESKILL))
 			{
 				continue;
 			}
@@ -4037,7 +4754,7 @@ qboolean G_LuaHook_UpgradeSkill(int cno, skillType_t skill)
 			lua_pushinteger(vm->L, cno);
 			lua_pushinteger(vm->L, (int)skill);
 			// Call
-			if (!G_LuaCall(vm, "et_UpgradeSkill", 2, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_UPGRADESKILL, 2, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -4070,6 +4787,11 @@ qboolean G_LuaHook_SetPlayerSkill(int cno, skillType_t skill)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_SETPLAYERSKILL])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4079,7 +4801,7 @@ qboolean G_LuaHook_SetPlayerSkill(int cno, skillType_t skill)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_SetPlayerSkill"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_SETPLAYERSKILL))
 			{
 				continue;
 			}
@@ -4087,7 +4809,7 @@ qboolean G_LuaHook_SetPlayerSkill(int cno, skillType_t skill)
 			lua_pushinteger(vm->L, cno);
 			lua_pushinteger(vm->L, (int)skill);
 			// Call
-			if (!G_LuaCall(vm, "et_SetPlayerSkill", 2, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_SETPLAYERSKILL, 2, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -4109,9 +4831,9 @@ qboolean G_LuaHook_SetPlayerSkill(int cno, skillType_t skill)
 
 static luaPrintFunctions_t g_luaPrintFunctions[] =
 {
-	{ GPRINT_TEXT,      "et_Print"  },
-	{ GPRINT_DEVELOPER, "et_DPrint" },
-	{ GPRINT_ERROR,     "et_Error"  }
+	{ GPRINT_TEXT,      "et_Print",  LUAHOOK_PRINT  },
+	{ GPRINT_DEVELOPER, "et_DPrint", LUAHOOK_DPRINT },
+	{ GPRINT_ERROR,     "et_Error",  LUAHOOK_ERROR  }
 };
 
 /**
@@ -4128,6 +4850,11 @@ void G_LuaHook_Print(printMessageType_t category, char *text)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[g_luaPrintFunctions[category].hook])
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4137,14 +4864,14 @@ void G_LuaHook_Print(printMessageType_t category, char *text)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, g_luaPrintFunctions[category].function))
+			if (!G_LuaGetHookFunction(vm, g_luaPrintFunctions[category].hook))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushstring(vm->L, text);
 			// Call
-			if (!G_LuaCall(vm, g_luaPrintFunctions[category].function, 1, 0))
+			if (!G_LuaCallHook(vm, g_luaPrintFunctions[category].hook, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -4170,6 +4897,11 @@ qboolean G_LuaHook_Obituary(int victim, int killer, int meansOfDeath)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_OBITUARY])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4179,7 +4911,7 @@ qboolean G_LuaHook_Obituary(int victim, int killer, int meansOfDeath)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_Obituary"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_OBITUARY))
 			{
 				continue;
 			}
@@ -4189,7 +4921,7 @@ qboolean G_LuaHook_Obituary(int victim, int killer, int meansOfDeath)
 			lua_pushinteger(vm->L, meansOfDeath);
 
 			// Call
-			if (!G_LuaCall(vm, "et_Obituary", 3, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_OBITUARY, 3, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -4219,6 +4951,11 @@ qboolean G_LuaHook_Revive(int revivee, int reviver, int invulnEndTime)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_REVIVE])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4228,7 +4965,7 @@ qboolean G_LuaHook_Revive(int revivee, int reviver, int invulnEndTime)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_Revive"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_REVIVE))
 			{
 				continue;
 			}
@@ -4237,7 +4974,7 @@ qboolean G_LuaHook_Revive(int revivee, int reviver, int invulnEndTime)
 			lua_pushinteger(vm->L, reviver);
 			lua_pushinteger(vm->L, invulnEndTime);
 			// Call
-			if (!G_LuaCall(vm, "et_Revive", 3, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_REVIVE, 3, 1))
 			{
 				continue;
 			}
@@ -4268,6 +5005,11 @@ qboolean G_LuaHook_Damage(int target, int attacker, int damage, int dflags, mean
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_DAMAGE])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4277,7 +5019,7 @@ qboolean G_LuaHook_Damage(int target, int attacker, int damage, int dflags, mean
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_Damage"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_DAMAGE))
 			{
 				continue;
 			}
@@ -4288,7 +5030,7 @@ qboolean G_LuaHook_Damage(int target, int attacker, int damage, int dflags, mean
 			lua_pushinteger(vm->L, dflags);
 			lua_pushinteger(vm->L, mod);
 			// Call
-			if (!G_LuaCall(vm, "et_Damage", 5, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_DAMAGE, 5, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -4318,6 +5060,11 @@ qboolean G_LuaHook_WeaponFire(int clientNum, weapon_t weapon, gentity_t **pFired
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_WEAPONFIRE])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4327,7 +5074,7 @@ qboolean G_LuaHook_WeaponFire(int clientNum, weapon_t weapon, gentity_t **pFired
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_WeaponFire"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_WEAPONFIRE))
 			{
 				continue;
 			}
@@ -4335,7 +5082,7 @@ qboolean G_LuaHook_WeaponFire(int clientNum, weapon_t weapon, gentity_t **pFired
 			lua_pushinteger(vm->L, clientNum);
 			lua_pushinteger(vm->L, weapon);
 			// Call
-			if (!G_LuaCall(vm, "et_WeaponFire", 2, 2))
+			if (!G_LuaCallHook(vm, LUAHOOK_WEAPONFIRE, 2, 2))
 			{
 				continue;
 			}
@@ -4371,6 +5118,11 @@ qboolean G_LuaHook_FixedMGFire(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_FIXEDMGFIRE])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4380,14 +5132,14 @@ qboolean G_LuaHook_FixedMGFire(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_FixedMGFire"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_FIXEDMGFIRE))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_FixedMGFire", 1, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_FIXEDMGFIRE, 1, 1))
 			{
 				continue;
 			}
@@ -4415,6 +5167,11 @@ qboolean G_LuaHook_MountedMGFire(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_MOUNTEDMGFIRE])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4424,14 +5181,14 @@ qboolean G_LuaHook_MountedMGFire(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_MountedMGFire"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_MOUNTEDMGFIRE))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_MountedMGFire", 1, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_MOUNTEDMGFIRE, 1, 1))
 			{
 				continue;
 			}
@@ -4461,6 +5218,11 @@ qboolean G_LuaHook_AAGunFire(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_AAGUNFIRE])
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4470,14 +5232,14 @@ qboolean G_LuaHook_AAGunFire(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_AAGunFire"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_AAGUNFIRE))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_AAGunFire", 1, 1))
+			if (!G_LuaCallHook(vm, LUAHOOK_AAGUNFIRE, 1, 1))
 			{
 				continue;
 			}
@@ -4503,6 +5265,11 @@ void G_LuaHook_SpawnEntitiesFromString()
 	int      i;
 	lua_vm_t *vm;
 
+	if (!luaHookVMs[LUAHOOK_SPAWNENTITIESFROMSTRING])
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4512,13 +5279,13 @@ void G_LuaHook_SpawnEntitiesFromString()
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_SpawnEntitiesFromString"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_SPAWNENTITIESFROMSTRING))
 			{
 				continue;
 			}
 
 			// Call
-			if (!G_LuaCall(vm, "et_SpawnEntitiesFromString", 0, 0))
+			if (!G_LuaCallHook(vm, LUAHOOK_SPAWNENTITIESFROMSTRING, 0, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -4549,6 +5316,11 @@ const char *G_LuaHook_Chat(int sender, int receiver, const char *message, char *
 	const char *result, *newMessage;
 
 	newMessage = message;
+	if (!luaHookVMs[LUAHOOK_CHAT])
+	{
+		return newMessage;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -4558,7 +5330,7 @@ const char *G_LuaHook_Chat(int sender, int receiver, const char *message, char *
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_Chat"))
+			if (!G_LuaGetHookFunction(vm, LUAHOOK_CHAT))
 			{
 				continue;
 			}
@@ -4567,7 +5339,7 @@ const char *G_LuaHook_Chat(int sender, int receiver, const char *message, char *
 			lua_pushinteger(vm->L, receiver);
 			lua_pushstring(vm->L, newMessage);
 			// Call
-			if (!G_LuaCall(vm, "et_Chat", 3, 2))
+			if (!G_LuaCallHook(vm, LUAHOOK_CHAT, 3, 2))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -34,6 +34,7 @@
 
 #define LUA_NUM_VM 64
 #define LUA_MAX_FSIZE 1024 * 1024 ///< 1MB
+#define LUA_PROF_BUCKETS 11       ///< call time histogram buckets, see luaProfBounds
 
 #define FIELD_INT           0
 #define FIELD_STRING        1
@@ -76,6 +77,42 @@
 #define _et_gclient_addfield(n, t, f) { #n, t, offsetof(struct gclient_s, n), FIELD_FLAG_GCLIENT + f }
 #define _et_gclient_addfieldalias(n, a, t, f) { #n, t, offsetof(struct gclient_s, a), FIELD_FLAG_GCLIENT + f }
 
+/**
+ * @enum luaHook_e
+ * @typedef luaHook_t
+ * @brief Callbacks a module can define, resolved once per VM (see G_LuaGetHookFunction)
+ */
+typedef enum luaHook_e
+{
+	LUAHOOK_IPCRECEIVE = 0,
+	LUAHOOK_QUIT,
+	LUAHOOK_INITGAME,
+	LUAHOOK_SHUTDOWNGAME,
+	LUAHOOK_RUNFRAME,
+	LUAHOOK_CLIENTCONNECT,
+	LUAHOOK_CLIENTDISCONNECT,
+	LUAHOOK_CLIENTBEGIN,
+	LUAHOOK_CLIENTUSERINFOCHANGED,
+	LUAHOOK_CLIENTSPAWN,
+	LUAHOOK_CLIENTCOMMAND,
+	LUAHOOK_CONSOLECOMMAND,
+	LUAHOOK_UPGRADESKILL,
+	LUAHOOK_SETPLAYERSKILL,
+	LUAHOOK_PRINT,
+	LUAHOOK_DPRINT,
+	LUAHOOK_ERROR,
+	LUAHOOK_OBITUARY,
+	LUAHOOK_REVIVE,
+	LUAHOOK_DAMAGE,
+	LUAHOOK_WEAPONFIRE,
+	LUAHOOK_FIXEDMGFIRE,
+	LUAHOOK_MOUNTEDMGFIRE,
+	LUAHOOK_AAGUNFIRE,
+	LUAHOOK_SPAWNENTITIESFROMSTRING,
+	LUAHOOK_CHAT,
+	LUAHOOK_NUM
+} luaHook_t;
+
 /**
  * @struct lua_vm_s
  * @brief
@@ -90,6 +127,22 @@ typedef struct
 	int code_size;
 	int err;
 	lua_State *L;
+
+	qboolean hooksCached;                      ///< qfalse once the script replaced the metatable of _G, callbacks are looked up by name then
+	int globalsMeta;                           ///< registry reference of the _G metatable routing the callbacks
+	int hookRef[LUAHOOK_NUM];                  ///< registry references of the callbacks, LUA_NOREF if not defined
+	unsigned int hookCalls[LUAHOOK_NUM];
+	uint64_t hookTime[LUAHOOK_NUM];            ///< microseconds spent in the callbacks
+	unsigned int hookMax[LUAHOOK_NUM];         ///< longest call in microseconds
+	unsigned int hookSkipped[LUAHOOK_NUM];     ///< calls left out while over the frame budget
+	unsigned int hookHist[LUAHOOK_NUM][LUA_PROF_BUCKETS];
+
+	uint64_t frameTime;                        ///< microseconds spent in callbacks since the last et_RunFrame
+	uint64_t lastFrameTime;
+	uint64_t peakFrameTime;
+	unsigned int overruns;                     ///< frames over lua_budget
+	int lastBudgetWarning;                     ///< level.time of the last budget warning
+	qboolean overBudget;                       ///< non-critical callbacks are skipped while set and lua_budgetDefer is on
 } lua_vm_t;
 
 /**
@@ -127,18 +180,23 @@ typedef struct luaPrintFunctions_s
 {
 	printMessageType_t category;
 	const char *function;
+	luaHook_t hook;
 } luaPrintFunctions_t;
 
 // API
 qboolean G_LuaInit(void);
 qboolean G_LuaCall(lua_vm_t *vm, const char *func, int nargs, int nresults);
 qboolean G_LuaGetNamedFunction(lua_vm_t *vm, const char *name);
+qboolean G_LuaGetHookFunction(lua_vm_t *vm, luaHook_t hook);
+qboolean G_LuaCallHook(lua_vm_t *vm, luaHook_t hook, int nargs, int nresults);
 qboolean G_LuaStartVM(lua_vm_t *vm);
 qboolean G_LuaRunIsolated(const char *modName);
 void G_LuaStopVM(lua_vm_t *vm);
 void G_LuaShutdown(void);
 void G_LuaRestart(void);
 void G_LuaStatus(gentity_t *ent);
+void G_LuaHookStats(void);
+void G_LuaProfile(void);
 void G_LuaStackDump();
 lua_vm_t *G_LuaGetVM(lua_State *L);
 
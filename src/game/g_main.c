@@ -270,6 +270,8 @@ vmCvar_t g_maxWarp;
 vmCvar_t lua_modules;
 vmCvar_t lua_allowedModules;
 vmCvar_t g_luaModuleList;
+vmCvar_t lua_budget;
+vmCvar_t lua_budgetDefer;
 #endif
 
 vmCvar_t g_guidCheck;
@@ -604,6 +606,8 @@ cvarTable_t gameCvarTable[] =
 	{ &lua_modules,                       "lua_modules",                       "",                           0,                                               0, qfalse, qfalse },
 	{ &lua_allowedModules,                "lua_allowedModules",                "",                           0,                                               0, qfalse, qfalse },
 	{ &g_luaModuleList,                   "g_luaModuleList",                   "",                           0,                                               0, qfalse, qfalse },
+	{ &lua_budget,                        "lua_budget",                        "0",                          0,                                               0, qfalse, qfalse },
+	{ &lua_budgetDefer,                   "lua_budgetDefer",                   "0",                          0,                                               0, qfalse, qfalse },
 #endif
 
 	{ &g_guidCheck,                       "g_guidCheck",                       "1",                          CVAR_ARCHIVE,                                    0, qfalse, qfalse },
@@ -715,6 +719,7 @@ int dll_com_trapGetValue;
 int dll_trap_DemoSupport;
 int dll_trap_SnapshotCallbackExt;
 int dll_trap_SnapshotSetClientMask;
+int dll_trap_Cvar_GetModified;
 
 /**
  * @brief G_SnapshotCallbackExt
@@ -1636,6 +1641,8 @@ void G_SetTargetName(gentity_t *ent, char *targetname)
 	{
 		ent->targetnamehash = -1;
 	}
+
+	G_MarkEntityIndexDirty(ent);
 }
 
 /**
@@ -1824,6 +1831,7 @@ void G_FindTeams(void)
 					if (Q_stricmp(e2->classname, "func_door_rotating"))
 					{
 						e2->targetname = NULL;
+						G_MarkEntityIndexDirty(e2);
 					}
 				}
 			}
@@ -1844,6 +1852,9 @@ void G_ServerCheck(void)
 	}
 }
 
+/// position in the engine cvar change log, -1 updates the whole gameCvarTable
+static int cvarChangeSequence = -1;
+
 /**
  * @brief G_RegisterCvars
  */
@@ -1853,6 +1864,7 @@ void G_RegisterCvars(void)
 	cvarTable_t *cv;
 
 	level.server_settings = 0;
+	cvarChangeSequence    = -1;
 
 	G_Printf("%d cvars in use\n", gameCvarTableSize);
 
@@ -1911,10 +1923,19 @@ void G_UpdateCvars(void)
 	qboolean    chargetimechanged  = qfalse;
 	qboolean    clsweaprestriction = qfalse;
 	qboolean    skillLevelPoints   = qfalse;
+	int         changed[MAX_CVAR_CHANGES];
+	int         numChanged;
+
+	// only look at the cvars changed since the last call
+	numChanged = trap_Cvar_GetModified(&cvarChangeSequence, changed, MAX_CVAR_CHANGES);
+	if (!numChanged)
+	{
+		return;
+	}
 
 	for (i = 0, cv = gameCvarTable ; i < gameCvarTableSize ; i++, cv++)
 	{
-		if (cv->vmCvar)
+		if (cv->vmCvar && Com_CvarModified(cv->vmCvar, changed, numChanged))
 		{
 			trap_Cvar_Update(cv->vmCvar);
 
@@ -2382,6 +2403,7 @@ static ID_INLINE void G_SetupExtensions(void)
 		G_SetupExtensionTrap(value, MAX_CVAR_VALUE_STRING, &dll_trap_DemoSupport, "trap_DemoSupport_Legacy");
 		G_SetupExtensionTrap(value, MAX_CVAR_VALUE_STRING, &dll_trap_SnapshotCallbackExt, "trap_SnapshotCallbackExt_Legacy");
 		G_SetupExtensionTrap(value, MAX_CVAR_VALUE_STRING, &dll_trap_SnapshotSetClientMask, "trap_SnapshotSetClientMask_Legacy");
+		G_SetupExtensionTrap(value, MAX_CVAR_VALUE_STRING, &dll_trap_Cvar_GetModified, "trap_Cvar_GetModified_Legacy");
 	}
 }
 
@@ -2434,6 +2456,9 @@ void G_InitGame(int levelTime, int randomSeed, int restart, int etLegacyServer,
 
 	G_InitMemory();
 
+	// configstrings may have been cleared or changed since the last map
+	G_ResetConfigstringIndexes();
+
 	G_InitSkillLevels();
 
 	// intialize gamestate
@@ -2670,6 +2695,8 @@ void G_InitGame(int levelTime, int randomSeed, int restart, int etLegacyServer,
 
 	// initialize all entities for this game
 	Com_Memset(g_entities, 0, MAX_GENTITIES * sizeof(g_entities[0]));
+	G_ResetEntityIndex();
+	G_ResetLandMineGrid();
 	level.gentities = g_entities;
 
 	// initialize all clients for this game
@@ -3117,6 +3144,51 @@ void etpro_PlayerInfo(void)
 	trap_Cvar_Set("P", playerinfo);
 }
 
+/**
+ * @brief Publishes the ranks after level.sortedClients has been updated
+ */
+static void UpdateRanks(void)
+{
+	int       i;
+	gclient_t *cl;
+
+	// set the rank value for all clients that are connected and not spectators
+	// in team games, rank is just the order of the teams, 0=red, 1=blue, 2=tied
+	for (i = 0; i < level.numConnectedClients; i++)
+	{
+		cl = &level.clients[level.sortedClients[i]];
+		if (level.teamScores[TEAM_AXIS] == level.teamScores[TEAM_ALLIES])
+		{
+			cl->ps.persistant[PERS_RANK] = 2;
+		}
+		else if (level.teamScores[TEAM_AXIS] > level.teamScores[TEAM_ALLIES])
+		{
+			cl->ps.persistant[PERS_RANK] = 0;
+		}
+		else
+		{
+			cl->ps.persistant[PERS_RANK] = 1;
+		}
+	}
+
+	trap_SetConfigstring(CS_FIRSTBLOOD, va("%i", level.firstbloodTeam));
+	trap_SetConfigstring(CS_ROUNDSCORES1, va("%i", g_axiswins.integer));
+	trap_SetConfigstring(CS_ROUNDSCORES2, va("%i", g_alliedwins.integer));
+
+	etpro_PlayerInfo();
+
+	// if we are at the intermission, send the new info to everyone
+	if (g_gamestate.integer == GS_INTERMISSION)
+	{
+		SendScoreboardMessageToAllClients();
+	}
+	else
+	{
+		// see if it is time to end the level
+		CheckExitRules();
+	}
+}
+
 /**
  * @brief Recalculates the score ranks of all players.
  * This will be called on every client connect, begin, disconnect, death,
@@ -3124,9 +3196,8 @@ void etpro_PlayerInfo(void)
  */
 void CalculateRanks(void)
 {
-	int       i;
-	char      teaminfo[TEAM_NUM_TEAMS][256];
-	gclient_t *cl;
+	int  i;
+	char teaminfo[TEAM_NUM_TEAMS][256];
 
 	level.numConnectedClients       = 0;
 	level.numHumanConnectedClients  = 0;
@@ -3231,43 +3302,76 @@ void CalculateRanks(void)
 	qsort(level.sortedClients, level.numConnectedClients,
 	      sizeof(level.sortedClients[0]), SortRanks);
 
-	// set the rank value for all clients that are connected and not spectators
-	// in team games, rank is just the order of the teams, 0=red, 1=blue, 2=tied
-	for (i = 0; i < level.numConnectedClients; i++)
+	level.ranksQueued = qfalse;
+	level.ranksResort = qfalse;
+
+	UpdateRanks();
+}
+
+/**
+ * @brief Restores the order of level.sortedClients after score changes
+ *
+ * An insertion sort over the whole list, so any number of changed clients
+ * end up in the right place, while the unchanged ones only cost a compare.
+ */
+static void ResortRanks(void)
+{
+	int i, j, clientNum;
+
+	for (i = 1; i < level.numConnectedClients; i++)
 	{
-		cl = &level.clients[level.sortedClients[i]];
-		if (level.teamScores[TEAM_AXIS] == level.teamScores[TEAM_ALLIES])
+		clientNum = level.sortedClients[i];
+		for (j = i; j > 0 && SortRanks(&clientNum, &level.sortedClients[j - 1]) < 0; j--)
 		{
-			cl->ps.persistant[PERS_RANK] = 2;
-		}
-		else if (level.teamScores[TEAM_AXIS] > level.teamScores[TEAM_ALLIES])
-		{
-			cl->ps.persistant[PERS_RANK] = 0;
-		}
-		else
-		{
-			cl->ps.persistant[PERS_RANK] = 1;
+			level.sortedClients[j] = level.sortedClients[j - 1];
 		}
+		level.sortedClients[j] = clientNum;
 	}
+}
 
-	trap_SetConfigstring(CS_FIRSTBLOOD, va("%i", level.firstbloodTeam));
-	trap_SetConfigstring(CS_ROUNDSCORES1, va("%i", g_axiswins.integer));
-	trap_SetConfigstring(CS_ROUNDSCORES2, va("%i", g_alliedwins.integer));
-
-	etpro_PlayerInfo();
-
-	// if we are at the intermission, send the new info to everyone
-	if (g_gamestate.integer == GS_INTERMISSION)
+/**
+ * @brief Requests a CalculateRanks at the end of the frame, so several score changes
+ * in one frame only cause one update and one scoreboard broadcast
+ * @param[in] client The only client whose score changed, or NULL if the player
+ * counts have to be rebuilt too (deaths, revives)
+ *
+ * @note Connects, disconnects and team changes still have to call CalculateRanks directly.
+ */
+void QueueCalculateRanks(gclient_t *client)
+{
+	if (client)
 	{
-		SendScoreboardMessageToAllClients();
+		level.ranksResort = qtrue;
 	}
 	else
 	{
-		// see if it is time to end the level
-		CheckExitRules();
+		level.ranksQueued = qtrue;
 	}
 }
 
+/**
+ * @brief Runs the rank updates queued during this frame
+ */
+void CheckQueuedRanks(void)
+{
+	if (level.ranksQueued)
+	{
+		CalculateRanks();
+		return;
+	}
+
+	if (!level.ranksResort)
+	{
+		return;
+	}
+
+	ResortRanks();
+
+	level.ranksResort = qfalse;
+
+	UpdateRanks();
+}
+
 /*
 ========================================================================
 MAP CHANGING
@@ -5581,6 +5685,9 @@ void G_RunFrame(int levelTime)
 		g_entities[i].runthisframe = qfalse;
 	}
 
+	// pick up classname and targetname changes made outside of G_Spawn and G_SetTargetName
+	G_SyncEntityIndex();
+
 	// go through all allocated objects
 	for (i = 0; i < level.num_entities; i++)
 	{
@@ -5592,6 +5699,9 @@ void G_RunFrame(int levelTime)
 		ClientEndFrame(&g_entities[level.sortedClients[i]]);
 	}
 
+	// score changes of this frame
+	CheckQueuedRanks();
+
 	CheckWolfMP();
 
 	// see if it is time to end the level
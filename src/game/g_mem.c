@@ -30,48 +30,276 @@
  */
 /**
  * @file g_mem.c
+ * @brief Game module memory
+ *
+ * A static pool which is bump allocated and reset by G_InitMemory. The game
+ * module is reloaded on every map load and map_restart, so that is the only
+ * lifetime most game memory has.
+ *
+ * Allocations made while an entity is set as owner (see G_SetMemoryOwner) are
+ * the exception. They carry a header, are rounded up to a size class and are
+ * put on a free list when the entity is freed in G_FreeEntity, so entities
+ * created mid-round by scripts or Lua don't leak their strings and script events.
+ * Everything else is allocated without any overhead.
  */
 
 #include "g_local.h"
 
-#define POOLSIZE    (16 * 1024 * 1024) // up to 32 if required
+#define POOLSIZE            (16 * 1024 * 1024) // up to 32 if required
 
-static char memoryPool[POOLSIZE];
-static unsigned int  allocPoint;
+#define GMEM_HEADERSIZE     32
+#define GMEM_NUMCLASSES     6                       // 64 .. 2048 bytes, header included
+#define GMEM_CLASSSIZE(c)   (64u << (c))
+#define GMEM_LARGE          0xff                    // sizeClass of allocations above the biggest size class
+#define GMEM_MAGIC          0x6d47
+#define GMEM_MAGIC_FREE     0x6647
+#define GMEM_NOOWNER        -1
 
 /**
- * @brief G_Alloc
- * @param[in] size
+ * @union gMemHeader_u
+ * @typedef gMemHeader_t
+ * @brief Placed in front of owned allocations, padded to keep the 32 byte alignment of G_Alloc
+ */
+typedef union gMemHeader_u
+{
+	struct
+	{
+		union gMemHeader_u *next;   ///< free list or owner list link
+		unsigned int size;          ///< usable bytes behind the header
+		unsigned short magic;
+		unsigned char sizeClass;
+		unsigned char pad;
+	} h;
+	char pad[GMEM_HEADERSIZE];
+} gMemHeader_t;
+
+static union
+{
+	char bytes[POOLSIZE];
+	gMemHeader_t align;
+} memoryPool;
+
+static unsigned int allocPoint;
+
+static gMemHeader_t *freeList[GMEM_NUMCLASSES];
+static gMemHeader_t *largeFree;                     ///< freed owned allocations above the biggest size class
+static gMemHeader_t *ownedMemory[MAX_GENTITIES];
+static int          memOwner = GMEM_NOOWNER;
+
+// statistics, see Svcmd_GameMem_f
+static unsigned int allocs;
+static unsigned int ownedAllocs;
+static unsigned int ownedUsed;                      ///< bytes of live owned allocations, headers included
+static unsigned int ownedPeak;
+static unsigned int freeBytes;                      ///< bytes waiting on the free lists
+static unsigned int frees;
+static unsigned int reused;                         ///< owned allocations served from a free list
+
+/**
+ * @brief Bump allocates from the pool
+ * @param[in] size Already rounded to 32 bytes
+ * @param[in] requested Size asked for, for the error message
  * @return
  */
-void *G_Alloc(unsigned int size)
+static char *G_MemBump(unsigned int size, unsigned int requested)
 {
 	char *p;
 
 	if (g_debugAlloc.integer)
 	{
-		G_Printf("G_Alloc of %i bytes (%i bytes left)\n", size, POOLSIZE - allocPoint - ((size + 31) & ~31u));
+		G_Printf("G_Alloc of %i bytes (%i bytes left)\n", requested, POOLSIZE - allocPoint - size);
 	}
 
 	if (allocPoint + size > POOLSIZE)
 	{
-		G_Error("G_Alloc: failed on allocation of %u bytes\n", size);
+		G_Error("G_Alloc: failed on allocation of %u bytes\n", requested);
 		return NULL;
 	}
 
-	p = &memoryPool[allocPoint];
-
-	allocPoint += (size + 31) & ~31u;
+	p           = &memoryPool.bytes[allocPoint];
+	allocPoint += size;
 
 	return p;
 }
 
+/**
+ * @brief Allocates memory for the current owner, reusing freed memory of the same size class
+ * @param[in] size
+ * @return
+ */
+static void *G_OwnedAlloc(unsigned int size)
+{
+	gMemHeader_t *hdr = NULL;
+	gMemHeader_t **link;
+	unsigned int total;
+	int          sizeClass;
+
+	total = (size + GMEM_HEADERSIZE + 31) & ~31u;
+
+	for (sizeClass = 0; sizeClass < GMEM_NUMCLASSES && GMEM_CLASSSIZE(sizeClass) < total; sizeClass++)
+		;
+
+	if (sizeClass < GMEM_NUMCLASSES)
+	{
+		total = GMEM_CLASSSIZE(sizeClass);
+		hdr   = freeList[sizeClass];
+		if (hdr)
+		{
+			freeList[sizeClass] = hdr->h.next;
+		}
+	}
+	else
+	{
+		sizeClass = GMEM_LARGE;
+
+		// first fit, but don't waste more than half of a freed allocation
+		for (link = &largeFree; *link; link = &(*link)->h.next)
+		{
+			unsigned int avail = (*link)->h.size + GMEM_HEADERSIZE;
+
+			if (avail >= total && avail <= total * 2)
+			{
+				hdr   = *link;
+				*link = hdr->h.next;
+				total = avail;
+				break;
+			}
+		}
+	}
+
+	if (hdr)
+	{
+		freeBytes -= total;
+		reused++;
+	}
+	else
+	{
+		hdr = (gMemHeader_t *)G_MemBump(total, size);
+	}
+
+	hdr->h.size      = total - GMEM_HEADERSIZE;
+	hdr->h.magic     = GMEM_MAGIC;
+	hdr->h.sizeClass = (unsigned char)sizeClass;
+
+	hdr->h.next           = ownedMemory[memOwner];
+	ownedMemory[memOwner] = hdr;
+
+	ownedUsed += total;
+	if (ownedUsed > ownedPeak)
+	{
+		ownedPeak = ownedUsed;
+	}
+	ownedAllocs++;
+
+	return hdr + 1;
+}
+
+/**
+ * @brief Allocates memory which is released on the next map load or map_restart,
+ * or when the entity set with G_SetMemoryOwner is freed
+ * @param[in] size
+ * @return
+ */
+void *G_Alloc(unsigned int size)
+{
+	allocs++;
+
+	if (memOwner != GMEM_NOOWNER)
+	{
+		return G_OwnedAlloc(size);
+	}
+
+	return G_MemBump((size + 31) & ~31u, size);
+}
+
+/**
+ * @brief Sets the entity owning the following allocations, they are released when it is freed
+ * @param[in] ent NULL to stop tracking allocations
+ */
+void G_SetMemoryOwner(gentity_t *ent)
+{
+	memOwner = ent ? (int)(ent - g_entities) : GMEM_NOOWNER;
+}
+
+/**
+ * @brief Called by G_Spawn, an entity spawned while another one owns the allocations
+ * may point to memory of its parent, which then has to stay until the pool is reset
+ */
+void G_DisownMemory(void)
+{
+	if (memOwner == GMEM_NOOWNER)
+	{
+		return;
+	}
+
+	ownedMemory[memOwner] = NULL;
+	memOwner              = GMEM_NOOWNER;
+}
+
+/**
+ * @brief Puts the allocations owned by an entity on the free lists
+ * @param[in] ent
+ */
+void G_FreeEntityMemory(gentity_t *ent)
+{
+	int          entityNum = (int)(ent - g_entities);
+	gMemHeader_t *hdr, *next;
+	unsigned int size;
+
+	for (hdr = ownedMemory[entityNum]; hdr; hdr = next)
+	{
+		next = hdr->h.next;
+		size = hdr->h.size + GMEM_HEADERSIZE;
+
+		if (hdr->h.magic != GMEM_MAGIC)
+		{
+			G_Printf(S_COLOR_YELLOW "WARNING G_FreeEntityMemory: damaged game memory block %p\n", (void *)hdr);
+			break;
+		}
+		hdr->h.magic = GMEM_MAGIC_FREE;
+
+		if (hdr->h.sizeClass == GMEM_LARGE)
+		{
+			hdr->h.next = largeFree;
+			largeFree   = hdr;
+		}
+		else
+		{
+			hdr->h.next               = freeList[hdr->h.sizeClass];
+			freeList[hdr->h.sizeClass] = hdr;
+		}
+
+		ownedUsed -= size;
+		freeBytes += size;
+		frees++;
+	}
+	ownedMemory[entityNum] = NULL;
+
+	if (memOwner == entityNum)
+	{
+		memOwner = GMEM_NOOWNER;
+	}
+}
+
 /**
  * @brief G_InitMemory
  */
 void G_InitMemory(void)
 {
 	allocPoint = 0;
+
+	Com_Memset(freeList, 0, sizeof(freeList));
+	largeFree = NULL;
+	Com_Memset(ownedMemory, 0, sizeof(ownedMemory));
+	memOwner = GMEM_NOOWNER;
+
+	allocs      = 0;
+	ownedAllocs = 0;
+	ownedUsed   = 0;
+	ownedPeak   = 0;
+	freeBytes   = 0;
+	frees       = 0;
+	reused      = 0;
 }
 
 /**
@@ -80,4 +308,6 @@ void G_InitMemory(void)
 void Svcmd_GameMem_f(void)
 {
 	G_Printf("Game memory status: %i out of %i bytes allocated - %i bytes free\n", allocPoint, POOLSIZE, POOLSIZE - allocPoint);
+	G_Printf("%u allocations, %u owned by entities: %u bytes live, %u peak, %u on free lists, %u freed, %u reused\n",
+	         allocs, ownedAllocs, ownedUsed, ownedPeak, freeBytes, frees, reused);
 }
@@ -1409,14 +1409,21 @@ int G_CountTeamLandmines(team_t team)
  */
 qboolean G_SweepForLandmines(vec3_t origin, float radius, int team)
 {
-	gentity_t *e = &g_entities[MAX_CLIENTS];
-	int       i;
-	vec3_t    dist;
+	gentity_t *e;
+	int       i, numMines;
+	int       mines[MAX_GENTITIES];
+	vec3_t    dist, mins, maxs;
+
+	VectorSet(mins, origin[0] - radius, origin[1] - radius, origin[2] - radius);
+	VectorSet(maxs, origin[0] + radius, origin[1] + radius, origin[2] + radius);
+	numMines = G_FindLandMines(mins, maxs, mines, MAX_GENTITIES);
 
 	radius *= radius;
 
-	for (i = MAX_CLIENTS; i < level.num_entities; i++, e++)
+	for (i = 0; i < numMines; i++)
 	{
+		e = &g_entities[mines[i]];
+
 		if (!e->inuse)
 		{
 			continue;
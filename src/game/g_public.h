@@ -230,7 +230,8 @@ typedef enum
 
 	G_DEMOSUPPORT,
 	G_SNAPSHOT_CALLBACK_EXT,
-	G_SNAPSHOT_SETCLIENTMASK
+	G_SNAPSHOT_SETCLIENTMASK,
+	G_CVAR_GETMODIFIED          ///< ( int *sequence, int *handles, int maxHandles );
 
 } gameImport_t;
 
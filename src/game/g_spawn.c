@@ -796,6 +796,12 @@ gentity_t *G_SpawnGEntityFromSpawnVars(void)
 
 	ent = G_Spawn(); // get the next free entity
 
+	// entities created mid-round by scripts or Lua give their memory back when freed
+	if (!level.spawning)
+	{
+		G_SetMemoryOwner(ent);
+	}
+
 	for (i = 0 ; i < level.numSpawnVars ; i++)
 	{
 		G_ParseField(level.spawnVars[i][0], level.spawnVars[i][1], ent);
@@ -849,6 +855,8 @@ gentity_t *G_SpawnGEntityFromSpawnVars(void)
 		G_FreeEntity(ent);
 	}
 
+	G_SetMemoryOwner(NULL);
+
 	return ent;
 }
 
@@ -338,7 +338,7 @@ void G_LoseSkillPoints(gentity_t *ent, skillType_t skill, float points, const ch
 	level.teamXP[skill][ent->client->sess.sessionTeam - TEAM_AXIS] -= oldskillpoints - ent->client->sess.skillpoints[skill];
 
 	// prepare scoreboard
-	CalculateRanks();
+	QueueCalculateRanks(ent->client);
 }
 
 /**
@@ -469,7 +469,7 @@ void G_AddSkillPoints(gentity_t *ent, skillType_t skill, float points, const cha
 	}
 
 	// prepare scoreboard
-	CalculateRanks();
+	QueueCalculateRanks(ent->client);
 
 	// debug on demand
 	G_DebugAddSkillPoints(ent, skill, points, reason);
@@ -496,7 +496,7 @@ void G_LoseKillSkillPoints(gentity_t *agressor, gentity_t *victim)
 	}
 
 	// prepare scoreboard
-	CalculateRanks();
+	QueueCalculateRanks(agressor->client);
 }
 
 /**
@@ -555,7 +555,7 @@ void G_AddKillSkillPoints(gentity_t *attacker, meansOfDeath_t mod, hitRegion_t h
 	G_AddSkillPoints(attacker, skillType, points, reason);
 
 	// prepare scoreboard
-	CalculateRanks();
+	QueueCalculateRanks(attacker->client);
 }
 
 /**
@@ -572,7 +572,7 @@ void G_AddKillSkillPointsForDestruction(gentity_t *attacker, meansOfDeath_t mod,
 	}
 
 	// prepare scoreboard
-	CalculateRanks();
+	QueueCalculateRanks(attacker->client);
 }
 
 #define MAX_PLAYERS_ASSIST_TO_REWARDS 4
@@ -2548,6 +2548,8 @@ static consoleCommandTable_t consoleCommandTable[] =
 	{ "csinfo",                     Svcmd_CSInfo_f                },
 	{ "forceteam",                  Svcmd_ForceTeam_f             },
 	{ "game_memory",                Svcmd_GameMem_f               },
+	{ "antilag_bench",              Svcmd_AntilagBench_f          },
+	{ "antilag_stats",              Svcmd_AntilagStats_f          },
 	{ "addip",                      Svcmd_AddIP_f                 },
 	{ "removeip",                   Svcmd_RemoveIP_f              },
 	{ "listip",                     Svcmd_ListIp_f                },
@@ -2639,6 +2641,16 @@ qboolean ConsoleCommand(void)
 		G_LuaStackDump();
 		return qtrue;
 	}
+	else if (!Q_stricmp(cmd, "lua_hookstats"))
+	{
+		G_LuaHookStats();
+		return qtrue;
+	}
+	else if (!Q_stricmp(cmd, "lua_profile"))
+	{
+		G_LuaProfile();
+		return qtrue;
+	}
 	// *LUA* API callbacks
 	else if (G_LuaHook_ConsoleCommand(cmd))
 	{
@@ -285,6 +285,7 @@ void trap_SendServerCommand(int clientNum, const char *text)
 void trap_SetConfigstring(int num, const char *string)
 {
 	SystemCall(G_SET_CONFIGSTRING, num, string);
+	G_ConfigstringIndexChanged(num, string);
 }
 
 /**
@@ -854,3 +855,21 @@ void trap_SnapshotSetClientMask(int clientNum, uint64_t mask)
 		SystemCall(dll_trap_SnapshotSetClientMask, clientNum, PASSUINT64(mask));
 	}
 }
+
+/**
+* @brief Extension for listing the cvars changed since the last call,
+*        so that not every registered cvar has to be updated each frame
+* @param[in,out] sequence
+* @param[out] handles
+* @param[in] maxHandles
+* @return Number of changed cvar handles, -1 if all cvars have to be updated
+*/
+int trap_Cvar_GetModified(int *sequence, int *handles, int maxHandles)
+{
+	if (dll_trap_Cvar_GetModified)
+	{
+		return (int)SystemCall(dll_trap_Cvar_GetModified, sequence, handles, maxHandles);
+	}
+
+	return -1;
+}
@@ -111,6 +111,20 @@ mapEntityData_t *G_FreeMapEntityData(mapEntityData_Team_t *teamList, mapEntityDa
 	mEnt->prev->next = mEnt->next;
 	mEnt->next->prev = mEnt->prev;
 
+	// and from the chain of its entity number
+	if (mEnt->entPrev)
+	{
+		mEnt->entPrev->entNext = mEnt->entNext;
+	}
+	else
+	{
+		teamList->entityMapEntityData[mEnt->entNum] = mEnt->entNext;
+	}
+	if (mEnt->entNext)
+	{
+		mEnt->entNext->entPrev = mEnt->entPrev;
+	}
+
 	// the free list is only singly linked
 	mEnt->next                  = teamList->freeMapEntityData;
 	teamList->freeMapEntityData = mEnt;
@@ -121,9 +135,10 @@ mapEntityData_t *G_FreeMapEntityData(mapEntityData_Team_t *teamList, mapEntityDa
 /**
  * @brief G_AllocMapEntityData
  * @param[in,out] teamList
+ * @param[in] entNum Entity the data belongs to, can't be changed afterwards
  * @return
  */
-mapEntityData_t *G_AllocMapEntityData(mapEntityData_Team_t *teamList)
+mapEntityData_t *G_AllocMapEntityData(mapEntityData_Team_t *teamList, int entNum)
 {
 	mapEntityData_t *mEnt;
 
@@ -133,18 +148,33 @@ mapEntityData_t *G_AllocMapEntityData(mapEntityData_Team_t *teamList)
 		G_Error("G_AllocMapEntityData: out of entities\n");
 	}
 
+	if (entNum < 0 || entNum >= MAX_GENTITIES)
+	{
+		G_Error("G_AllocMapEntityData: bad entity number %i\n", entNum);
+	}
+
 	mEnt                        = teamList->freeMapEntityData;
 	teamList->freeMapEntityData = teamList->freeMapEntityData->next;
 
 	Com_Memset(mEnt, 0, sizeof(*mEnt));
 
 	mEnt->singleClient = -1;
+	mEnt->entNum       = entNum;
 
 	// link into the active list
 	mEnt->next                               = teamList->activeMapEntityData.next;
 	mEnt->prev                               = &teamList->activeMapEntityData;
 	teamList->activeMapEntityData.next->prev = mEnt;
 	teamList->activeMapEntityData.next       = mEnt;
+
+	// and into the chain of its entity number
+	mEnt->entNext = teamList->entityMapEntityData[entNum];
+	if (mEnt->entNext)
+	{
+		mEnt->entNext->entPrev = mEnt;
+	}
+	teamList->entityMapEntityData[entNum] = mEnt;
+
 	return mEnt;
 }
 
@@ -158,13 +188,14 @@ mapEntityData_t *G_FindMapEntityData(mapEntityData_Team_t *teamList, int entNum)
 {
 	mapEntityData_t *mEnt;
 
-	for (mEnt = teamList->activeMapEntityData.next; mEnt && mEnt != &teamList->activeMapEntityData; mEnt = mEnt->next)
+	if (entNum < 0 || entNum >= MAX_GENTITIES)
 	{
-		if (mEnt->singleClient >= 0)
-		{
-			continue;
-		}
-		if (entNum == mEnt->entNum)
+		return NULL;
+	}
+
+	for (mEnt = teamList->entityMapEntityData[entNum]; mEnt; mEnt = mEnt->entNext)
+	{
+		if (mEnt->singleClient < 0)
 		{
 			return mEnt;
 		}
@@ -188,14 +219,19 @@ mapEntityData_t *G_FindMapEntityDataSingleClient(mapEntityData_Team_t *teamList,
 
 	if (start)
 	{
-		mEnt = start->next;
+		// start must be an active entry of the same entity, see callers
+		mEnt = start->entNext;
+	}
+	else if (entNum >= 0 && entNum < MAX_GENTITIES)
+	{
+		mEnt = teamList->entityMapEntityData[entNum];
 	}
 	else
 	{
-		mEnt = teamList->activeMapEntityData.next;
+		return NULL;
 	}
 
-	for ( ; mEnt && mEnt != &teamList->activeMapEntityData; mEnt = mEnt->next)
+	for ( ; mEnt; mEnt = mEnt->entNext)
 	{
 		if (clientNum == -1)
 		{
@@ -208,10 +244,7 @@ mapEntityData_t *G_FindMapEntityDataSingleClient(mapEntityData_Team_t *teamList,
 		{
 			continue;
 		}
-		if (entNum == mEnt->entNum)
-		{
-			return(mEnt);
-		}
+		return(mEnt);
 	}
 
 	// not found
@@ -390,6 +423,210 @@ qboolean G_VisibleFromBinoculars(gentity_t *viewer, gentity_t *ent, vec3_t origi
 	return qtrue;
 }
 
+#define LANDMINE_CELL_SIZE  512.f     ///< cell edge length of the landmine grid
+#define LANDMINE_GRID_CELLS 256         ///< number of hashed cells, must be a power of two
+
+/**
+ * @struct landMineCell_s
+ * @typedef landMineCell_t
+ * @brief Landmines hashed into one cell of the landmine grid
+ */
+typedef struct landMineCell_s
+{
+	int head;                           ///< first entity number in the cell, -1 if empty
+	int count;
+	vec3_t mins, maxs;                  ///< bounds of all mines linked since the cell was last empty
+} landMineCell_t;
+
+static landMineCell_t landMineGrid[LANDMINE_GRID_CELLS];
+static int            landMineNext[MAX_GENTITIES];      ///< next entity number in the same cell, -1 ends the chain
+static int            landMineCell[MAX_GENTITIES];      ///< cell + 1 an entity is linked into, 0 if not linked
+
+/**
+ * @brief G_LandMineCellForPoint
+ * @param[in] origin
+ * @return Hashed grid cell of origin
+ */
+static int G_LandMineCellForPoint(const vec3_t origin)
+{
+	int x = (int)floor(origin[0] / LANDMINE_CELL_SIZE);
+	int y = (int)floor(origin[1] / LANDMINE_CELL_SIZE);
+
+	return ((x * 73856093) ^ (y * 19349663)) & (LANDMINE_GRID_CELLS - 1);
+}
+
+/**
+ * @brief Empties the landmine grid, to be called whenever g_entities is wiped
+ */
+void G_ResetLandMineGrid(void)
+{
+	int i;
+
+	for (i = 0; i < LANDMINE_GRID_CELLS; i++)
+	{
+		landMineGrid[i].head  = -1;
+		landMineGrid[i].count = 0;
+	}
+
+	Com_Memset(landMineCell, 0, sizeof(landMineCell));
+}
+
+/**
+ * @brief Adds an armed landmine to the landmine grid
+ * @param[in] ent
+ *
+ * @note Armed mines don't move, so they are linked once by their current origin
+ */
+void G_LinkLandMine(gentity_t *ent)
+{
+	int            num = ent - g_entities;
+	int            cellNum;
+	landMineCell_t *cell;
+
+	if (landMineCell[num])
+	{
+		return;
+	}
+
+	cellNum = G_LandMineCellForPoint(ent->r.currentOrigin);
+	cell    = &landMineGrid[cellNum];
+
+	if (!cell->count)
+	{
+		VectorCopy(ent->r.currentOrigin, cell->mins);
+		VectorCopy(ent->r.currentOrigin, cell->maxs);
+	}
+	else
+	{
+		AddPointToBounds(ent->r.currentOrigin, cell->mins, cell->maxs);
+	}
+
+	landMineNext[num] = cell->head;
+	landMineCell[num] = cellNum + 1;
+	cell->head        = num;
+	cell->count++;
+}
+
+/**
+ * @brief Removes an entity from the landmine grid, does nothing if it isn't linked
+ * @param[in] ent
+ */
+void G_UnlinkLandMine(gentity_t *ent)
+{
+	int            num = ent - g_entities;
+	int            *link;
+	landMineCell_t *cell;
+
+	if (!landMineCell[num])
+	{
+		return;
+	}
+
+	cell = &landMineGrid[landMineCell[num] - 1];
+
+	for (link = &cell->head; *link != -1; link = &landMineNext[*link])
+	{
+		if (*link == num)
+		{
+			*link = landMineNext[num];
+			cell->count--;
+			break;
+		}
+	}
+
+	landMineCell[num] = 0;
+}
+
+/**
+ * @brief Collects the landmines of all grid cells touching a box
+ * @param[in] mins
+ * @param[in] maxs
+ * @param[out] list Entity numbers, callers still have to check the mines themselves
+ * @param[in] maxcount
+ * @return Number of entity numbers written to list
+ */
+int G_FindLandMines(const vec3_t mins, const vec3_t maxs, int *list, int maxcount)
+{
+	int            i, num, count = 0;
+	landMineCell_t *cell;
+
+	for (i = 0, cell = landMineGrid; i < LANDMINE_GRID_CELLS; i++, cell++)
+	{
+		if (!cell->count)
+		{
+			continue;
+		}
+
+		if (cell->mins[0] > maxs[0] || cell->mins[1] > maxs[1] || cell->mins[2] > maxs[2] ||
+		    cell->maxs[0] < mins[0] || cell->maxs[1] < mins[1] || cell->maxs[2] < mins[2])
+		{
+			continue;
+		}
+
+		for (num = cell->head; num != -1 && count < maxcount; num = landMineNext[num])
+		{
+			list[count++] = num;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * @brief G_CullBox
+ * @param[in] mins
+ * @param[in] maxs
+ * @return true if some part of the box may be inside the current frustum
+ */
+static qboolean G_CullBox(const vec3_t mins, const vec3_t maxs)
+{
+	int    i, j;
+	vec3_t corner;
+
+	for (i = 0; i < 4; i++)
+	{
+		// test the corner furthest along the plane normal
+		for (j = 0; j < 3; j++)
+		{
+			corner[j] = frustum[i].normal[j] >= 0 ? maxs[j] : mins[j];
+		}
+
+		if (DotProduct(corner, frustum[i].normal) - frustum[i].dist <= 0)
+		{
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Collects the landmines of all grid cells touching the current frustum
+ * @param[out] list
+ * @param[in] maxcount
+ * @return Number of entity numbers written to list
+ */
+static int G_FindLandMinesInFrustum(int *list, int maxcount)
+{
+	int            i, num, count = 0;
+	landMineCell_t *cell;
+
+	for (i = 0, cell = landMineGrid; i < LANDMINE_GRID_CELLS; i++, cell++)
+	{
+		if (!cell->count || !G_CullBox(cell->mins, cell->maxs))
+		{
+			continue;
+		}
+
+		for (num = cell->head; num != -1 && count < maxcount; num = landMineNext[num])
+		{
+			list[count++] = num;
+		}
+	}
+
+	return count;
+}
+
 /**
  * @brief G_ResetTeamMapData
  */
@@ -417,8 +654,7 @@ void G_UpdateTeamMapData_Construct(gentity_t *ent)
 		mEnt     = G_FindMapEntityData(teamList, num);
 		if (!mEnt)
 		{
-			mEnt         = G_AllocMapEntityData(teamList);
-			mEnt->entNum = num;
+			mEnt = G_AllocMapEntityData(teamList, num);
 		}
 		VectorCopy(ent->s.pos.trBase, mEnt->org);
 		mEnt->data      = mEnt->entNum; //ent->s.modelindex2;
@@ -447,8 +683,7 @@ void G_UpdateTeamMapData_Construct(gentity_t *ent)
 	mEnt = G_FindMapEntityData(teamList, num);
 	if (!mEnt)
 	{
-		mEnt         = G_AllocMapEntityData(teamList);
-		mEnt->entNum = num;
+		mEnt = G_AllocMapEntityData(teamList, num);
 	}
 	VectorCopy(ent->s.pos.trBase, mEnt->org);
 	mEnt->data      = mEnt->entNum; //ent->s.modelindex2;
@@ -471,8 +706,7 @@ void G_UpdateTeamMapData_Tank(gentity_t *ent)
 
 	if (!mEnt)
 	{
-		mEnt         = G_AllocMapEntityData(teamList);
-		mEnt->entNum = num;
+		mEnt = G_AllocMapEntityData(teamList, num);
 	}
 	VectorCopy(ent->s.pos.trBase, mEnt->org);
 	mEnt->data      = ent->s.modelindex2;
@@ -491,8 +725,7 @@ void G_UpdateTeamMapData_Tank(gentity_t *ent)
 	mEnt     = G_FindMapEntityData(teamList, num);
 	if (!mEnt)
 	{
-		mEnt         = G_AllocMapEntityData(teamList);
-		mEnt->entNum = num;
+		mEnt = G_AllocMapEntityData(teamList, num);
 	}
 	VectorCopy(ent->s.pos.trBase, mEnt->org);
 	mEnt->data      = ent->s.modelindex2;
@@ -524,8 +757,7 @@ void G_UpdateTeamMapData_Destruct(gentity_t *ent)
 		mEnt     = G_FindMapEntityData(teamList, num);
 		if (!mEnt)
 		{
-			mEnt         = G_AllocMapEntityData(teamList);
-			mEnt->entNum = num;
+			mEnt = G_AllocMapEntityData(teamList, num);
 		}
 		VectorCopy(ent->s.pos.trBase, mEnt->org);
 		mEnt->data      = mEnt->entNum; //ent->s.modelindex2;
@@ -543,8 +775,7 @@ void G_UpdateTeamMapData_Destruct(gentity_t *ent)
 				mEnt     = G_FindMapEntityData(teamList, num);
 				if (!mEnt)
 				{
-					mEnt         = G_AllocMapEntityData(teamList);
-					mEnt->entNum = num;
+					mEnt = G_AllocMapEntityData(teamList, num);
 				}
 				VectorCopy(ent->s.pos.trBase, mEnt->org);
 				mEnt->data      = mEnt->entNum; //ent->s.modelindex2;
@@ -560,8 +791,7 @@ void G_UpdateTeamMapData_Destruct(gentity_t *ent)
 			mEnt     = G_FindMapEntityData(teamList, num);
 			if (!mEnt)
 			{
-				mEnt         = G_AllocMapEntityData(teamList);
-				mEnt->entNum = num;
+				mEnt = G_AllocMapEntityData(teamList, num);
 			}
 			VectorCopy(ent->s.pos.trBase, mEnt->org);
 			mEnt->data      = mEnt->entNum;     //ent->s.modelindex2;
@@ -577,8 +807,7 @@ void G_UpdateTeamMapData_Destruct(gentity_t *ent)
 		mEnt     = G_FindMapEntityData(teamList, num);
 		if (!mEnt)
 		{
-			mEnt         = G_AllocMapEntityData(teamList);
-			mEnt->entNum = num;
+			mEnt = G_AllocMapEntityData(teamList, num);
 		}
 		VectorCopy(ent->s.pos.trBase, mEnt->org);
 		mEnt->data      = mEnt->entNum; //ent->s.modelindex2;
@@ -596,8 +825,7 @@ void G_UpdateTeamMapData_Destruct(gentity_t *ent)
 				mEnt     = G_FindMapEntityData(teamList, num);
 				if (!mEnt)
 				{
-					mEnt         = G_AllocMapEntityData(teamList);
-					mEnt->entNum = num;
+					mEnt = G_AllocMapEntityData(teamList, num);
 				}
 				VectorCopy(ent->s.pos.trBase, mEnt->org);
 				mEnt->data      = mEnt->entNum; //ent->s.modelindex2;
@@ -613,8 +841,7 @@ void G_UpdateTeamMapData_Destruct(gentity_t *ent)
 			mEnt     = G_FindMapEntityData(teamList, num);
 			if (!mEnt)
 			{
-				mEnt         = G_AllocMapEntityData(teamList);
-				mEnt->entNum = num;
+				mEnt = G_AllocMapEntityData(teamList, num);
 			}
 			VectorCopy(ent->s.pos.trBase, mEnt->org);
 			mEnt->data      = mEnt->entNum; //ent->s.modelindex2;
@@ -662,8 +889,7 @@ void G_UpdateTeamMapData_Player(gentity_t *ent, qboolean forceAllied, qboolean f
 		mEnt     = G_FindMapEntityData(teamList, num);
 		if (!mEnt)
 		{
-			mEnt         = G_AllocMapEntityData(teamList);
-			mEnt->entNum = num;
+			mEnt = G_AllocMapEntityData(teamList, num);
 		}
 		VectorCopy(ent->client->ps.origin, mEnt->org);
 		mEnt->yaw       = ent->client->ps.viewangles[YAW];
@@ -690,8 +916,7 @@ void G_UpdateTeamMapData_Player(gentity_t *ent, qboolean forceAllied, qboolean f
 		mEnt     = G_FindMapEntityData(teamList, num);
 		if (!mEnt)
 		{
-			mEnt         = G_AllocMapEntityData(teamList);
-			mEnt->entNum = num;
+			mEnt = G_AllocMapEntityData(teamList, num);
 		}
 
 		VectorCopy(ent->client->ps.origin, mEnt->org);
@@ -755,8 +980,7 @@ static void G_UpdateTeamMapData_DisguisedPlayer(gentity_t *spotter, gentity_t *e
 		mEnt = G_FindMapEntityDataSingleClient(teamList, NULL, num, spotter->s.clientNum);
 		if (!mEnt)
 		{
-			mEnt               = G_AllocMapEntityData(teamList);
-			mEnt->entNum       = num;
+			mEnt               = G_AllocMapEntityData(teamList, num);
 			mEnt->singleClient = spotter->s.clientNum;
 		}
 		VectorCopy(ent->client->ps.origin, mEnt->org);
@@ -773,8 +997,7 @@ static void G_UpdateTeamMapData_DisguisedPlayer(gentity_t *spotter, gentity_t *e
 		mEnt = G_FindMapEntityDataSingleClient(teamList, NULL, num, spotter->s.clientNum);
 		if (!mEnt)
 		{
-			mEnt               = G_AllocMapEntityData(teamList);
-			mEnt->entNum       = num;
+			mEnt               = G_AllocMapEntityData(teamList, num);
 			mEnt->singleClient = spotter->s.clientNum;
 		}
 		VectorCopy(ent->client->ps.origin, mEnt->org);
@@ -808,8 +1031,7 @@ void G_UpdateTeamMapData_LandMine(gentity_t *ent)
 		mEnt     = G_FindMapEntityData(teamList, num);
 		if (!mEnt)
 		{
-			mEnt         = G_AllocMapEntityData(teamList);
-			mEnt->entNum = num;
+			mEnt = G_AllocMapEntityData(teamList, num);
 		}
 		VectorCopy(ent->r.currentOrigin, mEnt->org);
 		mEnt->data      = ent->s.teamNum;
@@ -822,8 +1044,7 @@ void G_UpdateTeamMapData_LandMine(gentity_t *ent)
 	mEnt     = G_FindMapEntityData(teamList, num);
 	if (!mEnt)
 	{
-		mEnt         = G_AllocMapEntityData(teamList);
-		mEnt->entNum = num;
+		mEnt = G_AllocMapEntityData(teamList, num);
 	}
 	VectorCopy(ent->r.currentOrigin, mEnt->org);
 	mEnt->data      = ent->s.teamNum;
@@ -858,8 +1079,7 @@ void G_UpdateTeamMapData_CommandmapMarker(gentity_t *ent)
 		mEnt     = G_FindMapEntityData(teamList, num);
 		if (!mEnt)
 		{
-			mEnt         = G_AllocMapEntityData(teamList);
-			mEnt->entNum = num;
+			mEnt = G_AllocMapEntityData(teamList, num);
 		}
 		VectorCopy(ent->s.origin, mEnt->org);
 		mEnt->data      = ent->parent ? ent->parent->s.teamNum : -1;
@@ -873,8 +1093,7 @@ void G_UpdateTeamMapData_CommandmapMarker(gentity_t *ent)
 		mEnt     = G_FindMapEntityData(teamList, num);
 		if (!mEnt)
 		{
-			mEnt         = G_AllocMapEntityData(teamList);
-			mEnt->entNum = num;
+			mEnt = G_AllocMapEntityData(teamList, num);
 		}
 		VectorCopy(ent->s.origin, mEnt->org);
 		mEnt->data      = ent->parent ? ent->parent->s.teamNum : -1;
@@ -1136,7 +1355,8 @@ void G_PopupMessageForMines(gentity_t *player) // int sound
  */
 void G_CheckSpottedLandMines(void)
 {
-	int       i, j;
+	int       i, j, numMines;
+	int       mines[MAX_GENTITIES];
 	gentity_t *ent, *ent2;
 
 	if (level.time - level.lastMapSpottedMinesUpdate < 500)
@@ -1174,8 +1394,15 @@ void G_CheckSpottedLandMines(void)
 		{
 			G_SetupFrustum_ForBinoculars(ent);
 
-			for (j = 0, ent2 = g_entities; j < level.num_entities; j++, ent2++)
+			// clear out the landmineSpotted ptr once, bots looking for mines are getting confused
+			// by a stale one, only a mine visible from our binoculars sets it again below
+			ent->client->landmineSpotted = NULL;
+			numMines                     = G_FindLandMinesInFrustum(mines, MAX_GENTITIES);
+
+			for (j = 0; j < numMines; j++)
 			{
+				ent2 = &g_entities[mines[j]];
+
 				if (!ent2->inuse || ent2 == ent)
 				{
 					continue;
@@ -1240,12 +1467,6 @@ void G_CheckSpottedLandMines(void)
 								break;
 							}
 						}
-						else
-						{
-							// if we can't see the mine from our binoculars, make sure we clear out the landmineSpotted ptr,
-							// because bots looking for mines are getting confused
-							ent->client->landmineSpotted = NULL;
-						}
 					}
 				}
 			}
@@ -133,37 +133,252 @@ model / sound configstring indexes
 =========================================================================
 */
 
+#define CS_INDEX_MAPS       8
+#define CS_INDEX_MAX_SLOTS  256
+#define CS_INDEX_BUCKETS    64      // must be a power of two
+
 /**
- * @brief G_FindConfigstringIndex
+ * @struct csIndexMap_s
+ * @typedef csIndexMap_t
+ * @brief Hashes of the strings in one configstring range, kept up to date by trap_SetConfigstring
+ */
+typedef struct csIndexMap_s
+{
+	int start;                              ///< first configstring of the range, 0 if unused
+	int max;
+	int firstEmpty;                         ///< lookups stop at the first empty slot like a linear search
+	long hash[CS_INDEX_MAX_SLOTS];
+	byte used[CS_INDEX_MAX_SLOTS];
+	short next[CS_INDEX_MAX_SLOTS];         ///< next slot in the same bucket, in ascending order
+	short bucket[CS_INDEX_BUCKETS];         ///< first slot in each bucket, slot 0 is never used
+} csIndexMap_t;
+
+static csIndexMap_t csIndexMaps[CS_INDEX_MAPS];
+
+/**
+ * @brief Forgets all configstring hashes, they are rebuilt on the next lookup
+ */
+void G_ResetConfigstringIndexes(void)
+{
+	Com_Memset(csIndexMaps, 0, sizeof(csIndexMaps));
+}
+
+/**
+ * @brief G_ConfigstringIndexLink
+ * @param[in,out] map
+ * @param[in] slot
  * @param[in] name
+ */
+static void G_ConfigstringIndexLink(csIndexMap_t *map, int slot, const char *name)
+{
+	short *link;
+
+	map->hash[slot] = BG_StringHashValue(name);
+	map->used[slot] = qtrue;
+
+	link = &map->bucket[map->hash[slot] & (CS_INDEX_BUCKETS - 1)];
+	while (*link && *link < slot)
+	{
+		link = &map->next[*link];
+	}
+
+	map->next[slot] = *link;
+	*link           = (short)slot;
+}
+
+/**
+ * @brief G_ConfigstringIndexUnlink
+ * @param[in,out] map
+ * @param[in] slot
+ */
+static void G_ConfigstringIndexUnlink(csIndexMap_t *map, int slot)
+{
+	short *link;
+
+	for (link = &map->bucket[map->hash[slot] & (CS_INDEX_BUCKETS - 1)]; *link; link = &map->next[*link])
+	{
+		if (*link == slot)
+		{
+			*link = map->next[slot];
+			break;
+		}
+	}
+
+	map->used[slot] = qfalse;
+}
+
+/**
+ * @brief Finds the hash map of a configstring range, it is built with a single scan on first use
  * @param[in] start
  * @param[in] max
- * @param[in] create
- * @return
+ * @return NULL if the range can't be hashed
  */
-int G_FindConfigstringIndex(const char *name, int start, int max, qboolean create)
+static csIndexMap_t *G_ConfigstringIndexMap(int start, int max)
 {
-	int  i;
-	char s[MAX_STRING_CHARS];
+	csIndexMap_t *map;
+	char         s[MAX_STRING_CHARS];
+	int          i;
 
-	if (!name || !name[0])
+	if (max > CS_INDEX_MAX_SLOTS)
 	{
-		return 0;
+		return NULL;
+	}
+
+	for (i = 0; i < CS_INDEX_MAPS; i++)
+	{
+		if (csIndexMaps[i].start == start)
+		{
+			return &csIndexMaps[i];
+		}
+		if (!csIndexMaps[i].start)
+		{
+			break;
+		}
+	}
+
+	if (i == CS_INDEX_MAPS)
+	{
+		return NULL;
 	}
 
-	for (i = 1 ; i < max ; i++)
+	map             = &csIndexMaps[i];
+	map->start      = start;
+	map->max        = max;
+	map->firstEmpty = max;
+
+	for (i = 1; i < max; i++)
 	{
 		trap_GetConfigstring(start + i, s, sizeof(s));
 		if (!s[0])
 		{
-			break;
+			map->firstEmpty = MIN(map->firstEmpty, i);
+			continue;
 		}
+		G_ConfigstringIndexLink(map, i, s);
+	}
+
+	return map;
+}
+
+/**
+ * @brief Keeps the configstring hashes in sync, called for every configstring the game sets
+ * @param[in] num
+ * @param[in] string
+ */
+void G_ConfigstringIndexChanged(int num, const char *string)
+{
+	csIndexMap_t *map;
+	int          i, slot;
+
+	for (i = 0; i < CS_INDEX_MAPS && csIndexMaps[i].start; i++)
+	{
+		map  = &csIndexMaps[i];
+		slot = num - map->start;
+
+		if (slot < 1 || slot >= map->max)
+		{
+			continue;
+		}
+
+		if (map->used[slot])
+		{
+			G_ConfigstringIndexUnlink(map, slot);
+		}
+
+		if (string && string[0])
+		{
+			G_ConfigstringIndexLink(map, slot, string);
+
+			while (map->firstEmpty < map->max && map->used[map->firstEmpty])
+			{
+				map->firstEmpty++;
+			}
+		}
+		else if (slot < map->firstEmpty)
+		{
+			map->firstEmpty = slot;
+		}
+		return;
+	}
+}
+
+/**
+ * @brief Finds the slot of a string in a configstring range
+ * @param[in] name
+ * @param[in] start
+ * @param[in] max
+ * @param[out] empty First empty slot, max if the range is full
+ * @return The slot, 0 if the string isn't there
+ */
+static int G_ConfigstringIndexSearch(const char *name, int start, int max, int *empty)
+{
+	csIndexMap_t *map = G_ConfigstringIndexMap(start, max);
+	char         s[MAX_STRING_CHARS];
+	long         hash;
+	int          i;
+
+	if (!map)
+	{
+		for (i = 1 ; i < max ; i++)
+		{
+			trap_GetConfigstring(start + i, s, sizeof(s));
+			if (!s[0])
+			{
+				break;
+			}
+			if (!strcmp(s, name))
+			{
+				return i;
+			}
+		}
+		*empty = i;
+		return 0;
+	}
+
+	hash = BG_StringHashValue(name);
+
+	// only strings with the same hash need to be fetched and compared
+	for (i = map->bucket[hash & (CS_INDEX_BUCKETS - 1)]; i && i < map->firstEmpty; i = map->next[i])
+	{
+		if (map->hash[i] != hash)
+		{
+			continue;
+		}
+
+		trap_GetConfigstring(start + i, s, sizeof(s));
 		if (!strcmp(s, name))
 		{
 			return i;
 		}
 	}
 
+	*empty = map->firstEmpty;
+	return 0;
+}
+
+/**
+ * @brief G_FindConfigstringIndex
+ * @param[in] name
+ * @param[in] start
+ * @param[in] max
+ * @param[in] create
+ * @return
+ */
+int G_FindConfigstringIndex(const char *name, int start, int max, qboolean create)
+{
+	int i, found;
+
+	if (!name || !name[0])
+	{
+		return 0;
+	}
+
+	found = G_ConfigstringIndexSearch(name, start, max, &i);
+	if (found)
+	{
+		return found;
+	}
+
 	if (!create)
 	{
 		return 0;
@@ -189,7 +404,7 @@ int G_FindConfigstringIndex(const char *name, int start, int max, qboolean creat
  */
 void G_RemoveConfigstringIndex(const char *name, int start, int max)
 {
-	int  i, j;
+	int  i, j, empty;
 	char s[MAX_STRING_CHARS];
 
 	if (!name || !name[0])
@@ -197,26 +412,16 @@ void G_RemoveConfigstringIndex(const char *name, int start, int max)
 		return;
 	}
 
-	for (i = 1; i < max; i++)
+	i = G_ConfigstringIndexSearch(name, start, max, &empty);
+	if (i)
 	{
-		trap_GetConfigstring(start + i, s, sizeof(s));
-
-		if (!s[0])
-		{
-			break;
-		}
-
-		if (strcmp(s, name) == 0)
+		trap_SetConfigstring(start + i, "");
+		for (j = i + 1; j < max - 1; j++)
 		{
-			trap_SetConfigstring(start + i, "");
-			for (j = i + 1; j < max - 1; j++)
-			{
-				trap_GetConfigstring(start + j, s, sizeof(s));
-				trap_SetConfigstring(start + j, "");
-				trap_SetConfigstring(start + i, s);
+			trap_GetConfigstring(start + j, s, sizeof(s));
+			trap_SetConfigstring(start + j, "");
+			trap_SetConfigstring(start + i, s);
 
-			}
-			break;
 		}
 	}
 }
@@ -306,6 +511,272 @@ void G_TeamCommand(team_t team, const char *cmd)
 	}
 }
 
+/*
+ * Entity name index
+ *
+ * classname and targetname are hashed into bucket chains of entity numbers kept
+ * in ascending order, so the G_Find family only visits entities with a matching
+ * hash and still returns them in entity order. Entities are re-indexed when they
+ * are spawned, renamed by G_SetTargetName or Lua, or freed. Spawned entities stay
+ * dirty for the rest of the frame since their names are usually set after G_Spawn,
+ * G_SyncEntityIndex picks up every other change once per frame. Names are compared
+ * by their bucket, a new name is often allocated where the old one was freed.
+ */
+
+#define ENTINDEX_CLASSNAME      0
+#define ENTINDEX_TARGETNAME     1
+#define ENTINDEX_NUM            2
+
+#define ENTINDEX_BUCKETS        512         // power of two
+
+/**
+ * @struct entityIndex_s
+ * @typedef entityIndex_t
+ * @brief
+ */
+typedef struct entityIndex_s
+{
+	size_t fieldofs;
+	int head[ENTINDEX_BUCKETS];             ///< lowest entity number of the bucket, -1 if empty
+	int next[MAX_GENTITIES];
+	int bucket[MAX_GENTITIES];              ///< bucket the entity is linked into, -1 if not indexed
+} entityIndex_t;
+
+static entityIndex_t entityIndexes[ENTINDEX_NUM] =
+{
+	{ FOFS(classname)  },
+	{ FOFS(targetname) },
+};
+
+static int  entityIndexDirty[MAX_GENTITIES];
+static int  numEntityIndexDirty;
+static byte entityIndexIsDirty[MAX_GENTITIES];
+
+/**
+ * @brief G_EntityIndexBucket
+ * @param[in] hash BG_StringHashValue of the name
+ * @return
+ */
+static ID_INLINE int G_EntityIndexBucket(long hash)
+{
+	return (int)(hash & (ENTINDEX_BUCKETS - 1));
+}
+
+/**
+ * @brief Removes an entity from its bucket chain
+ * @param[in,out] index
+ * @param[in] entityNum
+ */
+static void G_EntityIndexUnlink(entityIndex_t *index, int entityNum)
+{
+	int *link = &index->head[index->bucket[entityNum]];
+
+	while (*link != -1)
+	{
+		if (*link == entityNum)
+		{
+			*link = index->next[entityNum];
+			break;
+		}
+		link = &index->next[*link];
+	}
+
+	index->bucket[entityNum] = -1;
+}
+
+/**
+ * @brief Inserts an entity into its bucket chain, keeping the chain sorted
+ * @param[in,out] index
+ * @param[in] entityNum
+ * @param[in] bucket
+ */
+static void G_EntityIndexLink(entityIndex_t *index, int entityNum, int bucket)
+{
+	int *link = &index->head[bucket];
+
+	while (*link != -1 && *link < entityNum)
+	{
+		link = &index->next[*link];
+	}
+
+	index->next[entityNum]   = *link;
+	*link                    = entityNum;
+	index->bucket[entityNum] = bucket;
+}
+
+/**
+ * @brief Brings the index entries of an entity up to date
+ * @param[in] ent
+ * @param[in] relink Link the entity again even if its names still hash to the same buckets
+ */
+static void G_UpdateEntityIndex(gentity_t *ent, qboolean relink)
+{
+	int           entityNum = (int)(ent - g_entities);
+	entityIndex_t *index;
+	const char    *key;
+	int           i, bucket;
+
+	for (i = 0; i < ENTINDEX_NUM; i++)
+	{
+		index  = &entityIndexes[i];
+		key    = ent->inuse ? *(char **)((byte *)ent + index->fieldofs) : NULL;
+		bucket = key ? G_EntityIndexBucket(BG_StringHashValue(key)) : -1;
+
+		if (bucket == index->bucket[entityNum] && !relink)
+		{
+			continue;
+		}
+
+		if (index->bucket[entityNum] != -1)
+		{
+			G_EntityIndexUnlink(index, entityNum);
+		}
+
+		if (bucket != -1)
+		{
+			G_EntityIndexLink(index, entityNum, bucket);
+		}
+	}
+}
+
+/**
+ * @brief Re-indexes the entity on every lookup until the end of the frame
+ * @param[in] ent
+ */
+void G_MarkEntityIndexDirty(gentity_t *ent)
+{
+	int entityNum = (int)(ent - g_entities);
+
+	if (!entityIndexIsDirty[entityNum])
+	{
+		entityIndexIsDirty[entityNum]           = 1;
+		entityIndexDirty[numEntityIndexDirty++] = entityNum;
+	}
+}
+
+/**
+ * @brief Re-indexes the entities marked dirty this frame
+ */
+static void G_FlushEntityIndex(void)
+{
+	int i;
+
+	for (i = 0; i < numEntityIndexDirty; i++)
+	{
+		G_UpdateEntityIndex(&g_entities[entityIndexDirty[i]], qtrue);
+	}
+}
+
+/**
+ * @brief Re-indexes all entities whose names changed and clears the dirty list,
+ * called once per frame
+ */
+void G_SyncEntityIndex(void)
+{
+	int i;
+
+	for (i = 0; i < level.num_entities; i++)
+	{
+		G_UpdateEntityIndex(&g_entities[i], qfalse);
+	}
+
+	for (i = 0; i < numEntityIndexDirty; i++)
+	{
+		entityIndexIsDirty[entityIndexDirty[i]] = 0;
+	}
+	numEntityIndexDirty = 0;
+}
+
+/**
+ * @brief Empties the index, g_entities must be cleared as well
+ */
+void G_ResetEntityIndex(void)
+{
+	int i;
+
+	for (i = 0; i < ENTINDEX_NUM; i++)
+	{
+		Com_Memset(entityIndexes[i].head, -1, sizeof(entityIndexes[i].head));
+		Com_Memset(entityIndexes[i].bucket, -1, sizeof(entityIndexes[i].bucket));
+	}
+
+	Com_Memset(entityIndexIsDirty, 0, sizeof(entityIndexIsDirty));
+	numEntityIndexDirty = 0;
+}
+
+/**
+ * @brief Looks up the next entity after from whose indexed name matches
+ * @param[in] index
+ * @param[in] from
+ * @param[in] match
+ * @param[in] hash BG_StringHashValue of match
+ * @param[in] checkTargetnameHash Also require a matching targetnamehash like G_FindByTargetname does
+ * @return
+ */
+static gentity_t *G_FindIndexed(entityIndex_t *index, gentity_t *from, const char *match, long hash, qboolean checkTargetnameHash)
+{
+	int        bucket = G_EntityIndexBucket(hash);
+	int        entityNum;
+	gentity_t  *ent;
+	const char *s;
+
+	G_FlushEntityIndex();
+
+	if (!from)
+	{
+		entityNum = index->head[bucket];
+	}
+	else
+	{
+		entityNum = (int)(from - g_entities);
+
+		// usually the previous result, continue its chain
+		if (index->bucket[entityNum] == bucket)
+		{
+			entityNum = index->next[entityNum];
+		}
+		else
+		{
+			int start = entityNum;
+
+			entityNum = index->head[bucket];
+			while (entityNum != -1 && entityNum <= start)
+			{
+				entityNum = index->next[entityNum];
+			}
+		}
+	}
+
+	for ( ; entityNum != -1 && entityNum < level.num_entities; entityNum = index->next[entityNum])
+	{
+		ent = &g_entities[entityNum];
+
+		if (!ent->inuse)
+		{
+			continue;
+		}
+
+		// the field may have been changed directly since the entity was indexed
+		s = *(char **)((byte *)ent + index->fieldofs);
+		if (!s)
+		{
+			continue;
+		}
+
+		if (checkTargetnameHash && ent->targetnamehash != hash)
+		{
+			continue;
+		}
+
+		if (!Q_stricmp(s, match))
+		{
+			return ent;
+		}
+	}
+
+	return NULL;
+}
+
 /**
  * @brief Searches all active entities for the next one that holds
  * the matching string at fieldofs (use the FOFS() macro) in the structure.
@@ -321,6 +792,15 @@ gentity_t *G_Find(gentity_t *from, size_t fieldofs, const char *match)
 {
 	char      *s;
 	gentity_t *max = &g_entities[level.num_entities];
+	int       i;
+
+	for (i = 0; i < ENTINDEX_NUM; i++)
+	{
+		if (fieldofs == entityIndexes[i].fieldofs)
+		{
+			return G_FindIndexed(&entityIndexes[i], from, match, BG_StringHashValue(match), qfalse);
+		}
+	}
 
 	if (!from)
 	{
@@ -474,8 +954,7 @@ gentity_t *G_FindVector(gentity_t *from, int fieldofs, const vec3_t match)
  */
 gentity_t *G_FindByTargetname(gentity_t *from, const char *match)
 {
-	gentity_t *max = &g_entities[level.num_entities];
-	int       hash;
+	int hash;
 
 	hash = BG_StringHashValue(match);
 
@@ -485,34 +964,7 @@ gentity_t *G_FindByTargetname(gentity_t *from, const char *match)
 		return NULL;
 	}
 
-	if (!from)
-	{
-		from = g_entities;
-	}
-	else
-	{
-		from++;
-	}
-
-	for ( ; from < max ; from++)
-	{
-		if (!from->inuse)
-		{
-			continue;
-		}
-
-		if (!from->targetname) // there are ents with no targetname set
-		{
-			continue;
-		}
-
-		if (from->targetnamehash == hash && !Q_stricmp(from->targetname, match))
-		{
-			return from;
-		}
-	}
-
-	return NULL;
+	return G_FindIndexed(&entityIndexes[ENTINDEX_TARGETNAME], from, match, hash, qtrue);
 }
 
 /**
@@ -524,36 +976,7 @@ gentity_t *G_FindByTargetname(gentity_t *from, const char *match)
  */
 gentity_t *G_FindByTargetnameFast(gentity_t *from, const char *match, int hash)
 {
-	gentity_t *max = &g_entities[level.num_entities];
-
-	if (!from)
-	{
-		from = g_entities;
-	}
-	else
-	{
-		from++;
-	}
-
-	for ( ; from < max ; from++)
-	{
-		if (!from->inuse)
-		{
-			continue;
-		}
-
-		if (!from->targetname) // there are ents with no targetname set
-		{
-			continue;
-		}
-
-		if (from->targetnamehash == hash && !Q_stricmp(from->targetname, match))
-		{
-			return from;
-		}
-	}
-
-	return NULL;
+	return G_FindIndexed(&entityIndexes[ENTINDEX_TARGETNAME], from, match, hash, qtrue);
 }
 
 #define MAXCHOICES  32
@@ -777,6 +1200,9 @@ void G_InitGentity(gentity_t *e)
 	// mark the time
 	e->spawnTime = level.time;
 
+	// names are usually set right after spawning
+	G_MarkEntityIndexDirty(e);
+
 #ifdef FEATURE_OMNIBOT
 	// Notify omni-bot
 	Bot_Queue_EntityCreated(e);
@@ -801,6 +1227,10 @@ gentity_t *G_Spawn(void)
 	int       i = 0, force;
 	gentity_t *e = NULL;
 
+	// spawned from within a spawn function, the new entity may be handed
+	// memory of its parent, so it can't be released with the parent anymore
+	G_DisownMemory();
+
 	for (force = 0 ; force < 2 ; force++)
 	{
 		// if we go through all entities and can't find one to free,
@@ -895,6 +1325,9 @@ void G_FreeEntity(gentity_t *ent)
 		return;
 	}
 
+	G_FreeEntityMemory(ent);
+	G_UnlinkLandMine(ent);
+
 	// this tiny hack fixes level.num_entities rapidly reaching MAX_GENTITIES-1
 	// some very often spawned entities don't have to relax (=spawned, immediately freed and not transmitted)
 	// before all game entities did relax - now  ET_TEMPHEAD, ET_TEMPLEGS and ET_EVENTS no longer relax
@@ -924,6 +1357,7 @@ void G_FreeEntity(gentity_t *ent)
 		ent->classname = "freed";
 		ent->freetime  = -9999;  // e->freetime is never greater than level.startTime + 2000 see G_Spawn()
 		ent->inuse     = qfalse;
+		G_UpdateEntityIndex(ent, qfalse);
 	}
 	else // all other game entities relax
 	{
@@ -931,6 +1365,7 @@ void G_FreeEntity(gentity_t *ent)
 		ent->classname = "freed";
 		ent->freetime  = level.time;
 		ent->inuse     = qfalse;
+		G_UpdateEntityIndex(ent, qfalse);
 	}
 }
 
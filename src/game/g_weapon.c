@@ -489,7 +489,7 @@ gentity_t *Weapon_Syringe(gentity_t *ent)
 		// calculate ranks to update numFinalDead arrays. Have to do it manually as addscore has an early out
 		if (g_gametype.integer == GT_WOLF_LMS)
 		{
-			CalculateRanks();
+			QueueCalculateRanks(NULL);
 		}
 	}
 	else
@@ -1824,6 +1824,7 @@ weapengineergoto2:
 
 					traceEnt->s.effect1Time = 1; // armed
 					traceEnt->s.modelindex2 = 0;
+					G_LinkLandMine(traceEnt);
 
 					traceEnt->nextthink = level.time + 2000;
 					traceEnt->think     = G_LandminePrime;
@@ -34,6 +34,7 @@
  */
 
 #include "cm_local.h"
+#include "cm_patch.h"
 
 // to allow boxes to be treated as brush models, we allocate
 // some extra indexes along with those needed by the map
@@ -54,6 +55,11 @@ cvar_t *cm_noCurves;
 cvar_t *cm_playerCurveClip;
 cvar_t *cm_optimize;
 cvar_t *cm_optimizePatchPlanes;
+#ifdef CM_SIMD
+cvar_t *cm_simd;
+#endif
+cvar_t *cm_traceCache;
+cvar_t *cm_patchCache;
 
 cmodel_t box_model;
 cplane_t *box_planes;
@@ -456,6 +462,38 @@ void CMod_LoadBrushSides(lump_t *l)
 	}
 }
 
+#ifdef CM_SIMD
+/**
+ * @brief Copies the planes of the map brush sides into a structure of arrays layout
+ * so CM_TraceThroughBrush can load the planes of four sides at once
+ *
+ * @note The box hull sides aren't included, their planes change with every CM_TempBoxModel
+ */
+void CMod_LoadBrushSidePlanes(void)
+{
+	int      i, j;
+	int      count = cm.numBrushSides + 3;  // the last brush may be read up to 3 sides past its end
+	cplane_t *plane;
+
+	for (j = 0 ; j < 3 ; j++)
+	{
+		cm.sideNormals[j] = Hunk_Alloc(count * sizeof(float), h_high);
+	}
+	cm.sideDists = Hunk_Alloc(count * sizeof(float), h_high);
+
+	for (i = 0 ; i < cm.numBrushSides ; i++)
+	{
+		plane = cm.brushsides[i].plane;
+
+		for (j = 0 ; j < 3 ; j++)
+		{
+			cm.sideNormals[j][i] = plane->normal[j];
+		}
+		cm.sideDists[i] = plane->dist;
+	}
+}
+#endif
+
 /**
  * @brief CMod_LoadCustomEntityString
  * @param[in] name
@@ -530,6 +568,242 @@ void CMod_LoadVisibility(lump_t *l)
 	Com_Memcpy(cm.visibility, buf + VIS_HEADER, len - VIS_HEADER);
 }
 
+/**
+===============================================================================
+                    PATCH COLLISION CACHE
+
+Generated patch collision data is written to cache/<map>.pcc in fs_homepath,
+keyed by the CM_Checksum of the BSP. The next load reads the whole file into
+the hunk at once and points the patchCollide_t at it, which skips the grid
+subdivision, bevel generation and plane deduplication. A missing, stale or
+damaged cache falls back to CM_GeneratePatchCollide and is rewritten.
+===============================================================================
+*/
+
+#define PATCHCACHE_IDENT    (('C' << 24) + ('P' << 16) + ('T' << 8) + 'E')
+#define PATCHCACHE_VERSION  1   ///< bump when the output of CM_GeneratePatchCollide changes
+
+/**
+ * @struct patchCacheHeader_s
+ */
+typedef struct patchCacheHeader_s
+{
+	int ident;                      ///< PATCHCACHE_IDENT, also rejects caches of the other byte order
+	int version;                    ///< PATCHCACHE_VERSION
+	unsigned int checksum;          ///< CM_Checksum of the BSP
+	int optimizePatchPlanes;        ///< cm_optimizePatchPlanes the bevels were generated with
+	int planeSize;                  ///< sizeof(patchPlane_t)
+	int facetSize;                  ///< sizeof(facet_t)
+	int numSurfaces;                ///< surfaces of the BSP
+	int numPatches;                 ///< patch records following the header
+	int dataSize;                   ///< bytes of planes and facets following the records
+} patchCacheHeader_t;
+
+/**
+ * @struct patchCacheRecord_s
+ */
+typedef struct patchCacheRecord_s
+{
+	int surface;                    ///< index into cm.surfaces
+	vec3_t bounds[2];
+	int numPlanes;
+	int numFacets;
+} patchCacheRecord_t;
+
+/**
+ * @brief Builds the path of the patch cache of a map
+ * @param[in] name BSP name
+ * @param[out] path
+ * @param[in] size
+ */
+static void CM_PatchCachePath(const char *name, char *path, int size)
+{
+	char base[MAX_QPATH];
+
+	COM_StripExtension(name, base, sizeof(base));
+	Com_sprintf(path, size, "cache/%s.pcc", base);
+}
+
+/**
+ * @brief Checks a cached patch against the size of its plane list
+ * @param[in] pc
+ * @return qfalse if a facet references a plane that doesn't exist
+ */
+static qboolean CM_ValidCachedPatch(const patchCollide_t *pc)
+{
+	unsigned int i;
+	int          j;
+	facet_t      *facet;
+
+	for (i = 0, facet = pc->facets; i < pc->numFacets; i++, facet++)
+	{
+		if (facet->surfacePlane < 0 || (unsigned int)facet->surfacePlane >= pc->numPlanes ||
+		    facet->numBorders < 0 || facet->numBorders > (int)ARRAY_LEN(facet->borderPlanes))
+		{
+			return qfalse;
+		}
+		for (j = 0; j < facet->numBorders; j++)
+		{
+			if (facet->borderPlanes[j] < 0 || (unsigned int)facet->borderPlanes[j] >= pc->numPlanes)
+			{
+				return qfalse;
+			}
+		}
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Loads the patch cache of a map
+ * @param[in] path
+ * @param[in] checksum CM_Checksum of the BSP
+ * @param[in] numSurfaces
+ * @return Patch collision data indexed by surface, NULL if the cache is missing or stale
+ */
+static patchCollide_t **CM_ReadPatchCache(const char *path, unsigned int checksum, int numSurfaces)
+{
+	fileHandle_t       f;
+	long               length;
+	patchCacheHeader_t header;
+	patchCacheRecord_t *records;
+	patchCollide_t     **pcs, *pc;
+	byte               *data;
+	int                i, size, offset = 0;
+
+	length = FS_SV_FOpenFileRead(path, &f);
+	if (!f)
+	{
+		return NULL;
+	}
+
+	if (length < (long)sizeof(header) || FS_Read(&header, sizeof(header), f) != (int)sizeof(header) ||
+	    header.ident != PATCHCACHE_IDENT || header.version != PATCHCACHE_VERSION ||
+	    header.checksum != checksum || header.optimizePatchPlanes != cm_optimizePatchPlanes->integer ||
+	    header.planeSize != sizeof(patchPlane_t) || header.facetSize != sizeof(facet_t) ||
+	    header.numSurfaces != numSurfaces || header.numPatches < 0 || header.numPatches > numSurfaces ||
+	    header.dataSize < 0 || length != (long)(sizeof(header) + header.numPatches * sizeof(*records) + header.dataSize))
+	{
+		Com_DPrintf("CM_ReadPatchCache: %s is stale\n", path);
+		FS_FCloseFile(f);
+		return NULL;
+	}
+
+	// the planes and facets are used in place, so they go straight to the hunk
+	size = header.numPatches * sizeof(*records) + header.dataSize;
+	data = Hunk_Alloc(size, h_high);
+	if (FS_Read(data, size, f) != size)
+	{
+		Com_DPrintf("CM_ReadPatchCache: %s is truncated\n", path);
+		FS_FCloseFile(f);
+		return NULL;
+	}
+	FS_FCloseFile(f);
+
+	records = (patchCacheRecord_t *)data;
+	data   += header.numPatches * sizeof(*records);
+	pcs     = Z_Malloc(numSurfaces * sizeof(*pcs));
+
+	for (i = 0; i < header.numPatches; i++)
+	{
+		if (records[i].surface < 0 || records[i].surface >= numSurfaces || pcs[records[i].surface] ||
+		    records[i].numPlanes < 0 || records[i].numFacets < 0 ||
+		    records[i].numPlanes > (header.dataSize - offset) / header.planeSize ||
+		    records[i].numFacets > (header.dataSize - offset - records[i].numPlanes * header.planeSize) / header.facetSize)
+		{
+			break;
+		}
+
+		pc = Hunk_Alloc(sizeof(*pc), h_high);
+		VectorCopy(records[i].bounds[0], pc->bounds[0]);
+		VectorCopy(records[i].bounds[1], pc->bounds[1]);
+		pc->numPlanes = records[i].numPlanes;
+		pc->planes    = (patchPlane_t *)(data + offset);
+		offset       += records[i].numPlanes * header.planeSize;
+		pc->numFacets = records[i].numFacets;
+		pc->facets    = (facet_t *)(data + offset);
+		offset       += records[i].numFacets * header.facetSize;
+
+		if (!CM_ValidCachedPatch(pc))
+		{
+			break;
+		}
+		pcs[records[i].surface] = pc;
+	}
+
+	if (i != header.numPatches || offset != header.dataSize)
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: CM_ReadPatchCache: %s is damaged, regenerating patches\n", path);
+		Z_Free(pcs);
+		return NULL;
+	}
+
+	return pcs;
+}
+
+/**
+ * @brief Writes the patch collision data of the loaded map to its cache
+ * @param[in] path
+ * @param[in] checksum CM_Checksum of the BSP
+ */
+static void CM_WritePatchCache(const char *path, unsigned int checksum)
+{
+	fileHandle_t       f;
+	patchCacheHeader_t header;
+	patchCacheRecord_t *records, *record;
+	patchCollide_t     *pc;
+	int                i;
+
+	Com_Memset(&header, 0, sizeof(header));
+	header.ident               = PATCHCACHE_IDENT;
+	header.version             = PATCHCACHE_VERSION;
+	header.checksum            = checksum;
+	header.optimizePatchPlanes = cm_optimizePatchPlanes->integer;
+	header.planeSize           = sizeof(patchPlane_t);
+	header.facetSize           = sizeof(facet_t);
+	header.numSurfaces         = cm.numSurfaces;
+
+	records = Z_Malloc(cm.numSurfaces * sizeof(*records));
+	for (i = 0; i < cm.numSurfaces; i++)
+	{
+		if (!cm.surfaces[i] || !cm.surfaces[i]->pc)
+		{
+			continue;
+		}
+
+		pc     = cm.surfaces[i]->pc;
+		record = &records[header.numPatches++];
+
+		record->surface   = i;
+		record->numPlanes = pc->numPlanes;
+		record->numFacets = pc->numFacets;
+		VectorCopy(pc->bounds[0], record->bounds[0]);
+		VectorCopy(pc->bounds[1], record->bounds[1]);
+
+		header.dataSize += pc->numPlanes * sizeof(patchPlane_t) + pc->numFacets * sizeof(facet_t);
+	}
+
+	f = FS_SV_FOpenFileWrite(path);
+	if (!f)
+	{
+		Com_DPrintf("CM_WritePatchCache: couldn't write %s\n", path);
+		Z_Free(records);
+		return;
+	}
+
+	FS_Write(&header, sizeof(header), f);
+	FS_Write(records, header.numPatches * sizeof(*records), f);
+	for (i = 0; i < header.numPatches; i++)
+	{
+		pc = cm.surfaces[records[i].surface]->pc;
+		FS_Write(pc->planes, pc->numPlanes * sizeof(patchPlane_t), f);
+		FS_Write(pc->facets, pc->numFacets * sizeof(facet_t), f);
+	}
+	FS_FCloseFile(f);
+
+	Z_Free(records);
+}
+
 //==================================================================
 
 #define MAX_PATCH_VERTS     1024
@@ -538,18 +812,24 @@ void CMod_LoadVisibility(lump_t *l)
  * @brief CMod_LoadPatches
  * @param[in] surfs
  * @param[in] verts
+ * @param[in] name BSP name for the patch cache
+ * @param[in] checksum CM_Checksum of the BSP, 0 to not use the patch cache
  */
-void CMod_LoadPatches(lump_t *surfs, lump_t *verts)
+void CMod_LoadPatches(lump_t *surfs, lump_t *verts, const char *name, unsigned int checksum)
 {
-	drawVert_t *dv, *dv_p;
-	dsurface_t *in;
-	int        count;
-	int        i, j;
-	int        c;
-	cPatch_t   *patch;
-	vec3_t     points[MAX_PATCH_VERTS];
-	int        width, height;
-	int        shaderNum;
+	drawVert_t     *dv, *dv_p;
+	dsurface_t     *in;
+	int            count;
+	int            i, j;
+	int            c;
+	cPatch_t       *patch;
+	vec3_t         points[MAX_PATCH_VERTS];
+	int            width, height;
+	int            shaderNum;
+	char           cachePath[MAX_OSPATH];
+	patchCollide_t **cached  = NULL;
+	qboolean       generated = qfalse;
+	int            startTime = Sys_Milliseconds();
 
 	in = ( void * )(cmod_base + surfs->fileofs);
 	if (surfs->filelen % sizeof(*in))
@@ -565,6 +845,12 @@ void CMod_LoadPatches(lump_t *surfs, lump_t *verts)
 		Com_Error(ERR_DROP, "CMod_LoadPatches: funny lump size");
 	}
 
+	if (checksum)
+	{
+		CM_PatchCachePath(name, cachePath, sizeof(cachePath));
+		cached = CM_ReadPatchCache(cachePath, checksum, count);
+	}
+
 	// scan through all the surfaces, but only load patches,
 	// not planar faces
 	for (i = 0 ; i < count ; i++, in++)
@@ -598,9 +884,28 @@ void CMod_LoadPatches(lump_t *surfs, lump_t *verts)
 		patch->contents     = cm.shaders[shaderNum].contentFlags;
 		patch->surfaceFlags = cm.shaders[shaderNum].surfaceFlags;
 
+		if (cached && cached[i])
+		{
+			patch->pc = cached[i];
+			continue;
+		}
+
 		// create the internal facet structure
 		patch->pc = CM_GeneratePatchCollide(width, height, points, qtrue);
+		generated = qtrue;
+	}
+
+	if (cached)
+	{
+		Z_Free(cached);
 	}
+
+	if (checksum && generated)
+	{
+		CM_WritePatchCache(cachePath, checksum);
+	}
+
+	Com_DPrintf("CMod_LoadPatches: %s patches in %i msec\n", generated ? "generated" : "loaded cached", Sys_Milliseconds() - startTime);
 }
 
 //==================================================================
@@ -617,8 +922,7 @@ unsigned CM_LumpChecksum(lump_t *lump)
 /**
  * @brief CM_Checksum
  * @param[in] header
- *
- * @note Unused
+ * @return Checksum of the lumps used for collision, keys the patch cache
  */
 unsigned CM_Checksum(dheader_t *header)
 {
@@ -666,6 +970,11 @@ void CM_LoadMap(const char *name, qboolean clientload, unsigned int *checksum)
 	cm_noCurves        = Cvar_Get("cm_noCurves", "0", CVAR_CHEAT);
 	cm_playerCurveClip = Cvar_Get("cm_playerCurveClip", "1", CVAR_ARCHIVE_ND | CVAR_CHEAT);
 	cm_optimize        = Cvar_Get("cm_optimize", "1", CVAR_CHEAT);
+	cm_traceCache      = Cvar_GetAndDescribe("cm_traceCache", "0", CVAR_ARCHIVE_ND, "Reuse the results of identical world traces within a frame, see cm_tracecachestats.");
+	cm_patchCache      = Cvar_GetAndDescribe("cm_patchCache", "1", CVAR_ARCHIVE_ND, "Store generated patch collision data in fs_homepath/cache and reuse it while the map doesn't change.");
+#ifdef CM_SIMD
+	cm_simd = Cvar_GetAndDescribe("cm_simd", "1", CVAR_ARCHIVE_ND, "Trace map brushes with SIMD instructions, takes effect on the next map load.");
+#endif
 
 	// pure client and not self hosted (to avoid mixing flags on local play)
 	if (clientload && !com_sv_running->integer)
@@ -687,6 +996,7 @@ void CM_LoadMap(const char *name, qboolean clientload, unsigned int *checksum)
 
 	// free old stuff
 	Com_Memset(&cm, 0, sizeof(cm));
+	CM_InvalidateTraceCache();
 	CM_ClearLevelPatches();
 
 	if (!name[0])
@@ -732,11 +1042,17 @@ void CM_LoadMap(const char *name, qboolean clientload, unsigned int *checksum)
 	CMod_LoadPlanes(&header.lumps[LUMP_PLANES]);
 	CMod_LoadBrushSides(&header.lumps[LUMP_BRUSHSIDES]);
 	CMod_LoadBrushes(&header.lumps[LUMP_BRUSHES]);
+#ifdef CM_SIMD
+	if (cm_simd->integer)
+	{
+		CMod_LoadBrushSidePlanes();
+	}
+#endif
 	CMod_LoadSubmodels(&header.lumps[LUMP_MODELS]);
 	CMod_LoadNodes(&header.lumps[LUMP_NODES]);
 	CMod_LoadEntityString(&header.lumps[LUMP_ENTITIES], name);
 	CMod_LoadVisibility(&header.lumps[LUMP_VISIBILITY]);
-	CMod_LoadPatches(&header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS]);
+	CMod_LoadPatches(&header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS], name, cm_patchCache->integer ? CM_Checksum(&header) : 0);
 
 	// we are NOT freeing the file, because it is cached for the ref
 	FS_FreeFile(buf.v);
@@ -759,6 +1075,7 @@ void CM_ClearMap(void)
 {
 	Com_Memset(&cm, 0, sizeof(cm));
 	CM_ClearLevelPatches();
+	CM_InvalidateTraceCache();
 }
 
 /**
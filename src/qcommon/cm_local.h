@@ -48,6 +48,17 @@
 /// enable to make the collision detection a bunch faster
 #define MRE_OPTIMIZE
 
+/// brush sides of map brushes are traced four at a time with SSE2 or NEON
+#if defined(ETL_ENABLE_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CM_SIMD_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define CM_SIMD_NEON
+#endif
+
+#if defined(CM_SIMD_SSE2) || defined(CM_SIMD_NEON)
+#define CM_SIMD
+#endif
+
 /**
  * @struct cNode_s
  */
@@ -175,6 +186,10 @@ typedef struct
 
 	int floodvalid;
 	int checkcount;                         ///< incremented on each trace
+
+	/// brush side planes in structure of arrays layout, NULL if not used, see CMod_LoadBrushSidePlanes
+	float *sideNormals[3];
+	float *sideDists;
 } clipMap_t;
 
 
@@ -190,6 +205,11 @@ extern cvar_t    *cm_noCurves;
 extern cvar_t    *cm_playerCurveClip;
 extern cvar_t    *cm_optimize;
 extern cvar_t    *cm_optimizePatchPlanes;
+#ifdef CM_SIMD
+extern cvar_t *cm_simd;
+#endif
+extern cvar_t    *cm_traceCache;
+extern cvar_t    *cm_patchCache;
 
 // cm_test.c
 
@@ -205,6 +225,20 @@ typedef struct
 	vec3_t offset;
 } sphere_t;
 
+#define TRACE_VISITED_BITS   8
+#define TRACE_VISITED        (1 << TRACE_VISITED_BITS)
+#define TRACE_VISITED_PROBES 8
+
+/**
+ * @struct traceVisited_s
+ * @typedef traceVisited_t
+ * @brief Brushes and patches already tested by a trace running in a job, see CM_CheckOnce
+ */
+typedef struct traceVisited_s
+{
+	int keys[TRACE_VISITED];    ///< brush number + 1, -(surface number + 1) for patches, 0 when empty
+} traceVisited_t;
+
 /**
  * @struct traceWork_s
  */
@@ -229,6 +263,8 @@ typedef struct
 	float traceDist2;
 	vec3_t dir;
 
+	int checkcount;         ///< brushes and patches marked with this were already tested by this trace
+	traceVisited_t *visited; ///< used instead of checkcount by traces in jobs, which run in parallel
 } traceWork_t;
 
 /**
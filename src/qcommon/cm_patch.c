@@ -1701,11 +1701,12 @@ void CM_TracePointThroughPatchCollide(traceWork_t *tw, const struct patchCollide
 		if (j == facet->numBorders)
 		{
 			// we hit this facet
-			if (!cv)
+			// debug surfaces are only tracked on the main thread, Cvar_Get isn't thread safe
+			if (!cv && !Com_InJob())
 			{
 				cv = Cvar_Get("r_debugSurfaceUpdate", "1", 0);
 			}
-			if (cv->integer)
+			if (cv && cv->integer && !Com_InJob())
 			{
 				debugPatchCollide = pc;
 				debugFacet        = facet;
@@ -1931,11 +1932,11 @@ void CM_TraceThroughPatchCollide(traceWork_t *tw, const struct patchCollide_s *p
 				{
 					enterFrac = 0;
 				}
-				if (!cv)
+				if (!cv && !Com_InJob())
 				{
 					cv = Cvar_Get("r_debugSurfaceUpdate", "1", 0);
 				}
-				if (cv && cv->integer)
+				if (cv && cv->integer && !Com_InJob())
 				{
 					debugPatchCollide = pc;
 					debugFacet        = facet;
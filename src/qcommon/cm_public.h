@@ -63,6 +63,9 @@ void CM_TransformedBoxTrace(trace_t *results, const vec3_t start, const vec3_t e
                             const vec3_t mins, const vec3_t maxs,
                             clipHandle_t model, int brushmask,
                             const vec3_t origin, const vec3_t angles, qboolean capsule);
+void CM_TraceBench_f(void);
+void CM_InvalidateTraceCache(void);
+void CM_TraceCacheStats_f(void);
 
 byte *CM_ClusterPVS(int cluster);
 
@@ -35,6 +35,58 @@
 #include "cm_local.h"
 #include "cm_patch.h"
 
+#ifdef CM_SIMD_SSE2
+#include <emmintrin.h>
+
+typedef __m128 cmVec4_t;
+
+#define CM_Load4(p)             _mm_loadu_ps(p)
+#define CM_Store4(p, a)         _mm_storeu_ps(p, a)
+#define CM_Splat4(f)            _mm_set1_ps(f)
+#define CM_Add4(a, b)           _mm_add_ps(a, b)
+#define CM_Sub4(a, b)           _mm_sub_ps(a, b)
+#define CM_Mul4(a, b)           _mm_mul_ps(a, b)
+#define CM_Gt4(a, b)            _mm_cmpgt_ps(a, b)
+#define CM_Ge4(a, b)            _mm_cmpge_ps(a, b)
+#define CM_Or4(a, b)            _mm_or_ps(a, b)
+#define CM_And4(a, b)           _mm_and_ps(a, b)
+#define CM_Select4(m, a, b)     _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))   // m ? a : b
+#define CM_Mask4(m)             _mm_movemask_ps(m)
+#elif defined(CM_SIMD_NEON)
+#include <arm_neon.h>
+
+typedef float32x4_t cmVec4_t;
+
+#define CM_Load4(p)             vld1q_f32(p)
+#define CM_Store4(p, a)         vst1q_f32(p, a)
+#define CM_Splat4(f)            vdupq_n_f32(f)
+#define CM_Add4(a, b)           vaddq_f32(a, b)
+#define CM_Sub4(a, b)           vsubq_f32(a, b)
+#define CM_Mul4(a, b)           vmulq_f32(a, b)
+#define CM_Gt4(a, b)            vreinterpretq_f32_u32(vcgtq_f32(a, b))
+#define CM_Ge4(a, b)            vreinterpretq_f32_u32(vcgeq_f32(a, b))
+#define CM_Or4(a, b)            vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)))
+#define CM_And4(a, b)           vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)))
+#define CM_Select4(m, a, b)     vbslq_f32(vreinterpretq_u32_f32(m), a, b)
+
+/**
+ * @brief Gathers the sign bits of the four lanes like _mm_movemask_ps
+ * @param[in] m
+ * @return
+ */
+static ID_INLINE int CM_Mask4(cmVec4_t m)
+{
+	static const int32_t shifts[4] = { 0, 1, 2, 3 };
+	uint32x4_t           bits      = vshrq_n_u32(vreinterpretq_u32_f32(m), 31);
+
+	return vaddvq_u32(vshlq_u32(bits, vld1q_s32(shifts)));
+}
+#endif
+
+#ifdef CM_SIMD
+static qboolean cm_scalarTraces;    ///< force the scalar brush code, see CM_TraceBench_f
+#endif
+
 /// Always use bbox vs. bbox collision and never capsule vs. bbox or vice versa
 #define ALWAYS_BBOX_VS_BBOX
 /// Always use capsule vs. capsule collision and never capsule vs. bbox or vice versa
@@ -222,6 +274,51 @@ void CM_TestBoxInBrush(traceWork_t *tw, cbrush_t *brush)
 	tw->trace.contents   = brush->contents;
 }
 
+/**
+ * @brief Tells whether a trace gets to test a brush or patch, each is tested once
+ * even if it is in several of the leafs the trace passes through
+ *
+ * Traces in jobs don't touch the shared counters and remember the tested ones in
+ * tw->visited. When that is crowded a brush is tested again, which doesn't change
+ * the result.
+ *
+ * @param[in,out] tw
+ * @param[in,out] checkcount Counter of the brush or patch
+ * @param[in] key Brush number + 1, -(surface number + 1) for patches
+ * @return
+ */
+static ID_INLINE qboolean CM_CheckOnce(traceWork_t *tw, int *checkcount, int key)
+{
+	unsigned int i;
+	int          n;
+
+	if (!tw->visited)
+	{
+		if (*checkcount == tw->checkcount)
+		{
+			return qfalse;
+		}
+		*checkcount = tw->checkcount;
+		return qtrue;
+	}
+
+	i = ((unsigned int)key * 0x9E3779B1u) >> (32 - TRACE_VISITED_BITS);
+	for (n = 0; n < TRACE_VISITED_PROBES; n++, i = (i + 1) & (TRACE_VISITED - 1))
+	{
+		if (tw->visited->keys[i] == key)
+		{
+			return qfalse;
+		}
+		if (!tw->visited->keys[i])
+		{
+			tw->visited->keys[i] = key;
+			return qtrue;
+		}
+	}
+
+	return qtrue;
+}
+
 /**
  * @brief CM_TestInLeaf
  * @param[in,out] tw
@@ -238,11 +335,10 @@ void CM_TestInLeaf(traceWork_t *tw, cLeaf_t *leaf)
 	{
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
 		b        = &cm.brushes[brushnum];
-		if (b->checkcount == cm.checkcount)
+		if (!CM_CheckOnce(tw, &b->checkcount, brushnum + 1))
 		{
 			continue;   // already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
 
 		if (!(b->contents & tw->contents))
 		{
@@ -260,19 +356,20 @@ void CM_TestInLeaf(traceWork_t *tw, cLeaf_t *leaf)
 	if (!cm_noCurves->integer)
 	{
 		cPatch_t *patch;
+		int      surfnum;
 
 		for (k = 0 ; k < leaf->numLeafSurfaces ; k++)
 		{
-			patch = cm.surfaces[cm.leafsurfaces[leaf->firstLeafSurface + k]];
+			surfnum = cm.leafsurfaces[leaf->firstLeafSurface + k];
+			patch   = cm.surfaces[surfnum];
 			if (!patch)
 			{
 				continue;
 			}
-			if (patch->checkcount == cm.checkcount)
+			if (!CM_CheckOnce(tw, &patch->checkcount, -(surfnum + 1)))
 			{
 				continue;   // already checked this brush in another leaf
 			}
-			patch->checkcount = cm.checkcount;
 
 			if (!(patch->contents & tw->contents))
 			{
@@ -434,12 +531,8 @@ void CM_PositionTest(traceWork_t *tw)
 	ll.lastLeaf   = 0;
 	ll.overflowed = qfalse;
 
-	cm.checkcount++;
-
 	CM_BoxLeafnums_r(&ll, 0);
 
-	cm.checkcount++;
-
 	// test the contents of the leafs
 	for (i = 0 ; i < ll.count ; i++)
 	{
@@ -466,7 +559,10 @@ static void CM_TraceThroughPatch(traceWork_t *tw, cPatch_t *patch)
 {
 	float oldFrac = tw->trace.fraction;
 
-	c_patch_traces++;
+	if (!tw->visited)
+	{
+		c_patch_traces++;   // for statistics, not counted in jobs
+	}
 
 	CM_TraceThroughPatchCollide(tw, patch->pc);
 
@@ -596,6 +692,155 @@ static int CM_TraceThroughBounds(traceWork_t *tw, vec3_t mins, vec3_t maxs)
 	return qtrue;
 }
 
+#ifdef CM_SIMD
+/**
+ * @brief Compares the trace against all planes of a map brush, four at a time
+ *
+ * Does exactly the same math as the scalar loops in CM_TraceThroughBrush, the
+ * enter and leave fractions are worked out per crossing side in brush order
+ * so the results are the same.
+ *
+ * @param[in] tw
+ * @param[in] brush
+ * @param[in,out] enterFrac
+ * @param[in,out] leaveFrac
+ * @param[in,out] getout
+ * @param[in,out] startout
+ * @param[in,out] clipplane
+ * @param[in,out] leadside
+ * @return qfalse if the trace is completely in front of a side and can't touch the brush
+ */
+static qboolean CM_TraceThroughBrushSidesSIMD(traceWork_t *tw, cbrush_t *brush, float *enterFrac, float *leaveFrac,
+                                             qboolean *getout, qboolean *startout, cplane_t **clipplane, cbrushside_t **leadside)
+{
+	int          first = brush->sides - cm.brushsides;
+	const float  *nx   = cm.sideNormals[0] + first;
+	const float  *ny   = cm.sideNormals[1] + first;
+	const float  *nz   = cm.sideNormals[2] + first;
+	const float  *pd   = cm.sideDists + first;
+	cmVec4_t     zero  = CM_Splat4(0.f);
+	cmVec4_t     eps   = CM_Splat4(SURFACE_CLIP_EPSILON);
+	cmVec4_t     x, y, z, dist, d1, d2, mask;
+	float        d1s[4], d2s[4];
+	int          i, j, lanes, valid, cross;
+	float        f;
+	cbrushside_t *side;
+
+	for (i = 0; i < brush->numsides; i += 4)
+	{
+		lanes = brush->numsides - i;
+		valid = (lanes >= 4) ? 0xf : ((1 << lanes) - 1);
+
+		x    = CM_Load4(nx + i);
+		y    = CM_Load4(ny + i);
+		z    = CM_Load4(nz + i);
+		dist = CM_Load4(pd + i);
+
+		if (tw->sphere.use)
+		{
+			cmVec4_t t, sx, sy, sz, ex, ey, ez;
+
+			// adjust the plane distance apropriately for radius
+			dist = CM_Add4(dist, CM_Splat4(tw->sphere.radius));
+
+			// find the closest point on the capsule to the plane
+			t    = CM_Add4(CM_Add4(CM_Mul4(x, CM_Splat4(tw->sphere.offset[0])), CM_Mul4(y, CM_Splat4(tw->sphere.offset[1]))), CM_Mul4(z, CM_Splat4(tw->sphere.offset[2])));
+			mask = CM_Gt4(t, zero);
+
+			sx = CM_Select4(mask, CM_Splat4(tw->start[0] - tw->sphere.offset[0]), CM_Splat4(tw->start[0] + tw->sphere.offset[0]));
+			sy = CM_Select4(mask, CM_Splat4(tw->start[1] - tw->sphere.offset[1]), CM_Splat4(tw->start[1] + tw->sphere.offset[1]));
+			sz = CM_Select4(mask, CM_Splat4(tw->start[2] - tw->sphere.offset[2]), CM_Splat4(tw->start[2] + tw->sphere.offset[2]));
+			ex = CM_Select4(mask, CM_Splat4(tw->end[0] - tw->sphere.offset[0]), CM_Splat4(tw->end[0] + tw->sphere.offset[0]));
+			ey = CM_Select4(mask, CM_Splat4(tw->end[1] - tw->sphere.offset[1]), CM_Splat4(tw->end[1] + tw->sphere.offset[1]));
+			ez = CM_Select4(mask, CM_Splat4(tw->end[2] - tw->sphere.offset[2]), CM_Splat4(tw->end[2] + tw->sphere.offset[2]));
+
+			d1 = CM_Sub4(CM_Add4(CM_Add4(CM_Mul4(sx, x), CM_Mul4(sy, y)), CM_Mul4(sz, z)), dist);
+			d2 = CM_Sub4(CM_Add4(CM_Add4(CM_Mul4(ex, x), CM_Mul4(ey, y)), CM_Mul4(ez, z)), dist);
+		}
+		else
+		{
+			cmVec4_t ox, oy, oz;
+
+			// adjust the plane distance apropriately for mins/maxs,
+			// picking the corner by the sign of each normal component is what the signbits do
+			ox   = CM_Select4(CM_Gt4(zero, x), CM_Splat4(tw->size[1][0]), CM_Splat4(tw->size[0][0]));
+			oy   = CM_Select4(CM_Gt4(zero, y), CM_Splat4(tw->size[1][1]), CM_Splat4(tw->size[0][1]));
+			oz   = CM_Select4(CM_Gt4(zero, z), CM_Splat4(tw->size[1][2]), CM_Splat4(tw->size[0][2]));
+			dist = CM_Sub4(dist, CM_Add4(CM_Add4(CM_Mul4(ox, x), CM_Mul4(oy, y)), CM_Mul4(oz, z)));
+
+			d1 = CM_Sub4(CM_Add4(CM_Add4(CM_Mul4(CM_Splat4(tw->start[0]), x), CM_Mul4(CM_Splat4(tw->start[1]), y)), CM_Mul4(CM_Splat4(tw->start[2]), z)), dist);
+			d2 = CM_Sub4(CM_Add4(CM_Add4(CM_Mul4(CM_Splat4(tw->end[0]), x), CM_Mul4(CM_Splat4(tw->end[1]), y)), CM_Mul4(CM_Splat4(tw->end[2]), z)), dist);
+		}
+
+		// if completely in front of face, no intersection with the entire brush
+		mask = CM_And4(CM_Gt4(d1, zero), CM_Or4(CM_Ge4(d2, eps), CM_Ge4(d2, d1)));
+		if (CM_Mask4(mask) & valid)
+		{
+			return qfalse;
+		}
+
+		if (CM_Mask4(CM_Gt4(d2, zero)) & valid)
+		{
+			*getout = qtrue; // endpoint is not in solid
+		}
+		if (CM_Mask4(CM_Gt4(d1, zero)) & valid)
+		{
+			*startout = qtrue;
+		}
+
+		// only the sides crossed by the trace are relevant
+		cross = CM_Mask4(CM_Or4(CM_Gt4(d1, zero), CM_Gt4(d2, zero))) & valid;
+		if (!cross)
+		{
+			continue;
+		}
+
+		CM_Store4(d1s, d1);
+		CM_Store4(d2s, d2);
+
+		for (j = 0; j < 4; j++)
+		{
+			if (!(cross & (1 << j)))
+			{
+				continue;
+			}
+
+			side = brush->sides + i + j;
+
+			// crosses face
+			if (d1s[j] > d2s[j])      // enter
+			{
+				f = (d1s[j] - SURFACE_CLIP_EPSILON) / (d1s[j] - d2s[j]);
+				if (f < 0)
+				{
+					f = 0;
+				}
+				if (f > *enterFrac)
+				{
+					*enterFrac = f;
+					*clipplane = side->plane;
+					*leadside  = side;
+				}
+			}
+			else        // leave
+			{
+				f = (d1s[j] + SURFACE_CLIP_EPSILON) / (d1s[j] - d2s[j]);
+				if (f > 1)
+				{
+					f = 1;
+				}
+				if (f < *leaveFrac)
+				{
+					*leaveFrac = f;
+				}
+			}
+		}
+	}
+
+	return qtrue;
+}
+#endif
+
 /**
  * @brief CM_TraceThroughBrush
  * @param[in,out] tw
@@ -617,13 +862,27 @@ static void CM_TraceThroughBrush(traceWork_t *tw, cbrush_t *brush)
 		return;
 	}
 
-	c_brush_traces++;
+	if (!tw->visited)
+	{
+		c_brush_traces++;   // for statistics, not counted in jobs
+	}
 
 	getout   = qfalse;
 	startout = qfalse;
 
 	leadside = NULL;
 
+#ifdef CM_SIMD
+	// the box hull planes change all the time and have no copy
+	if (cm.sideDists && !cm_scalarTraces && brush < cm.brushes + cm.numBrushes)
+	{
+		if (!CM_TraceThroughBrushSidesSIMD(tw, brush, &enterFrac, &leaveFrac, &getout, &startout, &clipplane, &leadside))
+		{
+			return;
+		}
+	}
+	else
+#endif
 	if (tw->sphere.use)
 	{
 		vec3_t startp;
@@ -810,20 +1069,19 @@ static void CM_TraceThroughBrush(traceWork_t *tw, cbrush_t *brush)
  */
 static void CM_TraceThroughLeaf(traceWork_t *tw, cLeaf_t *leaf)
 {
-	int      k;
+	int      k, brushnum;
 	cbrush_t *brush;
 	float    fraction;
 
 	// trace line against all brushes in the leaf
 	for (k = 0 ; k < leaf->numLeafBrushes ; k++)
 	{
-		// brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
-		brush = &cm.brushes[cm.leafbrushes[leaf->firstLeafBrush + k]];
-		if (brush->checkcount == cm.checkcount)
+		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
+		brush    = &cm.brushes[brushnum];
+		if (!CM_CheckOnce(tw, &brush->checkcount, brushnum + 1))
 		{
 			continue;   // already checked this brush in another leaf
 		}
-		brush->checkcount = cm.checkcount;
 
 		if (!(brush->contents & tw->contents))
 		{
@@ -857,19 +1115,20 @@ static void CM_TraceThroughLeaf(traceWork_t *tw, cLeaf_t *leaf)
 	if (!cm_noCurves->integer)
 	{
 		cPatch_t *patch;
+		int      surfnum;
 
 		for (k = 0 ; k < leaf->numLeafSurfaces ; k++)
 		{
-			patch = cm.surfaces[cm.leafsurfaces[leaf->firstLeafSurface + k]];
+			surfnum = cm.leafsurfaces[leaf->firstLeafSurface + k];
+			patch   = cm.surfaces[surfnum];
 			if (!patch)
 			{
 				continue;
 			}
-			if (patch->checkcount == cm.checkcount)
+			if (!CM_CheckOnce(tw, &patch->checkcount, -(surfnum + 1)))
 			{
 				continue;   // already checked this patch in another leaf
 			}
-			patch->checkcount = cm.checkcount;
 
 			if (!(patch->contents & tw->contents))
 			{
@@ -1401,21 +1660,31 @@ static void CM_Trace(trace_t *results, const vec3_t start, const vec3_t end,
                      const vec3_t mins, const vec3_t maxs,
                      clipHandle_t model, const vec3_t origin, int brushmask, qboolean capsule, sphere_t *sphere)
 {
-	int         i;
-	traceWork_t tw;
-	vec3_t      offset;
-	cmodel_t    *cmod;
-	qboolean    positionTest;
+	int            i;
+	traceWork_t    tw;
+	traceVisited_t visited;
+	vec3_t         offset;
+	cmodel_t       *cmod;
+	qboolean       positionTest;
 
 	cmod = CM_ClipHandleToModel(model);
 
-	cm.checkcount++;        // for multi-check avoidance
-
-	c_traces++;             // for statistics, may be zeroed
-
 	// fill in a default trace
 	Com_Memset(&tw, 0, sizeof(tw));
 	tw.trace.fraction = 1.0f;   // assume it goes the entire distance until shown otherwise
+
+	// for multi-check avoidance, traces in jobs run in parallel and keep their own list
+	if (Com_InJob())
+	{
+		Com_Memset(&visited, 0, sizeof(visited));
+		tw.visited = &visited;
+	}
+	else
+	{
+		tw.checkcount = ++cm.checkcount;
+
+		c_traces++;         // for statistics, may be zeroed
+	}
 	VectorCopy(origin, tw.modelOrigin);
 
 	if (!cm.numNodes)
@@ -1657,6 +1926,181 @@ static void CM_Trace(trace_t *results, const vec3_t start, const vec3_t end,
 	*results = tw.trace;
 }
 
+#define TRACE_CACHE_SIZE 1024   ///< must be a power of two
+
+/**
+ * @struct traceCacheKey_s
+ * @typedef traceCacheKey_t
+ * @brief Exact inputs of a world trace, compared bitwise so cached results are identical
+ */
+typedef struct traceCacheKey_s
+{
+	vec3_t start;
+	vec3_t end;
+	vec3_t mins;
+	vec3_t maxs;
+	int brushmask;
+	int capsule;
+} traceCacheKey_t;
+
+/**
+ * @struct traceCacheEntry_s
+ * @typedef traceCacheEntry_t
+ * @brief
+ */
+typedef struct traceCacheEntry_s
+{
+	traceCacheKey_t key;
+	trace_t trace;
+	int generation;                 ///< entry is valid while this matches traceCache.generation
+} traceCacheEntry_t;
+
+/**
+ * @struct traceCache_s
+ * @typedef traceCache_t
+ * @brief Results of the world traces done this frame, see CM_BoxTrace
+ */
+static struct traceCache_s
+{
+	traceCacheEntry_t entries[TRACE_CACHE_SIZE];
+	int generation;
+
+	traceCacheEntry_t *pending;     ///< slot picked by the last miss, filled by CM_TraceCacheStore
+	traceCacheKey_t pendingKey;
+
+	// statistics, see CM_TraceCacheStats_f
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int evictions;         ///< entries of the current frame overwritten by a colliding trace
+	unsigned int frames;
+} traceCache;
+
+static qboolean cm_noTraceCache;    ///< bypass the cache, see CM_TraceBench_f
+
+/**
+ * @brief Drops all cached trace results, called at frame boundaries and when the map changes
+ */
+void CM_InvalidateTraceCache(void)
+{
+	traceCache.generation++;
+	traceCache.pending = NULL;
+
+	// generation 0 marks unused entries
+	if (!traceCache.generation)
+	{
+		Com_Memset(traceCache.entries, 0, sizeof(traceCache.entries));
+		traceCache.generation = 1;
+	}
+
+	if (cm_traceCache && cm_traceCache->integer)
+	{
+		traceCache.frames++;
+	}
+}
+
+/**
+ * @brief Finds a world trace done earlier this frame with exactly the same inputs
+ * @param[in] start
+ * @param[in] end
+ * @param[in] mins may be NULL
+ * @param[in] maxs may be NULL
+ * @param[in] brushmask
+ * @param[in] capsule
+ * @return The cached entry or NULL, in which case the result should be passed to CM_TraceCacheStore
+ */
+static traceCacheEntry_t *CM_TraceCacheLookup(const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs,
+                                              int brushmask, qboolean capsule)
+{
+	traceCacheKey_t   *key = &traceCache.pendingKey;
+	traceCacheEntry_t *entry;
+	const uint32_t    *words;
+	uint32_t          hash = 2166136261u;
+	size_t            i;
+
+	Com_Memset(key, 0, sizeof(*key));
+	VectorCopy(start, key->start);
+	VectorCopy(end, key->end);
+	VectorCopy(mins ? mins : vec3_origin, key->mins);
+	VectorCopy(maxs ? maxs : vec3_origin, key->maxs);
+	key->brushmask = brushmask;
+	key->capsule   = capsule;
+
+	// FNV-1a over the raw bits
+	words = (const uint32_t *)key;
+	for (i = 0; i < sizeof(*key) / sizeof(uint32_t); i++)
+	{
+		hash = (hash ^ words[i]) * 16777619u;
+	}
+
+	entry = &traceCache.entries[(hash ^ (hash >> 16)) & (TRACE_CACHE_SIZE - 1)];
+
+	if (entry->generation == traceCache.generation)
+	{
+		if (!memcmp(&entry->key, key, sizeof(*key)))
+		{
+			traceCache.hits++;
+			traceCache.pending = NULL;
+			return entry;
+		}
+		traceCache.evictions++;
+	}
+
+	traceCache.misses++;
+	traceCache.pending = entry;
+	return NULL;
+}
+
+/**
+ * @brief Stores the result of the trace that missed in the last CM_TraceCacheLookup
+ * @param[in] trace
+ */
+static void CM_TraceCacheStore(const trace_t *trace)
+{
+	traceCacheEntry_t *entry = traceCache.pending;
+
+	if (!entry)
+	{
+		return;
+	}
+
+	entry->key        = traceCache.pendingKey;
+	entry->trace      = *trace;
+	entry->generation = traceCache.generation;
+
+	traceCache.pending = NULL;
+}
+
+/**
+ * @brief Prints the hit rate of the world trace cache, 'reset' clears the counters
+ */
+void CM_TraceCacheStats_f(void)
+{
+	unsigned int lookups = traceCache.hits + traceCache.misses;
+
+	if (Cmd_Argc() > 1 && !Q_stricmp(Cmd_Argv(1), "reset"))
+	{
+		traceCache.hits      = 0;
+		traceCache.misses    = 0;
+		traceCache.evictions = 0;
+		traceCache.frames    = 0;
+		return;
+	}
+
+	if (!cm_traceCache || !cm_traceCache->integer)
+	{
+		Com_Printf("World trace cache is disabled, set cm_traceCache 1 to enable it.\n");
+	}
+
+	Com_Printf("World trace cache: %u lookups in %u frames, %u hits (%.1f%%), %u misses, %u evictions\n",
+	           lookups, traceCache.frames, traceCache.hits, lookups ? 100.0 * traceCache.hits / lookups : 0.0,
+	           traceCache.misses, traceCache.evictions);
+	if (traceCache.frames)
+	{
+		Com_Printf("%.1f lookups and %.1f hits per frame\n",
+		           (double)lookups / traceCache.frames, (double)traceCache.hits / traceCache.frames);
+	}
+}
+
 /**
  * @brief CM_BoxTrace
  * @param[out] results
@@ -1672,7 +2116,24 @@ void CM_BoxTrace(trace_t *results, const vec3_t start, const vec3_t end,
                  const vec3_t mins, const vec3_t maxs,
                  clipHandle_t model, int brushmask, qboolean capsule)
 {
+	traceCacheEntry_t *entry;
+
+	// only the world is static for the duration of a frame, jobs may trace in parallel
+	if (model || !cm_traceCache || !cm_traceCache->integer || cm_noTraceCache || !cm.numNodes || Com_InJob())
+	{
+		CM_Trace(results, start, end, mins, maxs, model, vec3_origin, brushmask, capsule, NULL);
+		return;
+	}
+
+	entry = CM_TraceCacheLookup(start, end, mins, maxs, brushmask, capsule);
+	if (entry)
+	{
+		*results = entry->trace;
+		return;
+	}
+
 	CM_Trace(results, start, end, mins, maxs, model, vec3_origin, brushmask, capsule, NULL);
+	CM_TraceCacheStore(results);
 }
 
 /**
@@ -1789,3 +2250,98 @@ void CM_TransformedBoxTrace(trace_t *results, const vec3_t start, const vec3_t e
 
 	*results = trace;
 }
+
+/**
+ * @brief Traces a fixed random set of points, player boxes and capsules through
+ * the world with the scalar and the SIMD brush code and compares timings and results
+ */
+void CM_TraceBench_f(void)
+{
+#ifdef CM_SIMD
+	static const vec3_t playerMins = { -18, -18, -24 };
+	static const vec3_t playerMaxs = { 18, 18, 48 };
+	vec3_t              *starts, *ends;
+	trace_t             *results, tr;
+	const float         *mins, *maxs;
+	int                 count, i, k, mismatches = 0;
+	unsigned int        seed = 0x5eed;
+	int64_t             scalarTime, simdTime;
+	qboolean            capsule;
+
+	if (!cm.name[0])
+	{
+		Com_Printf("No map loaded.\n");
+		return;
+	}
+
+	if (!cm.sideDists)
+	{
+		Com_Printf("SIMD brush planes are not loaded, set cm_simd 1 and restart the map.\n");
+		return;
+	}
+
+	count = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 10000;
+	if (count <= 0)
+	{
+		Com_Printf("usage: cm_tracebench [count]\n");
+		return;
+	}
+
+	starts  = Z_Malloc(count * sizeof(*starts));
+	ends    = Z_Malloc(count * sizeof(*ends));
+	results = Z_Malloc(count * sizeof(*results));
+
+	// same corpus on every run
+	for (i = 0; i < count; i++)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			seed         = seed * 1664525 + 1013904223;
+			starts[i][k] = cm.cmodels[0].mins[k] + (seed >> 8) * (1.0f / 16777216.0f) * (cm.cmodels[0].maxs[k] - cm.cmodels[0].mins[k]);
+			seed         = seed * 1664525 + 1013904223;
+			ends[i][k]   = cm.cmodels[0].mins[k] + (seed >> 8) * (1.0f / 16777216.0f) * (cm.cmodels[0].maxs[k] - cm.cmodels[0].mins[k]);
+		}
+	}
+
+	cm_noTraceCache = qtrue;
+	cm_scalarTraces = qtrue;
+	scalarTime      = Sys_Microseconds();
+	for (i = 0; i < count; i++)
+	{
+		mins    = (i % 3) ? playerMins : vec3_origin;
+		maxs    = (i % 3) ? playerMaxs : vec3_origin;
+		capsule = (i % 3) == 2;
+		CM_BoxTrace(&results[i], starts[i], ends[i], mins, maxs, 0, CONTENTS_SOLID, capsule);
+	}
+	scalarTime = Sys_Microseconds() - scalarTime;
+
+	cm_scalarTraces = qfalse;
+	simdTime        = Sys_Microseconds();
+	for (i = 0; i < count; i++)
+	{
+		mins    = (i % 3) ? playerMins : vec3_origin;
+		maxs    = (i % 3) ? playerMaxs : vec3_origin;
+		capsule = (i % 3) == 2;
+		CM_BoxTrace(&tr, starts[i], ends[i], mins, maxs, 0, CONTENTS_SOLID, capsule);
+
+		if (tr.fraction != results[i].fraction || !VectorCompare(tr.endpos, results[i].endpos)
+		    || !VectorCompare(tr.plane.normal, results[i].plane.normal) || tr.plane.dist != results[i].plane.dist
+		    || tr.surfaceFlags != results[i].surfaceFlags || tr.contents != results[i].contents
+		    || tr.startsolid != results[i].startsolid || tr.allsolid != results[i].allsolid)
+		{
+			mismatches++;
+		}
+	}
+	simdTime = Sys_Microseconds() - simdTime;
+	cm_noTraceCache = qfalse;
+
+	Com_Printf("%i traces: scalar %.3f ms, simd %.3f ms (%.2fx), %i mismatches\n", count,
+	           scalarTime / 1000.0, simdTime / 1000.0, simdTime ? (double)scalarTime / simdTime : 0.0, mismatches);
+
+	Z_Free(results);
+	Z_Free(ends);
+	Z_Free(starts);
+#else
+	Com_Printf("This build has no SIMD brush tracing.\n");
+#endif
+}
@@ -122,6 +122,8 @@ cvar_t *com_timedemo;
 cvar_t *com_sv_running;
 cvar_t *com_cl_running;
 cvar_t *com_logfile;        // 1 = buffer log, 2 = flush after each print
+cvar_t *com_logAsync;       // write log files on a background thread
+cvar_t *com_logAsyncWait;   // msec a full log buffer may block before the write is dropped
 cvar_t *com_showtrace;
 cvar_t *com_version;
 cvar_t *com_buildScript;    // for automated data building scripts
@@ -313,6 +315,9 @@ void QDECL Com_Printf(const char *fmt, ...)
 					// data even if we are crashing
 					FS_ForceFlush(logfile);
 				}
+
+				// set up the file before the log writer thread gets to it
+				FS_SetAsync(logfile, qtrue);
 			}
 			else
 			{
@@ -427,6 +432,10 @@ void QDECL Com_Error(int code, const char *fmt, ...)
 	else if (code == ERR_DROP || code == ERR_DISCONNECT)
 	{
 		Com_Printf("********************\nERROR: %s\n********************\n", com_errorMessage);
+		if (logfile)
+		{
+			FS_Flush(logfile);
+		}
 		SV_Shutdown(va("Server crashed: %s", com_errorMessage));
 		CL_Disconnect(qtrue);
 		CL_FlushMemory();
@@ -974,7 +983,18 @@ int Com_RealTime(qtime_t *qtime)
 There is never any space between memblocks, and there will never be two
 contiguous free memblocks.
 
-The rover can be left pointing at a non-empty block
+Free blocks are kept in segregated free lists. Small sizes have one exact
+size class per ZONE_GRANULARITY step, so an allocation either pops the head
+of its own class or splits the first block of the next non-empty class.
+Larger sizes are binned by power of two. A bitmask of non-empty bins finds
+the next usable bin without walking the block list. The free list links
+live in the data area of the free block, so allocated blocks carry no extra
+header.
+
+Freed blocks are still coalesced with their neighbours in the address
+ordered block list before they are put back into a bin.
+
+The rover is only used as the cursor for Z_FreeTags.
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
@@ -984,6 +1004,12 @@ all big things are allocated on the hunk.
 #define ZONEID  0x1d4a11
 #define MINFRAGMENT 64
 
+#define ZONE_GRANULARITY    8       ///< size step of the exact size classes
+#define ZONE_SMALL_LIMIT    256     ///< sizes below this get an exact size class
+#define ZONE_SMALL_CLASSES  (ZONE_SMALL_LIMIT / ZONE_GRANULARITY)
+#define ZONE_BINS           64      ///< exact classes plus power of two bins, one bit each in binMask
+#define ZONE_BIN_SCAN       8       ///< blocks inspected in a power of two bin before moving up a bin
+
 /**
  * @struct zonedebug_s
  */
@@ -1009,6 +1035,36 @@ typedef struct memblock_s
 #endif
 } memblock_t;
 
+/**
+ * @struct zonefree_s
+ * @brief Free list links, stored right after the header of a free block
+ */
+typedef struct zonefree_s
+{
+	memblock_t *next, *prev;
+} zonefree_t;
+
+#define Z_FREELINKS(block) ((zonefree_t *)((byte *)(block) + sizeof(memblock_t)))
+
+/// smallest block that can hold its free list links once freed
+#define Z_MINBLOCK (PAD(sizeof(memblock_t) + sizeof(zonefree_t), ZONE_GRANULARITY))
+
+/**
+ * @struct zonestats_s
+ */
+typedef struct zonestats_s
+{
+	int allocs;             ///< allocations since the zone was cleared
+	int frees;              ///< frees since the zone was cleared
+	int exact;              ///< allocations served from their own size class
+	int splits;             ///< allocations that left a free fragment
+	int merges;             ///< frees merged with a neighbouring free block
+	int scanned;            ///< free blocks inspected in power of two bins
+	int timed;              ///< allocations timed, only done while developer is set
+	int64_t allocTime;      ///< total usec spent in the timed allocations
+	int maxAllocTime;       ///< slowest single allocation in usec
+} zonestats_t;
+
 /**
  * @struct memzone_s
  */
@@ -1018,6 +1074,10 @@ typedef struct
 	int used;               ///< total bytes used
 	memblock_t blocklist;   ///< start / end cap for linked list
 	memblock_t *rover;
+	memblock_t *bins[ZONE_BINS]; ///< segregated free lists
+	uint64_t binMask;       ///< bit set for every non-empty bin
+	int freeBlocks;         ///< blocks in the free lists
+	zonestats_t stats;
 } memzone_t;
 
 /// main zone for all "dynamic" memory allocation
@@ -1028,6 +1088,104 @@ static memzone_t *smallzone;
 
 static void Z_CheckHeap(void);
 
+/**
+ * @brief Z_SizeClass
+ * @param[in] size Block size including the header, a multiple of ZONE_GRANULARITY
+ * @return The free list bin holding blocks of this size
+ */
+static int Z_SizeClass(size_t size)
+{
+	int bin;
+
+	if (size < ZONE_SMALL_LIMIT)
+	{
+		return (int)(size / ZONE_GRANULARITY);
+	}
+
+	// one bin per power of two, starting at ZONE_SMALL_LIMIT
+	bin  = ZONE_SMALL_CLASSES;
+	size = size / (ZONE_SMALL_LIMIT * 2);
+	while (size && bin < ZONE_BINS - 1)
+	{
+		size >>= 1;
+		bin++;
+	}
+
+	return bin;
+}
+
+/**
+ * @brief Z_LowestBin
+ * @param[in] mask Non-zero bin mask
+ * @return Index of the lowest set bit
+ */
+static int Z_LowestBin(uint64_t mask)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(mask);
+#else
+	int bin = 0;
+
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		bin++;
+	}
+
+	return bin;
+#endif
+}
+
+/**
+ * @brief Z_LinkFree
+ * @param[in,out] zone
+ * @param[in,out] block Free block to put at the head of its bin
+ */
+static void Z_LinkFree(memzone_t *zone, memblock_t *block)
+{
+	int        bin    = Z_SizeClass(block->size);
+	zonefree_t *links = Z_FREELINKS(block);
+
+	links->prev = NULL;
+	links->next = zone->bins[bin];
+	if (links->next)
+	{
+		Z_FREELINKS(links->next)->prev = block;
+	}
+	zone->bins[bin] = block;
+	zone->binMask  |= (uint64_t)1 << bin;
+	zone->freeBlocks++;
+}
+
+/**
+ * @brief Z_UnlinkFree
+ * @param[in,out] zone
+ * @param[in] block Free block to take out of its bin, must be called before its size changes
+ */
+static void Z_UnlinkFree(memzone_t *zone, memblock_t *block)
+{
+	int        bin    = Z_SizeClass(block->size);
+	zonefree_t *links = Z_FREELINKS(block);
+
+	if (links->prev)
+	{
+		Z_FREELINKS(links->prev)->next = links->next;
+	}
+	else
+	{
+		zone->bins[bin] = links->next;
+		if (!links->next)
+		{
+			zone->binMask &= ~((uint64_t)1 << bin);
+		}
+	}
+	if (links->next)
+	{
+		Z_FREELINKS(links->next)->prev = links->prev;
+	}
+	zone->freeBlocks--;
+}
+
 /**
  * @brief Z_ClearZone
  * @param[out] zone
@@ -1039,6 +1197,11 @@ static void Z_ClearZone(memzone_t *zone, int size)
 
 	// set the entire zone to one free block
 
+	Com_Memset(zone->bins, 0, sizeof(zone->bins));
+	Com_Memset(&zone->stats, 0, sizeof(zone->stats));
+	zone->binMask    = 0;
+	zone->freeBlocks = 0;
+
 	zone->blocklist.next = zone->blocklist.prev = block =
 		( memblock_t * )((byte *)zone + sizeof(memzone_t));
 	zone->blocklist.tag  = 1;   // in use block
@@ -1051,7 +1214,9 @@ static void Z_ClearZone(memzone_t *zone, int size)
 	block->prev = block->next = &zone->blocklist;
 	block->tag  = 0;        // free block
 	block->id   = ZONEID;
-	block->size = size - sizeof(memzone_t);
+	block->size = (size - sizeof(memzone_t)) & ~(size_t)(ZONE_GRANULARITY - 1);
+
+	Z_LinkFree(zone, block);
 }
 
 /**
@@ -1099,6 +1264,7 @@ void Z_Free(void *ptr)
 	}
 
 	zone->used -= block->size;
+	zone->stats.frees++;
 	// set the block to something that should cause problems
 	// if it is referenced...
 	Com_Memset(ptr, 0xaa, block->size - sizeof(*block));
@@ -1109,6 +1275,7 @@ void Z_Free(void *ptr)
 	if (!other->tag)
 	{
 		// merge with previous free block
+		Z_UnlinkFree(zone, other);
 		other->size      += block->size;
 		other->next       = block->next;
 		other->next->prev = other;
@@ -1117,6 +1284,7 @@ void Z_Free(void *ptr)
 			zone->rover = other;
 		}
 		block = other;
+		zone->stats.merges++;
 	}
 
 	zone->rover = block;
@@ -1125,6 +1293,7 @@ void Z_Free(void *ptr)
 	if (!other->tag)
 	{
 		// merge the next free block onto the end
+		Z_UnlinkFree(zone, other);
 		block->size      += other->size;
 		block->next       = other->next;
 		block->next->prev = block;
@@ -1132,7 +1301,10 @@ void Z_Free(void *ptr)
 		{
 			zone->rover = block;
 		}
+		zone->stats.merges++;
 	}
+
+	Z_LinkFree(zone, block);
 }
 
 /**
@@ -1167,6 +1339,55 @@ void Z_FreeTags(int tag)
 	while (zone->rover != &zone->blocklist);
 }
 
+/**
+ * @brief Z_FindFree
+ * @param[in,out] zone
+ * @param[in] size Block size including the header
+ * @param[in] scanLimit Blocks to inspect in the power of two bin of size, -1 for all
+ * @return A free block of at least size bytes, or NULL
+ */
+static memblock_t *Z_FindFree(memzone_t *zone, size_t size, int scanLimit)
+{
+	memblock_t *block;
+	uint64_t   mask;
+	int        bin = Z_SizeClass(size);
+
+	if (bin < ZONE_SMALL_CLASSES)
+	{
+		// exact size class
+		if (zone->bins[bin])
+		{
+			zone->stats.exact++;
+			return zone->bins[bin];
+		}
+	}
+	else
+	{
+		// a power of two bin holds a range of sizes, take the first that fits
+		for (block = zone->bins[bin]; block && scanLimit; block = Z_FREELINKS(block)->next, scanLimit--)
+		{
+			zone->stats.scanned++;
+			if (block->size >= size)
+			{
+				return block;
+			}
+		}
+	}
+
+	// every block in a higher bin is big enough
+	if (bin + 1 >= ZONE_BINS)
+	{
+		return NULL;
+	}
+	mask = zone->binMask & (~(uint64_t)0 << (bin + 1));
+	if (!mask)
+	{
+		return NULL;
+	}
+
+	return zone->bins[Z_LowestBin(mask)];
+}
+
 // so we can track a block to find out when it's getting trashed
 memblock_t *debugblock;
 
@@ -1188,14 +1409,23 @@ void *Z_TagMalloc(size_t size, int tag)
 {
 #endif
 	size_t     extra;
-	memblock_t *start, *rover, *new, *base;
+	memblock_t *new, *base;
 	memzone_t  *zone;
+	int64_t    start = 0;
+	int        elapsed;
+	qboolean   timed = com_developer && com_developer->integer;
 
 	if (!tag)
 	{
 		Com_Error(ERR_FATAL, "Z_TagMalloc: tried to use a 0 tag");
 	}
 
+	// reading the clock costs about as much as the allocation itself
+	if (timed)
+	{
+		start = Sys_Microseconds();
+	}
+
 	if (tag == TAG_SMALL)
 	{
 		zone = smallzone;
@@ -1209,45 +1439,39 @@ void *Z_TagMalloc(size_t size, int tag)
 	allocSize = size;
 #endif
 
-	// scan through the block list looking for the first free block
-	// of sufficient size
-
 	size += sizeof(memblock_t);         // account for size of block header
 	size += 4;                          // space for memory trash tester
-	size  = PAD(size, sizeof(intptr_t)); // align to 32/64 bit boundary
-
-	base  = rover = zone->rover;
-	start = base->prev;
+	size  = PAD(size, ZONE_GRANULARITY); // align to 32/64 bit boundary and size class step
+	if (size < Z_MINBLOCK)
+	{
+		size = Z_MINBLOCK;              // room for the free list links once freed
+	}
 
-	do
+	base = Z_FindFree(zone, size, ZONE_BIN_SCAN);
+	if (!base)
+	{
+		// last resort before failing, the fitting block may be deep in its bin
+		base = Z_FindFree(zone, size, -1);
+	}
+	if (!base)
 	{
-		if (rover == start)
-		{
 #ifdef ZONE_DEBUG
-			Z_LogHeap();
+		Z_LogHeap();
 
-			Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %zu bytes from the %s zone: %s, line: %d (%s)",
-			          size, zone == smallzone ? "small" : "main", file, line, label);
+		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %zu bytes from the %s zone: %s, line: %d (%s)",
+		          size, zone == smallzone ? "small" : "main", file, line, label);
 #else
-			Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %zu bytes from the %s zone",
-			          size, zone == smallzone ? "small" : "main");
+		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %zu bytes from the %s zone",
+		          size, zone == smallzone ? "small" : "main");
 #endif
-			return NULL;
-		}
-		if (rover->tag)
-		{
-			base = rover = rover->next;
-		}
-		else
-		{
-			rover = rover->next;
-		}
+		return NULL;
 	}
-	while (base->tag || base->size < size);
+
+	Z_UnlinkFree(zone, base);
 
 	// found a block big enough
 	extra = base->size - size;
-	if (extra > MINFRAGMENT)
+	if (extra > MINFRAGMENT && extra >= Z_MINBLOCK)
 	{
 		// there will be a free fragment after the allocated block
 		new             = ( memblock_t * )((byte *)base + size);
@@ -1259,11 +1483,12 @@ void *Z_TagMalloc(size_t size, int tag)
 		new->next->prev = new;
 		base->next      = new;
 		base->size      = size;
+		Z_LinkFree(zone, new);
+		zone->stats.splits++;
 	}
 
 	base->tag = tag;            // no longer a free block
 
-	zone->rover = base->next;   // next allocation will start looking here
 	zone->used += base->size;   //
 
 	base->id = ZONEID;
@@ -1278,6 +1503,18 @@ void *Z_TagMalloc(size_t size, int tag)
 	// marker for memory trash testing
 	*( int * )((byte *)base + base->size - 4) = ZONEID;
 
+	zone->stats.allocs++;
+	if (timed)
+	{
+		elapsed                = (int)(Sys_Microseconds() - start);
+		zone->stats.allocTime += elapsed;
+		zone->stats.timed++;
+		if (elapsed > zone->stats.maxAllocTime)
+		{
+			zone->stats.maxAllocTime = elapsed;
+		}
+	}
+
 	return ( void * )((byte *)base + sizeof(memblock_t));
 }
 
@@ -1543,6 +1780,41 @@ static int  s_hunkTotal;
 static int s_zoneTotal;
 static int s_smallZoneTotal;
 
+/**
+ * @brief Print the allocator and fragmentation statistics of a zone
+ * @param[in] zone
+ * @param[in] name
+ */
+static void Z_PrintZoneStats(memzone_t *zone, const char *name)
+{
+	memblock_t  *block;
+	size_t      freeBytes = 0, largestFree = 0;
+	zonestats_t *stats    = &zone->stats;
+
+	for (block = zone->blocklist.next ; block != &zone->blocklist ; block = block->next)
+	{
+		if (!block->tag)
+		{
+			freeBytes += block->size;
+			if (block->size > largestFree)
+			{
+				largestFree = block->size;
+			}
+		}
+	}
+
+	Com_Printf("%s zone: %i free blocks, %zu bytes free, largest %zu, fragmentation %.1f%%\n", name,
+	           zone->freeBlocks, freeBytes, largestFree, freeBytes ? 100.f * (1.f - (float)largestFree / freeBytes) : 0.f);
+	Com_Printf("        %i allocs (%i exact class, %i split), %i frees (%i merges), %.2f blocks scanned per alloc\n",
+	           stats->allocs, stats->exact, stats->splits, stats->frees, stats->merges,
+	           stats->allocs ? (float)stats->scanned / stats->allocs : 0.f);
+	if (stats->timed)
+	{
+		Com_Printf("        %.3f usec avg, %i usec max per alloc, %.1f msec total in %i allocs timed with developer set\n",
+		           (double)stats->allocTime / stats->timed, stats->maxAllocTime, stats->allocTime / 1000.0, stats->timed);
+	}
+}
+
 /**
  * @brief Com_Meminfo_f
  */
@@ -1645,6 +1917,9 @@ void Com_Meminfo_f(void)
 	Com_Printf("        %9i bytes (%6.2f MB) in dynamic renderer\n", rendererBytes, rendererBytes / Square(1024.f));
 	Com_Printf("        %9i bytes (%6.2f MB) in dynamic other\n", zoneBytes - (botlibBytes + rendererBytes), (zoneBytes - (botlibBytes + rendererBytes)) / Square(1024.f));
 	Com_Printf("        %9i bytes (%6.2f MB) in small Zone memory (%i) blocks\n", smallZoneBytes, smallZoneBytes / Square(1024.f), smallZoneBlocks);
+	Com_Printf("\n");
+	Z_PrintZoneStats(mainzone, "main");
+	Z_PrintZoneStats(smallzone, "small");
 }
 
 /**
@@ -2985,6 +3260,10 @@ void Com_Init(char *commandLine)
 	com_developer = Cvar_Get("developer", "0", CVAR_TEMP);
 	com_logfile   = Cvar_Get("logfile", "0", CVAR_TEMP);
 
+	com_logAsync     = Cvar_GetAndDescribe("com_logAsync", "1", CVAR_ARCHIVE, "Writes the console and game logs on a background thread, applies to logs opened afterwards.");
+	com_logAsyncWait = Cvar_GetAndDescribe("com_logAsyncWait", "10", CVAR_ARCHIVE, "Milliseconds a log write may wait for a full log buffer before it is dropped.");
+	Cvar_CheckRange(com_logAsyncWait, 0, 1000, qtrue);
+
 	com_timescale = Cvar_Get("timescale", "1", CVAR_CHEAT | CVAR_SYSTEMINFO);
 	com_fixedtime = Cvar_Get("fixedtime", "0", CVAR_CHEAT);
 	com_showtrace = Cvar_Get("com_showtrace", "0", CVAR_CHEAT);
@@ -3045,6 +3324,11 @@ void Com_Init(char *commandLine)
 
 	Cmd_AddCommand("quit", Com_Quit_f, "Quits the game.");
 	Cmd_AddCommand("changeVectors", MSG_ReportChangeVectors_f, "Prints out a table from the current statistics for copying to code.");
+	Cmd_AddCommand("huffbench", MSG_HuffBench_f, "Compares the Huffman tree and lookup table codecs on the messages of a demo.");
+	Cmd_AddCommand("deltabench", MSG_DeltaBench_f, "Records entity and playerstate deltas with 'record', then compares the field and word diff change vectors on them.");
+	Cmd_AddCommand("cm_tracebench", CM_TraceBench_f, "Runs a fixed set of traces against the loaded map with the scalar and the SIMD brush code.");
+	Cmd_AddCommand("cm_tracecachestats", CM_TraceCacheStats_f, "Prints the hit rate of the world trace cache, 'reset' clears the counters.");
+	Cmd_AddCommand("logstats", Com_LogWriterStats_f, "Prints the queue, latency and drop counters of the log writer thread, 'reset' clears the counters.");
 	Cmd_AddCommand("writeconfig", Com_WriteConfig_f, "Write the config file to a specific name.");
 	Cmd_AddCommand("update", Com_Update_f, "Updates the game to latest version.");
 	Cmd_AddCommand("download", Com_Download_f, "Downloads a pk3 from the URL set in cvar com_downloadURL.");
@@ -3385,6 +3669,7 @@ void Com_Frame(void)
 	int            timeBeforeEvents;
 	int            timeBeforeClient;
 	int            timeAfter;
+	int            margin;
 
 	if (setjmp(abortframe))
 	{
@@ -3505,13 +3790,15 @@ void Com_Frame(void)
 			timeVal = Com_TimeVal(minUsec);
 		}
 
-		if (timeVal < 1000)
+		margin = NET_SleepMargin();
+
+		if (timeVal <= margin)
 		{
 			NET_Sleep(0);
 		}
 		else
 		{
-			NET_Sleep(timeVal - 1000);
+			NET_Sleep(timeVal - margin);
 		}
 	}
 	while (Com_TimeVal(minUsec));
@@ -3529,6 +3816,9 @@ void Com_Frame(void)
 
 	Cbuf_Execute();
 
+	// commands may have changed collision cvars
+	CM_InvalidateTraceCache();
+
 #if idppc
 	if (com_altivec->modified)
 	{
@@ -3588,6 +3878,7 @@ void Com_Frame(void)
 			timeBeforeClient = Sys_Milliseconds();
 		}
 
+		CM_InvalidateTraceCache();
 		CL_Frame(msec);
 
 		if (com_speeds->integer)
@@ -3677,6 +3968,8 @@ void Com_Shutdown(qboolean badProfile)
 
 	// FIXME: common defines more cmds - remove all see Cmd_AddCommand()
 
+	Com_StopWorkers();
+
 	// delete pid file
 	if (!badProfile && FS_FileExists(Cvar_VariableString("com_pidfile")))
 	{
@@ -3710,6 +4003,8 @@ void Com_Shutdown(qboolean badProfile)
 		logfile = 0;
 	}
 
+	Com_StopLogWriter();
+
 	if (com_journalFile)
 	{
 		FS_FCloseFile(com_journalFile);
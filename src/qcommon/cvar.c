@@ -48,6 +48,22 @@ int    cvar_numIndexes;
 static cvar_t *hashTable[FILE_HASH_SIZE];
 #define generateHashValue(fname) Q_GenerateHashValue(fname, FILE_HASH_SIZE, qtrue, qtrue)
 
+#define CVAR_CHANGE_LOG         256         ///< must be a power of two
+#define CVAR_CHANGE_SEQUENCE    0x3fffffff  ///< wraps the change sequence before it gets negative
+
+static int cvar_changeLog[CVAR_CHANGE_LOG];     ///< indexes of the last changed cvars, see Cvar_GetModified
+static int cvar_changeSequence;
+
+/**
+ * @brief Remembers a changed cvar for the modules polling them with Cvar_GetModified
+ * @param[in] var
+ */
+static void Cvar_LogChange(const cvar_t *var)
+{
+	cvar_changeLog[cvar_changeSequence & (CVAR_CHANGE_LOG - 1)] = var - cvar_indexes;
+	cvar_changeSequence = (cvar_changeSequence + 1) & CVAR_CHANGE_SEQUENCE;
+}
+
 /**
  * @brief Cvar_ValidateString
  * @param[in] s
@@ -568,6 +584,7 @@ cvar_t *Cvar_Get(const char *varName, const char *value, cvarFlags_t flags)
 	var->string            = CopyString(value);
 	var->modified          = qtrue;
 	var->modificationCount = 1;
+	Cvar_LogChange(var);
 	var->value             = Q_atof(var->string);
 	var->integer           = Q_atoi(var->string);
 	var->resetString       = CopyString(value);
@@ -759,6 +776,7 @@ cvar_t *Cvar_Set2(const char *var_name, const char *value, qboolean force)
 			var->latchedString = CopyString(value);
 			var->modified      = qtrue;
 			var->modificationCount++;
+			Cvar_LogChange(var);
 			return var;
 		}
 	}
@@ -778,6 +796,7 @@ cvar_t *Cvar_Set2(const char *var_name, const char *value, qboolean force)
 	}
 	var->modified = qtrue;
 	var->modificationCount++;
+	Cvar_LogChange(var);
 
 	Z_Free(var->string);     // free the old value string
 
@@ -1413,6 +1432,8 @@ cvar_t *Cvar_Unset(cvar_t *cv)
 	// note what types of cvars have been modified (userinfo, archive, serverinfo, systeminfo)
 	cvar_modifiedFlags |= cv->flags;
 
+	Cvar_LogChange(cv);
+
 	if (cv->name)
 	{
 		Z_Free(cv->name);
@@ -1878,6 +1899,36 @@ void Cvar_Update(vmCvar_t *vmCvar)
 	vmCvar->integer = cv->integer;
 }
 
+/**
+ * @brief Lets the interpreted modules update only the cvars changed since their last call
+ * instead of calling Cvar_Update for all of them every frame
+ * @param[in,out] sequence Position in the change log, the module starts with -1
+ * @param[out] handles Handles of the changed cvars, may contain duplicates
+ * @param[in] maxHandles
+ * @return Number of handles, -1 if the changes are unknown or don't fit
+ * and the module has to update all of its cvars
+ */
+int Cvar_GetModified(int *sequence, int *handles, int maxHandles)
+{
+	int seq   = *sequence;
+	int count = 0;
+
+	*sequence = cvar_changeSequence;
+
+	// first call, wrapped sequence or overflowed log
+	if (seq < 0 || seq > cvar_changeSequence || cvar_changeSequence - seq > MIN(maxHandles, CVAR_CHANGE_LOG))
+	{
+		return -1;
+	}
+
+	for ( ; seq != cvar_changeSequence; seq++)
+	{
+		handles[count++] = cvar_changeLog[seq & (CVAR_CHANGE_LOG - 1)];
+	}
+
+	return count;
+}
+
 /**
  * @brief Cvar_CompleteCvarName
  * @param[in] args
@@ -329,6 +329,7 @@ typedef struct
 {
 	qfile_ut handleFiles;
 	qboolean handleSync;
+	qboolean handleAsync;               ///< writes are queued for the log writer thread
 	int fileSize;
 	int zipFilePos;
 	int zipFileLen;
@@ -1131,6 +1132,10 @@ void FS_FCloseFile(fileHandle_t f)
 	// we didn't find it as a pak, so close it as a unique file
 	if (fsh[f].handleFiles.file.o)
 	{
+		if (fsh[f].handleAsync)
+		{
+			Com_FlushLogWriter();
+		}
 		fclose(fsh[f].handleFiles.file.o);
 	}
 	Com_Memset(&fsh[f], 0, sizeof(fsh[f]));
@@ -2295,6 +2300,11 @@ int FS_Write(const void *buffer, int len, fileHandle_t h)
 	f   = FS_FileForHandle(h);
 	buf = (byte *)buffer;
 
+	if (fsh[h].handleAsync)
+	{
+		return Com_LogWrite(f, fsh[h].handleSync, buffer, len);
+	}
+
 	remaining = len;
 	tries     = 0;
 	while (remaining)
@@ -5301,6 +5311,12 @@ int FS_FOpenFileByMode(const char *qpath, fileHandle_t *f, fsMode_t mode)
 	}
 	fsh[*f].handleSync = sync;
 
+	// appends of the modules are logs, keep them off the frame
+	if (*f && (mode == FS_APPEND || mode == FS_APPEND_SYNC))
+	{
+		FS_SetAsync(*f, qtrue);
+	}
+
 	return r;
 }
 
@@ -5324,6 +5340,11 @@ int FS_FTell(fileHandle_t f)
 	}
 	else
 	{
+		if (fsh[f].handleAsync)
+		{
+			Com_FlushLogWriter();
+		}
+
 		pos = ftell(fsh[f].handleFiles.file.o);
 
 		if (pos == -1)
@@ -5341,9 +5362,37 @@ int FS_FTell(fileHandle_t f)
  */
 void FS_Flush(fileHandle_t f)
 {
+	if (fsh[f].handleAsync)
+	{
+		Com_FlushLogWriter();
+	}
 	fflush(fsh[f].handleFiles.file.o);
 }
 
+/**
+ * @brief Lets the log writer thread write to a file opened for writing or appending
+ * @param[in] f
+ * @param[in] async
+ * @note Only for files written by the main thread, which don't seek or read back
+ */
+void FS_SetAsync(fileHandle_t f, qboolean async)
+{
+	if (fsh[f].zipFile || !fsh[f].handleFiles.file.o)
+	{
+		return;
+	}
+
+	async = async && Com_StartLogWriter();
+
+	// queued writes have to reach the file before it is written directly
+	if (!async && fsh[f].handleAsync)
+	{
+		Com_FlushLogWriter();
+	}
+
+	fsh[f].handleAsync = async;
+}
+
 /**
  * @brief FS_FilenameCompletion
  * @param[in] dir
@@ -38,6 +38,9 @@
 #include "q_shared.h"
 #include "qcommon.h"
 
+// bit offset used by the adaptive (de)compressor, the offset based
+// functions below keep their position in the caller provided offset
+// so they can be used from several threads at once
 static int bloc = 0;
 
 /**
@@ -50,16 +53,14 @@ void Huff_putBit(int bit, byte *fout, int *offset)
 {
 	int x, y;
 
-	bloc = *offset;
-	x    = bloc >> 3;
-	y    = bloc & 7;
+	x = *offset >> 3;
+	y = *offset & 7;
 	if (!y)
 	{
 		fout[x] = 0;
 	}
 	fout[x] |= bit << y;
-	bloc++;
-	*offset = bloc;
+	(*offset)++;
 }
 
 /**
@@ -72,10 +73,8 @@ int Huff_getBit(byte *fin, int *offset)
 {
 	int t;
 
-	bloc = *offset;
-	t    = fin[bloc >> 3] >> (bloc & 7) & 0x1;
-	bloc++;
-	*offset = bloc;
+	t = fin[*offset >> 3] >> (*offset & 7) & 0x1;
+	(*offset)++;
 	return t;
 }
 
@@ -84,13 +83,14 @@ int Huff_getBit(byte *fin, int *offset)
  *
  * @param[in] bit
  * @param[out] fout
+ * @param[in,out] offset
  */
-static void add_bit(const char bit, byte *fout)
+static void add_bit(const char bit, byte *fout, int *offset)
 {
 	int x, y;
 
-	y = bloc >> 3;
-	x = bloc++ & 7;
+	y = *offset >> 3;
+	x = (*offset)++ & 7;
 	if (!x)
 	{
 		fout[y] = 0;
@@ -101,14 +101,15 @@ static void add_bit(const char bit, byte *fout)
 /**
  * @brief get_bit
  * @param[in] fin
+ * @param[in,out] offset
  * @return
  */
-static int get_bit(byte *fin)
+static int get_bit(byte *fin, int *offset)
 {
 	int t;
 
-	t = fin[bloc >> 3] >> (bloc & 7) & 0x1;
-	bloc++;
+	t = fin[*offset >> 3] >> (*offset & 7) & 0x1;
+	(*offset)++;
 	return t;
 }
 
@@ -393,7 +394,7 @@ int Huff_Receive(node_t *node, int *ch, byte *fin)
 {
 	while (node && node->symbol == INTERNAL_NODE)
 	{
-		if (get_bit(fin))
+		if (get_bit(fin, &bloc))
 		{
 			node = node->right;
 		}
@@ -420,16 +421,17 @@ int Huff_Receive(node_t *node, int *ch, byte *fin)
  */
 void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxoffset)
 {
-	bloc = *offset;
+	int bit = *offset;
+
 	while (node && node->symbol == INTERNAL_NODE)
 	{
-		if (bloc >= maxoffset)
+		if (bit >= maxoffset)
 		{
 			*ch = 0;
 			*offset = maxoffset + 1;
 			return;
 		}
-		if (get_bit(fin))
+		if (get_bit(fin, &bit))
 		{
 			node = node->right;
 		}
@@ -445,7 +447,7 @@ void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxof
 		//Com_Error(ERR_DROP, "Illegal tree!");
 	}
 	*ch     = node->symbol;
-	*offset = bloc;
+	*offset = bit;
 }
 
 /**
@@ -453,28 +455,29 @@ void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxof
  * @param[in] node
  * @param[in] child
  * @param[in] fout
+ * @param[in,out] offset
  * @param[in] maxoffset
  */
-static void send(node_t *node, node_t *child, byte *fout, int maxoffset)
+static void send(node_t *node, node_t *child, byte *fout, int *offset, int maxoffset)
 {
 	if (node->parent)
 	{
-		send(node->parent, node, fout, maxoffset);
+		send(node->parent, node, fout, offset, maxoffset);
 	}
 	if (child)
 	{
-		if (bloc >= maxoffset)
+		if (*offset >= maxoffset)
 		{
-			bloc = maxoffset + 1;
+			*offset = maxoffset + 1;
 			return;
 		}
 		if (node->right == child)
 		{
-			add_bit(1, fout);
+			add_bit(1, fout, offset);
 		}
 		else
 		{
-			add_bit(0, fout);
+			add_bit(0, fout, offset);
 		}
 	}
 }
@@ -496,12 +499,12 @@ void Huff_transmit(huff_t *huff, int ch, byte *fout, int maxoffset)
 		Huff_transmit(huff, NYT, fout, maxoffset);
 		for (i = 7; i >= 0; i--)
 		{
-			add_bit((char)((ch >> i) & 0x1), fout);
+			add_bit((char)((ch >> i) & 0x1), fout, &bloc);
 		}
 	}
 	else
 	{
-		send(huff->loc[ch], NULL, fout, maxoffset);
+		send(huff->loc[ch], NULL, fout, &bloc, maxoffset);
 	}
 }
 
@@ -515,9 +518,252 @@ void Huff_transmit(huff_t *huff, int ch, byte *fout, int maxoffset)
  */
 void Huff_offsetTransmit(huff_t *huff, int ch, byte *fout, int *offset, int maxoffset)
 {
-	bloc = *offset;
-	send(huff->loc[ch], NULL, fout, maxoffset);
-	*offset = bloc;
+	send(huff->loc[ch], NULL, fout, offset, maxoffset);
+}
+
+/**
+ * @brief Builds the code and decode tables of a tree that no longer changes
+ *
+ * The tables give the same results as Huff_offsetTransmit and Huff_offsetReceive
+ * with the tree, a few bytes at a time instead of one bit at a time.
+ *
+ * @param[out] table
+ * @param[in] huff
+ */
+void Huff_BuildTable(huffTable_t *table, huff_t *huff)
+{
+	node_t *queue[HUFF_MAX_TABLES];
+	node_t *node;
+	short  tableOf[ARRAY_LEN(huff->nodeList)];
+	int    ch, i, bit, length, t;
+
+	Com_Memset(table, 0, sizeof(*table));
+	table->huff = huff;
+
+	// prefix codes, send() writes them starting at the root
+	for (ch = 0; ch <= HMAX; ch++)
+	{
+		if (!huff->loc[ch])
+		{
+			continue;
+		}
+
+		length = 0;
+		for (node = huff->loc[ch]; node->parent; node = node->parent)
+		{
+			length++;
+		}
+
+		if (length > 32)
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: Huff_BuildTable: code of symbol %i is too long, using the tree\n", ch);
+			return;
+		}
+
+		table->length[ch] = (byte)length;
+		for (i = length - 1, node = huff->loc[ch]; node->parent; node = node->parent, i--)
+		{
+			if (node->parent->right == node)
+			{
+				table->code[ch] |= 1u << i;
+			}
+		}
+	}
+
+	// one decode table for the root and each internal node HUFF_TABLE_BITS deeper
+	for (i = 0; i < (int)ARRAY_LEN(tableOf); i++)
+	{
+		tableOf[i] = -1;
+	}
+	queue[0]                             = huff->tree;
+	table->numTables                     = 1;
+	tableOf[huff->tree - huff->nodeList] = 0;
+
+	for (t = 0; t < table->numTables; t++)
+	{
+		for (i = 0; i < (1 << HUFF_TABLE_BITS); i++)
+		{
+			huffDecode_t *entry = &table->decode[t][i];
+
+			entry->symbol = HUFF_SLOW;
+			node          = queue[t];
+
+			for (bit = 0; bit < HUFF_TABLE_BITS && node && node->symbol == INTERNAL_NODE; bit++)
+			{
+				node = ((i >> bit) & 1) ? node->right : node->left;
+			}
+
+			if (!node)
+			{
+				continue;   // broken tree, let Huff_offsetReceive deal with it
+			}
+
+			entry->length = (byte)bit;
+
+			if (node->symbol != INTERNAL_NODE)
+			{
+				entry->symbol = (short)node->symbol;
+				continue;
+			}
+
+			if (tableOf[node - huff->nodeList] < 0)
+			{
+				if (table->numTables == HUFF_MAX_TABLES)
+				{
+					continue;
+				}
+				tableOf[node - huff->nodeList] = (short)table->numTables;
+				queue[table->numTables++]      = node;
+			}
+			entry->symbol = HUFF_SUBTABLE;
+			entry->next   = (byte)tableOf[node - huff->nodeList];
+		}
+	}
+
+	table->valid = qtrue;
+}
+
+/**
+ * @brief Returns the next HUFF_TABLE_BITS bits of a stream, bits past maxoffset are undefined
+ * @param[in] fin
+ * @param[in] offset
+ * @param[in] maxoffset
+ * @return
+ */
+static ID_INLINE int Huff_peekBits(const byte *fin, int offset, int maxoffset)
+{
+	int          x = offset >> 3;
+	unsigned int v = fin[x];
+
+	// don't read past the end of the buffer
+	if (((x + 1) << 3) < maxoffset)
+	{
+		v |= (unsigned int)fin[x + 1] << 8;
+	}
+
+	return (v >> (offset & 7)) & ((1 << HUFF_TABLE_BITS) - 1);
+}
+
+/**
+ * @brief Same as Huff_offsetReceive with the tree the table was built from
+ * @param[in] table
+ * @param[out] ch
+ * @param[in] fin
+ * @param[in,out] offset
+ * @param[in] maxoffset
+ */
+void Huff_tableReceive(const huffTable_t *table, int *ch, byte *fin, int *offset, int maxoffset)
+{
+	const huffDecode_t *entry;
+	int                bit = *offset;
+	int                t   = 0;
+
+	while (bit < maxoffset)
+	{
+		entry = &table->decode[t][Huff_peekBits(fin, bit, maxoffset)];
+
+		// codes running past the end of the data are handled by the tree walk
+		if (entry->symbol == HUFF_SLOW || bit + entry->length > maxoffset)
+		{
+			break;
+		}
+
+		bit += entry->length;
+
+		if (entry->symbol != HUFF_SUBTABLE)
+		{
+			*ch     = entry->symbol;
+			*offset = bit;
+			return;
+		}
+
+		t = entry->next;
+	}
+
+	Huff_offsetReceive(table->huff->tree, ch, fin, offset, maxoffset);
+}
+
+/**
+ * @brief Writes bits in stream order and clears bytes along the way like add_bit()
+ * @param[in] bits
+ * @param[in] count
+ * @param[out] fout
+ * @param[in,out] offset
+ */
+static void Huff_writeBits(uint64_t bits, int count, byte *fout, int *offset)
+{
+	int x    = *offset >> 3;
+	int y    = *offset & 7;
+	int used = 8 - y;
+
+	*offset += count;
+
+	if (y)
+	{
+		fout[x++] |= (byte)(bits << y);
+		if (count <= used)
+		{
+			return;
+		}
+		bits  >>= used;
+		count  -= used;
+	}
+
+	for ( ; count > 0; count -= 8)
+	{
+		fout[x++] = (byte)bits;
+		bits    >>= 8;
+	}
+}
+
+/**
+ * @brief Writes the codes of the lowest count bytes of value, lowest byte first
+ *
+ * Same output as calling Huff_offsetTransmit for each byte. Nothing is written
+ * if the codes wouldn't fit entirely before maxoffset, the caller has to fall
+ * back to Huff_offsetTransmit to get its overflow behaviour.
+ *
+ * @param[in] table
+ * @param[in] value
+ * @param[in] count Number of bytes, at most 4
+ * @param[out] fout
+ * @param[in,out] offset
+ * @param[in] maxoffset
+ * @return qfalse if nothing was written
+ */
+qboolean Huff_tableTransmitBytes(const huffTable_t *table, unsigned int value, int count, byte *fout, int *offset, int maxoffset)
+{
+	uint64_t acc = 0;
+	int      bits = 0, total = 0, i, ch;
+
+	for (i = 0; i < count; i++)
+	{
+		total += table->length[(value >> (i << 3)) & 0xff];
+	}
+
+	if (*offset + total >= maxoffset)
+	{
+		return qfalse;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		ch = (value >> (i << 3)) & 0xff;
+
+		if (bits + table->length[ch] > 64)
+		{
+			Huff_writeBits(acc, bits, fout, offset);
+			acc  = 0;
+			bits = 0;
+		}
+
+		acc  |= (uint64_t)table->code[ch] << bits;
+		bits += table->length[ch];
+	}
+
+	Huff_writeBits(acc, bits, fout, offset);
+
+	return qtrue;
 }
 
 /**
@@ -572,7 +818,7 @@ void Huff_Decompress(msg_t *mbuf, int offset)
 			ch = 0;
 			for (i = 0; i < 8; i++)
 			{
-				ch = (ch << 1) + get_bit(buffer);
+				ch = (ch << 1) + get_bit(buffer, &bloc);
 			}
 		}
 
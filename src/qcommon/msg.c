@@ -42,13 +42,24 @@
 // redefined when included, producing a lot of recursive declarations errors...)
 #include "../game/g_public.h"
 
-static huffman_t msgHuff;
-static qboolean  msgInit = qfalse;
+/// change vectors of entity and player states are built four words at a time with SSE2 or NEON
+#if defined(ETL_ENABLE_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MSG_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define MSG_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+static huffman_t   msgHuff;
+static huffTable_t msgHuffTable;    ///< lookup tables for msgHuff, which doesn't change after MSG_initHuffman
+static qboolean    msgInit = qfalse;
 
-int pcount[256];
-int wastedbits = 0;
+// debugging counters, per thread as snapshots are also encoded by the worker pool
+THREAD_LOCAL int pcount[256];
+THREAD_LOCAL int wastedbits = 0;
 
-static int oldsize = 0;
+static THREAD_LOCAL int oldsize = 0;
 
 /*
 ==============================================================================
@@ -272,6 +283,11 @@ void MSG_WriteBits(msg_t *msg, int value, int bits)
 			}
 			bits = bits - nbits;
 		}
+		// all bytes at once unless the message is about to overflow
+		if (bits && msgHuffTable.valid && Huff_tableTransmitBytes(&msgHuffTable, (unsigned int)value, bits >> 3, msg->data, &msg->bit, msg->maxsize << 3))
+		{
+			bits = 0;
+		}
 		if (bits)
 		{
 			for (i = 0; i < bits; i += 8)
@@ -380,7 +396,14 @@ int MSG_ReadBits(msg_t *msg, int bits)
 
 			for (i = 0; i < bits; i += 8)
 			{
-				Huff_offsetReceive(msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize << 3);
+				if (msgHuffTable.valid)
+				{
+					Huff_tableReceive(&msgHuffTable, &get, msg->data, &msg->bit, msg->cursize << 3);
+				}
+				else
+				{
+					Huff_offsetReceive(msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize << 3);
+				}
 				value = (unsigned int)value | ((unsigned int)get << (i + nbits));
 
 				if (msg->bit > msg->cursize << 3)
@@ -1232,6 +1255,261 @@ void MSG_PrioritiseEntitystateFields(void)
 #define FLOAT_INT_BITS  13
 #define FLOAT_INT_BIAS  (1 << (FLOAT_INT_BITS - 1))
 
+/// bitmask words needed for one bit per 32 bit word of a struct
+#define MSG_DIFF_WORDS(type)    ((sizeof(type) / 4 + 31) >> 5)
+/// bitmask words needed for one bit per field of a field table
+#define MSG_FIELD_WORDS(fields) ((ARRAY_LEN(fields) + 31) >> 5)
+
+static short entityWordField[sizeof(entityState_t) / 4];    ///< entityStateFields index of every word, -1 if not sent
+static short playerWordField[sizeof(playerState_t) / 4];    ///< playerStateFields index of every word, -1 if not sent
+
+static qboolean msg_scalarDeltas;   ///< compare field by field, see MSG_DeltaBench_f
+
+/**
+ * @struct msgDeltaBench_s
+ * @brief Deltas recorded from the running server for MSG_DeltaBench_f
+ */
+typedef struct msgDeltaBench_s
+{
+	qboolean recording;
+	entityState_t *entities;        ///< from and to state of each entity delta
+	playerState_t *players;         ///< from and to state of each playerstate delta
+	int maxEntities, maxPlayers;
+	volatile int numEntities;       ///< claimed slots, may exceed maxEntities
+	volatile int numPlayers;        ///< claimed slots, may exceed maxPlayers
+} msgDeltaBench_t;
+
+static msgDeltaBench_t msgDeltaBench;
+
+#if defined(MSG_SIMD_SSE2)
+/**
+ * @brief Compares four words
+ * @param[in] a
+ * @param[in] b
+ * @return A bit for each of the four words that differs
+ */
+static ID_INLINE int MSG_Differ4(const int *a, const int *b)
+{
+	__m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b));
+
+	return ~_mm_movemask_ps(_mm_castsi128_ps(equal)) & 15;
+}
+#elif defined(MSG_SIMD_NEON)
+/**
+ * @brief Compares four words
+ * @param[in] a
+ * @param[in] b
+ * @return A bit for each of the four words that differs
+ */
+static ID_INLINE int MSG_Differ4(const int *a, const int *b)
+{
+	static const int32_t shifts[4] = { 0, 1, 2, 3 };
+	uint32x4_t           differ    = vmvnq_u32(vceqq_s32(vld1q_s32(a), vld1q_s32(b)));
+
+	return vaddvq_u32(vshlq_u32(vshrq_n_u32(differ, 31), vld1q_s32(shifts)));
+}
+#endif
+
+/**
+ * @brief MSG_LowestBit
+ * @param[in] bits Non-zero bitmask
+ * @return Index of the lowest set bit
+ */
+static ID_INLINE int MSG_LowestBit(uint32_t bits)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(bits);
+#else
+	int i = 0;
+
+	while (!(bits & 1))
+	{
+		bits >>= 1;
+		i++;
+	}
+
+	return i;
+#endif
+}
+
+/**
+ * @brief Sets a bit in diff for every 32 bit word that differs between from and to
+ * @param[in] from
+ * @param[in] to
+ * @param[in] numWords
+ * @param[out] diff
+ */
+static void MSG_DiffWords(const int *from, const int *to, int numWords, uint32_t *diff)
+{
+	int i = 0;
+
+	Com_Memset(diff, 0, ((numWords + 31) >> 5) * sizeof(uint32_t));
+
+#if defined(MSG_SIMD_SSE2) || defined(MSG_SIMD_NEON)
+	for ( ; i + 4 <= numWords; i += 4)
+	{
+		diff[i >> 5] |= (uint32_t)MSG_Differ4(from + i, to + i) << (i & 31);
+	}
+#endif
+	for ( ; i < numWords; i++)
+	{
+		if (from[i] != to[i])
+		{
+			diff[i >> 5] |= 1u << (i & 31);
+		}
+	}
+}
+
+/**
+ * @brief Extracts the bits of consecutive words from a word diff
+ * @param[in] diff
+ * @param[in] first Index of the first word
+ * @param[in] count Number of words, at most 32
+ * @return A bit for each of the words that differs
+ */
+static ID_INLINE int MSG_DiffBits(const uint32_t *diff, int first, int count)
+{
+	uint64_t bits = diff[first >> 5];
+
+	if ((first & 31) + count > 32)
+	{
+		bits |= (uint64_t)diff[(first >> 5) + 1] << 32;
+	}
+
+	return (int)((bits >> (first & 31)) & (((uint64_t)1 << count) - 1));
+}
+
+/**
+ * @brief Change bits of an int array, taken from the word diff unless msg_scalarDeltas is set
+ * @param[in] diff See MSG_ChangeVector, not filled for msg_scalarDeltas
+ * @param[in] first Word index of the first element
+ * @param[in] from
+ * @param[in] to
+ * @param[in] count Number of elements, at most 32
+ * @return A bit for each of the elements that differs
+ */
+static ID_INLINE int MSG_ArrayBits(const uint32_t *diff, int first, const int *from, const int *to, int count)
+{
+	int i, bits = 0;
+
+	if (!msg_scalarDeltas)
+	{
+		return MSG_DiffBits(diff, first, count);
+	}
+
+	// the reference, element by element
+	for (i = 0; i < count; i++)
+	{
+		if (to[i] != from[i])
+		{
+			bits |= 1 << i;
+		}
+	}
+
+	return bits;
+}
+
+/**
+ * @brief Maps the words of a struct to the fields of its field table
+ * @param[in] fields
+ * @param[in] numFields
+ * @param[out] wordField
+ * @param[in] numWords
+ */
+static void MSG_InitWordFields(const netField_t *fields, int numFields, short *wordField, int numWords)
+{
+	int i;
+
+	for (i = 0; i < numWords; i++)
+	{
+		wordField[i] = -1;
+	}
+	for (i = 0; i < numFields; i++)
+	{
+		wordField[fields[i].offset >> 2] = i;
+	}
+}
+
+/**
+ * @brief Builds the change vector of a delta in one pass over the struct
+ * @param[in,out] fields Field table, the used counters are updated outside of jobs
+ * @param[in] numFields
+ * @param[in] wordField Field index of every word of the struct
+ * @param[in] from
+ * @param[in] to
+ * @param[in] numWords Size of the struct in words
+ * @param[out] diff A bit for every word that differs, left alone for msg_scalarDeltas
+ * @param[out] changed A bit for every field that differs
+ * @return Number of fields up to and including the last changed one
+ */
+static int MSG_ChangeVector(netField_t *fields, int numFields, const short *wordField,
+                            const int *from, const int *to, int numWords, uint32_t *diff, uint32_t *changed)
+{
+	int      i, field, lc = 0;
+	uint32_t bits;
+	int      used = Com_InJob() ? 0 : 1;   // the field tables are shared, only count on the main thread
+
+	Com_Memset(changed, 0, ((numFields + 31) >> 5) * sizeof(uint32_t));
+
+	if (msg_scalarDeltas)
+	{
+		// the reference, every field compared through the field table
+		for (i = 0; i < numFields; i++)
+		{
+			if (*(const int *)((const byte *)from + fields[i].offset) != *(const int *)((const byte *)to + fields[i].offset))
+			{
+				changed[i >> 5] |= 1u << (i & 31);
+				fields[i].used += used;
+				lc = i + 1;
+			}
+		}
+		return lc;
+	}
+
+	MSG_DiffWords(from, to, numWords, diff);
+
+	// only visit the words that differ
+	for (i = 0; i < (numWords + 31) >> 5; i++)
+	{
+		for (bits = diff[i]; bits; bits &= bits - 1)
+		{
+			field = wordField[(i << 5) + MSG_LowestBit(bits)];
+			if (field < 0)
+			{
+				continue;
+			}
+
+			changed[field >> 5] |= 1u << (field & 31);
+			fields[field].used += used;
+			if (field >= lc)
+			{
+				lc = field + 1;
+			}
+		}
+	}
+
+	return lc;
+}
+
+/**
+ * @brief Claims a slot for a delta when recording for MSG_DeltaBench_f
+ * @param[in] count Claimed slots so far
+ * @param[in] max
+ * @return The slot or -1 when full, can be called from snapshot jobs
+ */
+static int MSG_RecordDelta(volatile int *count, int max)
+{
+	int slot;
+
+	if (*count >= max)
+	{
+		return -1;
+	}
+	slot = Com_AtomicIncrement(count) - 1;
+
+	return slot < max ? slot : -1;
+}
+
 /**
  * @brief Writes part of a packetentities message, including the entity number.
  * Can delta from either a baseline or a previous packet_entity
@@ -1245,12 +1523,14 @@ void MSG_PrioritiseEntitystateFields(void)
  */
 void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qboolean force)
 {
-	int        i, lc;
+	int        i, lc, slot;
 	int        numFields = sizeof(entityStateFields) / sizeof(entityStateFields[0]);
 	netField_t *field;
 	int        trunc;
 	float      fullFloat;
-	int        *fromF, *toF;
+	int        *toF;
+	uint32_t   diff[MSG_DIFF_WORDS(entityState_t)];
+	uint32_t   changed[MSG_FIELD_WORDS(entityStateFields)];
 
 	// all fields should be 32 bits to avoid any compiler packing issues
 	// the "number" field is not part of the field list
@@ -1279,20 +1559,15 @@ void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qb
 		Com_Error(ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number: %i", to->number);
 	}
 
-	lc = 0;
-	// build the change vector as bytes so it is endien independent
-	for (i = 0, field = entityStateFields ; i < numFields ; i++, field++)
+	if (msgDeltaBench.recording && (slot = MSG_RecordDelta(&msgDeltaBench.numEntities, msgDeltaBench.maxEntities)) >= 0)
 	{
-		fromF = ( int * )((byte *)from + field->offset);
-		toF   = ( int * )((byte *)to + field->offset);
-		if (*fromF != *toF)
-		{
-			lc = i + 1;
-
-			field->used++;
-		}
+		msgDeltaBench.entities[slot * 2]     = *from;
+		msgDeltaBench.entities[slot * 2 + 1] = *to;
 	}
 
+	// build the change vector as bits so it is endien independent
+	lc = MSG_ChangeVector(entityStateFields, numFields, entityWordField, (int *)from, (int *)to, sizeof(*from) / 4, diff, changed);
+
 	if (lc == 0)
 	{
 		// nothing at all changed
@@ -1319,10 +1594,7 @@ void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qb
 
 	for (i = 0, field = entityStateFields ; i < lc ; i++, field++)
 	{
-		fromF = ( int * )((byte *)from + field->offset);
-		toF   = ( int * )((byte *)to + field->offset);
-
-		if (*fromF == *toF)
+		if (!(changed[i >> 5] & (1u << (i & 31))))
 		{
 			MSG_WriteBits(msg, 0, 1);   // no change
 
@@ -1331,6 +1603,8 @@ void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qb
 			continue;
 		}
 
+		toF = ( int * )((byte *)to + field->offset);
+
 		MSG_WriteBits(msg, 1, 1);   // changed
 
 		if (field->bits == 0)
@@ -2097,6 +2371,8 @@ player_state_t communication
 
 /// Using the stringizing operator to save typing...
 #define PSF(x) # x, (size_t)&((playerState_t *)0)->x
+/// Word index of a playerState_t member
+#define PSW(x) (int)((size_t)&((playerState_t *)0)->x / 4)
 
 netField_t playerStateFields[] =
 {
@@ -2244,11 +2520,14 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 	int           holdablebits;
 	int           numFields;
 	netField_t    *field;
-	int           *fromF, *toF;
+	int           *toF;
 	float         fullFloat;
 	int           trunc;
 	int           startBit, endBit;
 	int           print;
+	int           slot;
+	uint32_t      diff[MSG_DIFF_WORDS(playerState_t)];
+	uint32_t      changed[MSG_FIELD_WORDS(playerStateFields)];
 
 	if (!from)
 	{
@@ -2256,6 +2535,12 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 		Com_Memset(&dummy, 0, sizeof(dummy));
 	}
 
+	if (msgDeltaBench.recording && (slot = MSG_RecordDelta(&msgDeltaBench.numPlayers, msgDeltaBench.maxPlayers)) >= 0)
+	{
+		msgDeltaBench.players[slot * 2]     = *from;
+		msgDeltaBench.players[slot * 2 + 1] = *to;
+	}
+
 	if (msg->bit == 0)
 	{
 		startBit = msg->cursize * 8 - GENTITYNUM_BITS;
@@ -2279,18 +2564,8 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 
 	numFields = sizeof(playerStateFields) / sizeof(playerStateFields[0]);
 
-	lc = 0;
-	for (i = 0, field = playerStateFields ; i < numFields ; i++, field++)
-	{
-		fromF = ( int * )((byte *)from + field->offset);
-		toF   = ( int * )((byte *)to + field->offset);
-		if (*fromF != *toF)
-		{
-			lc = i + 1;
-
-			field->used++;
-		}
-	}
+	// the word diff also covers the arrays below
+	lc = MSG_ChangeVector(playerStateFields, numFields, playerWordField, (int *)from, (int *)to, sizeof(*from) / 4, diff, changed);
 
 	MSG_WriteByte(msg, lc);     // # of changes
 
@@ -2298,10 +2573,7 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 
 	for (i = 0, field = playerStateFields ; i < lc ; i++, field++)
 	{
-		fromF = ( int * )((byte *)from + field->offset);
-		toF   = ( int * )((byte *)to + field->offset);
-
-		if (*fromF == *toF)
+		if (!(changed[i >> 5] & (1u << (i & 31))))
 		{
 			wastedbits++;
 
@@ -2309,6 +2581,8 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 			continue;
 		}
 
+		toF = ( int * )((byte *)to + field->offset);
+
 		MSG_WriteBits(msg, 1, 1);   // changed
 		//pcount[i]++;
 
@@ -2351,38 +2625,10 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 	//
 	// send the arrays
 	//
-	statsbits = 0;
-	for (i = 0 ; i < MAX_STATS ; i++)
-	{
-		if (to->stats[i] != from->stats[i])
-		{
-			statsbits |= 1 << i;
-		}
-	}
-	persistantbits = 0;
-	for (i = 0 ; i < MAX_PERSISTANT ; i++)
-	{
-		if (to->persistant[i] != from->persistant[i])
-		{
-			persistantbits |= 1 << i;
-		}
-	}
-	holdablebits = 0;
-	for (i = 0 ; i < MAX_HOLDABLE ; i++)
-	{
-		if (to->holdable[i] != from->holdable[i])
-		{
-			holdablebits |= 1 << i;
-		}
-	}
-	powerupbits = 0;
-	for (i = 0 ; i < MAX_POWERUPS ; i++)
-	{
-		if (to->powerups[i] != from->powerups[i])
-		{
-			powerupbits |= 1 << i;
-		}
-	}
+	statsbits      = MSG_ArrayBits(diff, PSW(stats[0]), from->stats, to->stats, MAX_STATS);
+	persistantbits = MSG_ArrayBits(diff, PSW(persistant[0]), from->persistant, to->persistant, MAX_PERSISTANT);
+	holdablebits   = MSG_ArrayBits(diff, PSW(holdable[0]), from->holdable, to->holdable, MAX_HOLDABLE);
+	powerupbits    = MSG_ArrayBits(diff, PSW(powerups[0]), from->powerups, to->powerups, MAX_POWERUPS);
 
 	if (statsbits || persistantbits || holdablebits || powerupbits)
 	{
@@ -2475,14 +2721,7 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 	// ammo stored
 	for (j = 0; j < 4; j++)      // modified for 64 weaps
 	{
-		ammobits[j] = 0;
-		for (i = 0 ; i < 16 ; i++)
-		{
-			if (to->ammo[i + (j * 16)] != from->ammo[i + (j * 16)])
-			{
-				ammobits[j] |= 1 << i;
-			}
-		}
+		ammobits[j] = MSG_ArrayBits(diff, PSW(ammo[j * 16]), from->ammo + j * 16, to->ammo + j * 16, 16);
 	}
 
 	// also encapsulated ammo changes into one check. Clip values will change frequently,
@@ -2518,14 +2757,7 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 	// ammo in clip
 	for (j = 0; j < 4; j++)      // modified for 64 weaps
 	{
-		clipbits = 0;
-		for (i = 0 ; i < 16 ; i++)
-		{
-			if (to->ammoclip[i + (j * 16)] != from->ammoclip[i + (j * 16)])
-			{
-				clipbits |= 1 << i;
-			}
-		}
+		clipbits = MSG_ArrayBits(diff, PSW(ammoclip[j * 16]), from->ammoclip + j * 16, to->ammoclip + j * 16, 16);
 		if (clipbits)
 		{
 			MSG_WriteBits(msg, 1, 1);   // changed
@@ -3071,4 +3303,321 @@ void MSG_initHuffman(void)
 			Huff_addRef(&msgHuff.decompressor, (byte)i);  // Do update
 		}
 	}
+
+	// both trees are identical and final now
+	Huff_BuildTable(&msgHuffTable, &msgHuff.decompressor);
+
+	MSG_InitWordFields(entityStateFields, ARRAY_LEN(entityStateFields), entityWordField, ARRAY_LEN(entityWordField));
+	MSG_InitWordFields(playerStateFields, ARRAY_LEN(playerStateFields), playerWordField, ARRAY_LEN(playerWordField));
+}
+
+/**
+ * @brief Decodes and re-encodes the messages of a client demo with the Huffman tree
+ * and with the lookup tables, compares throughput and checks both give the same result
+ */
+void MSG_HuffBench_f(void)
+{
+	byte    *file, *data;
+	int     *symbols, *tableSymbols;
+	byte    *encoded, *tableEncoded;
+	int     fileLength, pos, length, maxoffset, count, runs, run, i;
+	int     offset, tableOffset, treeBits, numSymbols, numMessages = 0, mismatches = 0;
+	int64_t time, decodeTree = 0, decodeTable = 0, encodeTree = 0, encodeTable = 0;
+	int64_t totalBytes = 0;
+
+	if (Cmd_Argc() < 2)
+	{
+		Com_Printf("usage: huffbench <demofile> [runs]\n");
+		return;
+	}
+
+	if (!msgInit)
+	{
+		MSG_initHuffman();
+	}
+
+	if (!msgHuffTable.valid)
+	{
+		Com_Printf("Huffman lookup tables aren't available.\n");
+		return;
+	}
+
+	fileLength = FS_ReadFile(Cmd_Argv(1), (void **)&file);
+	if (fileLength <= 0)
+	{
+		Com_Printf("Couldn't read %s\n", Cmd_Argv(1));
+		return;
+	}
+
+	runs = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 10;
+	runs = MAX(runs, 1);
+
+	symbols      = Z_Malloc(MAX_MSGLEN * 8 * sizeof(int));
+	tableSymbols = Z_Malloc(MAX_MSGLEN * 8 * sizeof(int));
+	encoded      = Z_Malloc(MAX_MSGLEN * 8);
+	tableEncoded = Z_Malloc(MAX_MSGLEN * 8);
+
+	// sequence, length and message data until a length of -1
+	for (pos = 0; pos + 8 <= fileLength; pos += 8 + length)
+	{
+		length = LittleLong(*(int *)(file + pos + 4));
+		if (length < 0 || length > MAX_MSGLEN || pos + 8 + length > fileLength)
+		{
+			break;
+		}
+
+		data      = file + pos + 8;
+		maxoffset = length << 3;
+		numMessages++;
+		totalBytes += length;
+
+		// the whole message is treated as a stream of symbols, raw bits decode the same with both
+		for (run = 0; run < runs; run++)
+		{
+			time       = Sys_Microseconds();
+			numSymbols = 0;
+			for (offset = 0; offset < maxoffset; )
+			{
+				Huff_offsetReceive(msgHuff.decompressor.tree, &symbols[numSymbols++], data, &offset, maxoffset);
+			}
+			decodeTree += Sys_Microseconds() - time;
+			treeBits    = offset;
+
+			time  = Sys_Microseconds();
+			count = 0;
+			for (tableOffset = 0; tableOffset < maxoffset; )
+			{
+				Huff_tableReceive(&msgHuffTable, &tableSymbols[count++], data, &tableOffset, maxoffset);
+			}
+			decodeTable += Sys_Microseconds() - time;
+
+			if (run)
+			{
+				continue;
+			}
+
+			if (count != numSymbols || tableOffset != treeBits || memcmp(symbols, tableSymbols, count * sizeof(int)))
+			{
+				mismatches++;
+			}
+		}
+
+		// NYT isn't a byte and can't be sent through the byte based encoder
+		for (i = 0, count = 0; i < numSymbols; i++)
+		{
+			if (symbols[i] < HMAX)
+			{
+				symbols[count++] = symbols[i];
+			}
+		}
+
+		for (run = 0; run < runs; run++)
+		{
+			time = Sys_Microseconds();
+			for (i = 0, offset = 0; i < count; i++)
+			{
+				Huff_offsetTransmit(&msgHuff.compressor, symbols[i], encoded, &offset, MAX_MSGLEN * 8 * 8);
+			}
+			encodeTree += Sys_Microseconds() - time;
+
+			// four bytes at a time like MSG_WriteLong
+			time = Sys_Microseconds();
+			for (i = 0, tableOffset = 0; i < count; i += 4)
+			{
+				unsigned int value = 0;
+				int          j;
+
+				for (j = 0; j < 4 && i + j < count; j++)
+				{
+					value |= (unsigned int)symbols[i + j] << (j << 3);
+				}
+				Huff_tableTransmitBytes(&msgHuffTable, value, j, tableEncoded, &tableOffset, MAX_MSGLEN * 8 * 8);
+			}
+			encodeTable += Sys_Microseconds() - time;
+
+			if (!run && (offset != tableOffset || memcmp(encoded, tableEncoded, (offset + 7) >> 3)))
+			{
+				mismatches++;
+			}
+		}
+	}
+
+	Com_Printf("%i messages, %i KB, %i runs\n", numMessages, (int)(totalBytes >> 10), runs);
+	Com_Printf("decode: tree %.1f MB/s, table %.1f MB/s\n",
+	           decodeTree ? (double)totalBytes * runs / decodeTree : 0.0, decodeTable ? (double)totalBytes * runs / decodeTable : 0.0);
+	Com_Printf("encode: tree %.1f MB/s, table %.1f MB/s\n",
+	           encodeTree ? (double)totalBytes * runs / encodeTree : 0.0, encodeTable ? (double)totalBytes * runs / encodeTable : 0.0);
+	Com_Printf("%i mismatches\n", mismatches);
+
+	Z_Free(tableEncoded);
+	Z_Free(encoded);
+	Z_Free(tableSymbols);
+	Z_Free(symbols);
+	FS_FreeFile(file);
+}
+
+/**
+ * @brief Frees the deltas recorded for MSG_DeltaBench_f
+ */
+static void MSG_FreeDeltaBench(void)
+{
+	msgDeltaBench.recording = qfalse;
+	if (msgDeltaBench.entities)
+	{
+		Z_Free(msgDeltaBench.entities);
+	}
+	if (msgDeltaBench.players)
+	{
+		Z_Free(msgDeltaBench.players);
+	}
+	Com_Memset(&msgDeltaBench, 0, sizeof(msgDeltaBench));
+}
+
+/**
+ * @brief Records entity and playerstate deltas written by the running server, or encodes
+ * the recorded deltas with the field by field and the word diff change vectors,
+ * compares timings and checks both give the same message
+ */
+void MSG_DeltaBench_f(void)
+{
+	static byte   fieldData[MAX_MSGLEN], wordData[MAX_MSGLEN];
+	msg_t         fieldMsg, wordMsg, *msg;
+	int           numEntities, numPlayers, count, runs, run, pass, i, mismatches = 0;
+	int           savedWastedBits = wastedbits, savedOldSize = oldsize;
+	int           entityUsed[ARRAY_LEN(entityStateFields)], playerUsed[ARRAY_LEN(playerStateFields)];
+	int64_t       time, entityTime[2], playerTime[2];
+	entityState_t *entity;
+	playerState_t *player;
+
+	if (Cmd_Argc() > 1 && !Q_stricmp(Cmd_Argv(1), "record"))
+	{
+		count = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 2048;
+		count = MAX(count, 16);
+
+		MSG_FreeDeltaBench();
+		msgDeltaBench.maxEntities = count;
+		msgDeltaBench.maxPlayers  = count / 8;
+		msgDeltaBench.entities    = Z_Malloc(msgDeltaBench.maxEntities * 2 * sizeof(entityState_t));
+		msgDeltaBench.players     = Z_Malloc(msgDeltaBench.maxPlayers * 2 * sizeof(playerState_t));
+		msgDeltaBench.recording   = qtrue;
+
+		Com_Printf("Recording the next %i entity and %i playerstate deltas.\n", msgDeltaBench.maxEntities, msgDeltaBench.maxPlayers);
+		return;
+	}
+
+	numEntities = MIN(msgDeltaBench.numEntities, msgDeltaBench.maxEntities);
+	numPlayers  = MIN(msgDeltaBench.numPlayers, msgDeltaBench.maxPlayers);
+	if (!numEntities && !numPlayers)
+	{
+		Com_Printf("usage: deltabench record [count], then deltabench [runs] once snapshots were sent\n");
+		return;
+	}
+
+	if (!msgInit)
+	{
+		MSG_initHuffman();
+	}
+
+	runs = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 100;
+	runs = MAX(runs, 1);
+
+	// don't record our own deltas and keep the field statistics of the server
+	msgDeltaBench.recording = qfalse;
+	for (i = 0; i < (int)ARRAY_LEN(entityStateFields); i++)
+	{
+		entityUsed[i] = entityStateFields[i].used;
+	}
+	for (i = 0; i < (int)ARRAY_LEN(playerStateFields); i++)
+	{
+		playerUsed[i] = playerStateFields[i].used;
+	}
+
+	// every delta must give the same message with both change vectors
+	for (i = 0; i < numEntities + numPlayers; i++)
+	{
+		MSG_Init(&fieldMsg, fieldData, sizeof(fieldData));
+		MSG_Init(&wordMsg, wordData, sizeof(wordData));
+
+		for (pass = 0; pass < 2; pass++)
+		{
+			msg_scalarDeltas = !pass;
+			msg              = pass ? &wordMsg : &fieldMsg;
+			if (i < numEntities)
+			{
+				entity = &msgDeltaBench.entities[i * 2];
+				MSG_WriteDeltaEntity(msg, entity, entity + 1, qtrue);
+			}
+			else
+			{
+				player = &msgDeltaBench.players[(i - numEntities) * 2];
+				MSG_WriteDeltaPlayerstate(msg, player, player + 1);
+			}
+		}
+
+		if (fieldMsg.bit != wordMsg.bit || fieldMsg.cursize != wordMsg.cursize || memcmp(fieldData, wordData, fieldMsg.cursize))
+		{
+			mismatches++;
+		}
+	}
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		msg_scalarDeltas = !pass;
+		msg              = pass ? &wordMsg : &fieldMsg;
+
+		MSG_Init(msg, pass ? wordData : fieldData, sizeof(fieldData));
+		time = Sys_Microseconds();
+		for (run = 0; run < runs; run++)
+		{
+			for (i = 0; i < numEntities; i++)
+			{
+				if (msg->cursize > MAX_MSGLEN / 2)
+				{
+					MSG_Clear(msg);
+				}
+				MSG_WriteDeltaEntity(msg, &msgDeltaBench.entities[i * 2], &msgDeltaBench.entities[i * 2 + 1], qtrue);
+			}
+		}
+		entityTime[pass] = Sys_Microseconds() - time;
+
+		MSG_Clear(msg);
+		time = Sys_Microseconds();
+		for (run = 0; run < runs; run++)
+		{
+			for (i = 0; i < numPlayers; i++)
+			{
+				if (msg->cursize > MAX_MSGLEN / 2)
+				{
+					MSG_Clear(msg);
+				}
+				MSG_WriteDeltaPlayerstate(msg, &msgDeltaBench.players[i * 2], &msgDeltaBench.players[i * 2 + 1]);
+			}
+		}
+		playerTime[pass] = Sys_Microseconds() - time;
+	}
+
+	msg_scalarDeltas = qfalse;
+	wastedbits       = savedWastedBits;
+	oldsize          = savedOldSize;
+	for (i = 0; i < (int)ARRAY_LEN(entityStateFields); i++)
+	{
+		entityStateFields[i].used = entityUsed[i];
+	}
+	for (i = 0; i < (int)ARRAY_LEN(playerStateFields); i++)
+	{
+		playerStateFields[i].used = playerUsed[i];
+	}
+
+#if defined(MSG_SIMD_SSE2)
+	Com_Printf("%i entity and %i playerstate deltas, %i runs, word diff with SSE2\n", numEntities, numPlayers, runs);
+#elif defined(MSG_SIMD_NEON)
+	Com_Printf("%i entity and %i playerstate deltas, %i runs, word diff with NEON\n", numEntities, numPlayers, runs);
+#else
+	Com_Printf("%i entity and %i playerstate deltas, %i runs, word diff without SIMD\n", numEntities, numPlayers, runs);
+#endif
+	Com_Printf("entities: fields %.3f ms, words %.3f ms (%.2fx)\n", entityTime[0] / 1000.0, entityTime[1] / 1000.0,
+	           entityTime[1] ? (double)entityTime[0] / entityTime[1] : 0.0);
+	Com_Printf("playerstates: fields %.3f ms, words %.3f ms (%.2fx)\n", playerTime[0] / 1000.0, playerTime[1] / 1000.0,
+	           playerTime[1] ? (double)playerTime[0] / playerTime[1] : 0.0);
+	Com_Printf("%i mismatches\n", mismatches);
 }
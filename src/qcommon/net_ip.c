@@ -32,6 +32,10 @@
  * @file net_ip.c
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // recvmmsg, sendmmsg
+#endif
+
 #include "q_shared.h"
 #include "qcommon.h"
 
@@ -109,6 +113,13 @@ typedef int SOCKET;
 #   define ioctlsocket          ioctl
 #   define socketError          errno
 
+#   ifdef __linux__
+#       include <sys/epoll.h>
+#       include <sys/timerfd.h>
+#       define NET_MMSG         // batched socket I/O
+#       define NET_EPOLL        // epoll based NET_Sleep
+#   endif
+
 #endif
 
 static qboolean usingSocks = qfalse;
@@ -134,6 +145,60 @@ static cvar_t *net_mcast6iface;
 
 static cvar_t *net_dropsim; // 0.0 to 1.0, simulated packet drops
 
+#ifdef NET_MMSG
+static cvar_t *net_batch;
+
+#define NET_RECV_BATCH      16
+#define NET_SEND_BATCH      64
+#define NET_SEND_PACKETLEN  1400    // bigger packets are sent right away
+
+/**
+ * @struct netRecvBatch_t
+ * @brief Datagrams read from one socket with a single recvmmsg call
+ */
+typedef struct
+{
+	SOCKET sock;
+	int count;
+	int next;                           ///< next datagram to hand out
+	struct mmsghdr msgs[NET_RECV_BATCH];
+	struct iovec iovecs[NET_RECV_BATCH];
+	struct sockaddr_storage from[NET_RECV_BATCH];
+	byte data[NET_RECV_BATCH][MAX_MSGLEN + 1];
+} netRecvBatch_t;
+
+/**
+ * @struct netSendBatch_t
+ * @brief Packets queued between NET_BeginPacketBatch and NET_FlushPacketBatch
+ */
+typedef struct
+{
+	qboolean active;
+	int count;
+	SOCKET sock[NET_SEND_BATCH];
+	struct mmsghdr msgs[NET_SEND_BATCH];
+	struct iovec iovecs[NET_SEND_BATCH];
+	struct sockaddr_storage to[NET_SEND_BATCH];
+	byte data[NET_SEND_BATCH][NET_SEND_PACKETLEN];
+} netSendBatch_t;
+
+static netRecvBatch_t recvBatch;
+static netSendBatch_t sendBatch;
+#endif
+
+#ifdef NET_EPOLL
+static cvar_t *net_epoll;
+
+#define NET_EPOLL_EVENTS    8
+
+static int epoll_fd = -1;
+static int timer_fd = -1;           ///< one shot timer for precise NET_Sleep timeouts
+
+static void NET_EpollShutdown(void);
+#endif
+
+static qboolean packetDropped;      ///< NET_GetPacket threw away a packet, keep reading
+
 static struct sockaddr socksRelayAddr;
 
 static SOCKET ip_socket    = INVALID_SOCKET;
@@ -742,6 +807,94 @@ qboolean NET_IsLocalAddressString(const char *address)
 
 //=============================================================================
 
+#ifdef NET_MMSG
+/**
+ * @brief NET_PendingPackets
+ * @param[in] sock
+ * @return qtrue if datagrams of this socket are waiting in the receive batch
+ */
+static qboolean NET_PendingPackets(SOCKET sock)
+{
+	return (recvBatch.next < recvBatch.count && recvBatch.sock == sock) ? qtrue : qfalse;
+}
+#else
+#define NET_PendingPackets(sock) qfalse
+#endif
+
+/**
+ * @brief Reads one datagram, with net_batch set up to NET_RECV_BATCH datagrams
+ * are fetched with a single recvmmsg call and handed out one by one
+ * @param[in] sock
+ * @param[out] data
+ * @param[in] maxsize
+ * @param[out] from
+ * @param[out] fromlen
+ * @return Length of the datagram or SOCKET_ERROR
+ */
+static int NET_RecvFrom(SOCKET sock, byte *data, int maxsize, struct sockaddr_storage *from, socklen_t *fromlen)
+{
+#ifdef NET_MMSG
+	if (net_batch->integer || recvBatch.next < recvBatch.count)
+	{
+		int i, len;
+
+		if (recvBatch.next < recvBatch.count && recvBatch.sock != sock)
+		{
+			// finish the other socket first
+			errno = EAGAIN;
+			return SOCKET_ERROR;
+		}
+
+		if (recvBatch.next >= recvBatch.count)
+		{
+			for (i = 0; i < NET_RECV_BATCH; i++)
+			{
+				recvBatch.iovecs[i].iov_base             = recvBatch.data[i];
+				recvBatch.iovecs[i].iov_len              = sizeof(recvBatch.data[i]);
+				recvBatch.msgs[i].msg_hdr.msg_name       = &recvBatch.from[i];
+				recvBatch.msgs[i].msg_hdr.msg_namelen    = sizeof(recvBatch.from[i]);
+				recvBatch.msgs[i].msg_hdr.msg_iov        = &recvBatch.iovecs[i];
+				recvBatch.msgs[i].msg_hdr.msg_iovlen     = 1;
+				recvBatch.msgs[i].msg_hdr.msg_control    = NULL;
+				recvBatch.msgs[i].msg_hdr.msg_controllen = 0;
+				recvBatch.msgs[i].msg_hdr.msg_flags      = 0;
+			}
+
+			recvBatch.sock  = sock;
+			recvBatch.next  = 0;
+			recvBatch.count = recvmmsg(sock, recvBatch.msgs, NET_RECV_BATCH, MSG_DONTWAIT, NULL);
+
+			if (recvBatch.count == SOCKET_ERROR)
+			{
+				recvBatch.count = 0;
+
+				if (errno != ENOSYS)
+				{
+					return SOCKET_ERROR;
+				}
+
+				Com_Printf(S_COLOR_YELLOW "WARNING: recvmmsg() is not supported, disabling net_batch\n");
+				Cvar_Set("net_batch", "0");
+			}
+		}
+
+		if (recvBatch.next < recvBatch.count)
+		{
+			i   = recvBatch.next++;
+			len = MIN((int)recvBatch.msgs[i].msg_len, maxsize);
+
+			Com_Memcpy(data, recvBatch.data[i], len);
+			Com_Memcpy(from, &recvBatch.from[i], recvBatch.msgs[i].msg_hdr.msg_namelen);
+			*fromlen = recvBatch.msgs[i].msg_hdr.msg_namelen;
+			return len;
+		}
+	}
+#endif
+
+	*fromlen = sizeof(*from);
+	return recvfrom(sock, (void *)data, maxsize, 0, (struct sockaddr *) from, fromlen);
+}
+
 /**
  * @brief Receive one packet
  * @param[in,out] net_from
@@ -756,10 +909,9 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 	socklen_t               fromlen;
 	int                     err;
 
-	if (ip_socket != INVALID_SOCKET && FD_ISSET(ip_socket, fdr))
+	if (ip_socket != INVALID_SOCKET && (FD_ISSET(ip_socket, fdr) || NET_PendingPackets(ip_socket)))
 	{
-		fromlen = sizeof(from);
-		ret     = recvfrom(ip_socket, (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen);
+		ret = NET_RecvFrom(ip_socket, net_message->data, net_message->maxsize, &from, &fromlen);
 
 		if (ret == SOCKET_ERROR)
 		{
@@ -778,6 +930,7 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 			{
 				if (ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1)
 				{
+					packetDropped = qtrue;
 					return qfalse;
 				}
 				net_from->type         = NA_IP;
@@ -797,6 +950,7 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 			if (ret >= net_message->maxsize)
 			{
 				Com_Printf("Oversize packet from %s\n", NET_AdrToString(net_from));
+				packetDropped = qtrue;
 				return qfalse;
 			}
 
@@ -806,10 +960,9 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 	}
 
 #ifdef FEATURE_IPV6
-	if (ip6_socket != INVALID_SOCKET && FD_ISSET(ip6_socket, fdr))
+	if (ip6_socket != INVALID_SOCKET && (FD_ISSET(ip6_socket, fdr) || NET_PendingPackets(ip6_socket)))
 	{
-		fromlen = sizeof(from);
-		ret     = recvfrom(ip6_socket, (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen);
+		ret = NET_RecvFrom(ip6_socket, net_message->data, net_message->maxsize, &from, &fromlen);
 
 		if (ret == SOCKET_ERROR)
 		{
@@ -828,6 +981,7 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 			if (ret >= net_message->maxsize)
 			{
 				Com_Printf("Oversize packet from %s\n", NET_AdrToString(net_from));
+				packetDropped = qtrue;
 				return qfalse;
 			}
 
@@ -836,10 +990,9 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 		}
 	}
 
-	if (multicast6_socket != INVALID_SOCKET && multicast6_socket != ip6_socket && FD_ISSET(multicast6_socket, fdr))
+	if (multicast6_socket != INVALID_SOCKET && multicast6_socket != ip6_socket && (FD_ISSET(multicast6_socket, fdr) || NET_PendingPackets(multicast6_socket)))
 	{
-		fromlen = sizeof(from);
-		ret     = recvfrom(multicast6_socket, (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen);
+		ret = NET_RecvFrom(multicast6_socket, net_message->data, net_message->maxsize, &from, &fromlen);
 
 		if (ret == SOCKET_ERROR)
 		{
@@ -858,6 +1011,7 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 			if (ret >= net_message->maxsize)
 			{
 				Com_Printf("Oversize packet from %s\n", NET_AdrToString(net_from));
+				packetDropped = qtrue;
 				return qfalse;
 			}
 
@@ -874,6 +1028,122 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 
 static char socksBuf[4096];
 
+#ifdef NET_MMSG
+/**
+ * @brief Sends the packets queued so far and keeps queueing, called before
+ * a packet goes out with sendto so it can't overtake them
+ */
+static void NET_SendQueuedPackets(void)
+{
+	if (sendBatch.count)
+	{
+		NET_FlushPacketBatch();
+		sendBatch.active = qtrue;
+	}
+}
+
+/**
+ * @brief Queues a packet for NET_FlushPacketBatch
+ * @param[in] sock
+ * @param[in] data
+ * @param[in] length
+ * @param[in] addr
+ * @param[in] addrlen
+ * @return qfalse if the packet has to be sent right away, see NET_SendQueuedPackets
+ */
+static qboolean NET_QueuePacket(SOCKET sock, const void *data, int length, const struct sockaddr_storage *addr, socklen_t addrlen)
+{
+	int i;
+
+	if (!sendBatch.active)
+	{
+		return qfalse;
+	}
+
+	if (length > NET_SEND_PACKETLEN || !net_batch->integer)
+	{
+		return qfalse;
+	}
+
+	if (sendBatch.count == NET_SEND_BATCH)
+	{
+		NET_SendQueuedPackets();
+	}
+
+	i = sendBatch.count++;
+
+	Com_Memcpy(sendBatch.data[i], data, length);
+	Com_Memcpy(&sendBatch.to[i], addr, addrlen);
+
+	sendBatch.sock[i]                        = sock;
+	sendBatch.iovecs[i].iov_base             = sendBatch.data[i];
+	sendBatch.iovecs[i].iov_len              = length;
+	sendBatch.msgs[i].msg_hdr.msg_name       = &sendBatch.to[i];
+	sendBatch.msgs[i].msg_hdr.msg_namelen    = addrlen;
+	sendBatch.msgs[i].msg_hdr.msg_iov        = &sendBatch.iovecs[i];
+	sendBatch.msgs[i].msg_hdr.msg_iovlen     = 1;
+	sendBatch.msgs[i].msg_hdr.msg_control    = NULL;
+	sendBatch.msgs[i].msg_hdr.msg_controllen = 0;
+	sendBatch.msgs[i].msg_hdr.msg_flags      = 0;
+
+	return qtrue;
+}
+#endif
+
+/**
+ * @brief Starts queueing outgoing packets, they are sent with as few
+ * system calls as possible by NET_FlushPacketBatch
+ */
+void NET_BeginPacketBatch(void)
+{
+#ifdef NET_MMSG
+	// leftovers of an aborted batch
+	NET_FlushPacketBatch();
+
+	sendBatch.active = net_batch && net_batch->integer;
+#endif
+}
+
+/**
+ * @brief Sends all packets queued since NET_BeginPacketBatch and stops queueing
+ */
+void NET_FlushPacketBatch(void)
+{
+#ifdef NET_MMSG
+	int i = 0, j, ret;
+
+	sendBatch.active = qfalse;
+
+	while (i < sendBatch.count)
+	{
+		// one call per run of packets for the same socket
+		for (j = i + 1; j < sendBatch.count && sendBatch.sock[j] == sendBatch.sock[i]; j++)
+		{
+		}
+
+		ret = sendmmsg(sendBatch.sock[i], &sendBatch.msgs[i], j - i, 0);
+
+		if (ret == SOCKET_ERROR)
+		{
+			// wouldblock is silent
+			if (errno != EAGAIN)
+			{
+				Com_Printf("NET_FlushPacketBatch: %s\n", NET_ErrorString());
+			}
+
+			// skip the failing packet
+			i++;
+		}
+		else
+		{
+			i += MAX(ret, 1);
+		}
+	}
+
+	sendBatch.count = 0;
+#endif
+}
+
 /**
  * @brief Sys_SendPacket
  * @param[in] length
@@ -925,17 +1195,34 @@ void Sys_SendPacket(int length, const void *data, const netadr_t *to)
 		*(int *)&socksBuf[4]   = ((struct sockaddr_in *)&addr)->sin_addr.s_addr;
 		*(short *)&socksBuf[8] = ((struct sockaddr_in *)&addr)->sin_port;
 		Com_Memcpy(&socksBuf[10], data, length);
+#ifdef NET_MMSG
+		NET_SendQueuedPackets();
+#endif
 		ret = sendto(ip_socket, socksBuf, length + 10, 0, &socksRelayAddr, sizeof(socksRelayAddr));
 	}
 	else
 	{
 		if (addr.ss_family == AF_INET)
 		{
+#ifdef NET_MMSG
+			if (to->type == NA_IP && NET_QueuePacket(ip_socket, data, length, &addr, sizeof(struct sockaddr_in)))
+			{
+				return;
+			}
+			NET_SendQueuedPackets();
+#endif
 			ret = sendto(ip_socket, data, length, 0, (struct sockaddr *) &addr, sizeof(struct sockaddr_in));
 		}
 #ifdef FEATURE_IPV6
 		else if (addr.ss_family == AF_INET6)
 		{
+#ifdef NET_MMSG
+			if (to->type == NA_IP6 && NET_QueuePacket(ip6_socket, data, length, &addr, sizeof(struct sockaddr_in6)))
+			{
+				return;
+			}
+			NET_SendQueuedPackets();
+#endif
 			ret = sendto(ip6_socket, data, length, 0, (struct sockaddr *) &addr, sizeof(struct sockaddr_in6));
 		}
 #endif
@@ -1929,6 +2216,14 @@ static qboolean NET_GetCvars(void)
 
 	net_dropsim = Cvar_Get("net_dropsim", "0", CVAR_TEMP | CVAR_CHEAT);
 
+#ifdef NET_MMSG
+	net_batch = Cvar_GetAndDescribe("net_batch", "1", CVAR_ARCHIVE_ND, "Read and write packets in batches to save system calls.");
+#endif
+
+#ifdef NET_EPOLL
+	net_epoll = Cvar_GetAndDescribe("net_epoll", "1", CVAR_ARCHIVE_ND, "Wait for packets with epoll instead of select(). 2 uses edge triggered wakeups.");
+#endif
+
 	return modified ? qtrue : qfalse;
 }
 
@@ -1987,6 +2282,14 @@ static void NET_Config(qboolean enableNetworking)
 
 	if (stop)
 	{
+		NET_FlushPacketBatch();
+#ifdef NET_MMSG
+		recvBatch.count = recvBatch.next = 0;
+#endif
+#ifdef NET_EPOLL
+		NET_EpollShutdown();
+#endif
+
 		if (ip_socket != INVALID_SOCKET)
 		{
 			closesocket(ip_socket);
@@ -2122,6 +2425,11 @@ void NET_Event(fd_set *fdr)
 				CL_PacketEvent(&from, &netmsg);
 			}
 		}
+		else if (packetDropped)
+		{
+			// there may be more behind it, edge triggered wakeups won't tell
+			packetDropped = qfalse;
+		}
 		else
 		{
 			break;
@@ -2129,6 +2437,186 @@ void NET_Event(fd_set *fdr)
 	}
 }
 
+#ifdef NET_EPOLL
+/**
+ * @brief NET_EpollShutdown
+ */
+static void NET_EpollShutdown(void)
+{
+	if (timer_fd != -1)
+	{
+		close(timer_fd);
+		timer_fd = -1;
+	}
+
+	if (epoll_fd != -1)
+	{
+		close(epoll_fd);
+		epoll_fd = -1;
+	}
+}
+
+/**
+ * @brief NET_EpollAdd
+ * @param[in] fd
+ * @param[in] events
+ * @return
+ */
+static qboolean NET_EpollAdd(int fd, uint32_t events)
+{
+	struct epoll_event ev;
+
+	Com_Memset(&ev, 0, sizeof(ev));
+	ev.events  = events;
+	ev.data.fd = fd;
+
+	return (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0) ? qtrue : qfalse;
+}
+
+/**
+ * @brief Sets up the epoll instance for the currently open sockets
+ * @return
+ */
+static qboolean NET_EpollInit(void)
+{
+	uint32_t events = EPOLLIN;
+
+	if (net_epoll->integer > 1)
+	{
+		events |= EPOLLET;
+	}
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	if (epoll_fd == -1 || timer_fd == -1 || !NET_EpollAdd(timer_fd, EPOLLIN))
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: NET_EpollInit: %s, falling back to select()\n", NET_ErrorString());
+		NET_EpollShutdown();
+		return qfalse;
+	}
+
+	if ((ip_socket != INVALID_SOCKET && !NET_EpollAdd(ip_socket, events))
+#ifdef FEATURE_IPV6
+	    || (ip6_socket != INVALID_SOCKET && !NET_EpollAdd(ip6_socket, events))
+	    || (multicast6_socket != INVALID_SOCKET && multicast6_socket != ip6_socket && !NET_EpollAdd(multicast6_socket, events))
+#endif
+	    )
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: NET_EpollInit: %s, falling back to select()\n", NET_ErrorString());
+		NET_EpollShutdown();
+		return qfalse;
+	}
+
+	// only a wakeup hint for the console, regular files and /dev/null can't be added
+	NET_EpollAdd(STDIN_FILENO, EPOLLIN | EPOLLET);
+
+	return qtrue;
+}
+
+/**
+ * @brief NET_Sleep using epoll, the timeout is kept by a timerfd so it isn't rounded to milliseconds
+ * @param[in] usec
+ * @return qfalse if select() has to be used
+ */
+static qboolean NET_EpollSleep(int64_t usec)
+{
+	struct epoll_event events[NET_EPOLL_EVENTS];
+	struct itimerspec  timer;
+	fd_set             fdset;
+	uint64_t           expirations;
+	int                i, fd, retval;
+	qboolean           packets = qfalse;
+
+	if (net_epoll->modified)
+	{
+		NET_EpollShutdown();
+		net_epoll->modified = qfalse;
+	}
+
+	if (!net_epoll->integer)
+	{
+		return qfalse;
+	}
+
+	if (epoll_fd == -1 && !NET_EpollInit())
+	{
+		Cvar_Set("net_epoll", "0");
+		return qfalse;
+	}
+
+	if (usec > 0)
+	{
+		Com_Memset(&timer, 0, sizeof(timer));
+		timer.it_value.tv_sec  = usec / 1000000;
+		timer.it_value.tv_nsec = (usec % 1000000) * 1000;
+		timerfd_settime(timer_fd, 0, &timer, NULL);
+	}
+
+	retval = epoll_wait(epoll_fd, events, NET_EPOLL_EVENTS, usec > 0 ? -1 : 0);
+
+	if (retval == SOCKET_ERROR)
+	{
+		if (errno != EINTR)
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: epoll_wait() syscall failed: %s\n", NET_ErrorString());
+		}
+		return qtrue;
+	}
+
+	FD_ZERO(&fdset);
+
+	for (i = 0; i < retval; i++)
+	{
+		fd = events[i].data.fd;
+
+		if (fd == timer_fd)
+		{
+			if (read(timer_fd, &expirations, sizeof(expirations)) < 0)
+			{
+				continue;
+			}
+		}
+		else if (fd != STDIN_FILENO)
+		{
+			FD_SET(fd, &fdset);
+			packets = qtrue;
+		}
+	}
+
+	// woken up early, don't let the timer fire into the next sleep
+	if (usec > 0 && packets)
+	{
+		Com_Memset(&timer, 0, sizeof(timer));
+		timerfd_settime(timer_fd, 0, &timer, NULL);
+	}
+
+	if (packets)
+	{
+		NET_Event(&fdset);
+	}
+
+	return qtrue;
+}
+#endif
+
+/**
+ * @brief Returns how much earlier than its deadline a caller should wake up from NET_Sleep
+ * @return Microseconds
+ */
+int NET_SleepMargin(void)
+{
+#ifdef NET_EPOLL
+	if (epoll_fd != -1)
+	{
+		return 0;
+	}
+#endif
+
+	// select() timeouts can be late by a good part of a millisecond
+	return 1000;
+}
+
 /**
  * @brief Sleeps usec or until something happens on the network
  * @param[in] usec
@@ -2145,6 +2633,16 @@ void NET_Sleep(int64_t usec)
 		usec = 0;
 	}
 
+	// don't hold back queued packets while sleeping
+	NET_FlushPacketBatch();
+
+#ifdef NET_EPOLL
+	if (NET_EpollSleep(usec))
+	{
+		return;
+	}
+#endif
+
 	FD_ZERO(&fdset);
 
 	if (ip_socket != INVALID_SOCKET)
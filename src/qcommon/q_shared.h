@@ -1022,6 +1022,35 @@ typedef struct
 	char string[MAX_CVAR_VALUE_STRING];
 } vmCvar_t;
 
+#define MAX_CVAR_CHANGES    64  ///< more changes in a frame make the modules update all of their cvars
+
+/**
+ * @brief Checks a module cvar against the handles returned by trap_Cvar_GetModified
+ * @param[in] vmCvar
+ * @param[in] handles
+ * @param[in] numHandles -1 if all cvars have to be updated
+ * @return qtrue if the cvar may have changed
+ */
+static ID_INLINE qboolean Com_CvarModified(const vmCvar_t *vmCvar, const int *handles, int numHandles)
+{
+	int i;
+
+	if (numHandles < 0)
+	{
+		return qtrue;
+	}
+
+	for (i = 0; i < numHandles; i++)
+	{
+		if (handles[i] == vmCvar->handle)
+		{
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
 /*
 ==============================================================
 COLLISION DETECTION
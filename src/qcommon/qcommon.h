@@ -121,6 +121,8 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 void MSG_ReadDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct playerState_s *to);
 
 void MSG_ReportChangeVectors_f(void);
+void MSG_HuffBench_f(void);
+void MSG_DeltaBench_f(void);
 
 void MSG_ETTV_WriteDeltaEntityShared(msg_t *msg, entityShared_t *from, entityShared_t *to, qboolean force);
 void MSG_ETTV_ReadDeltaEntityShared(msg_t *msg, entityShared_t *from, entityShared_t *to);
@@ -234,6 +236,9 @@ const char *NET_AdrToStringNoPort(const netadr_t *a);
 int NET_StringToAdr(const char *s, netadr_t *a, netadrtype_t family);
 qboolean NET_GetLoopPacket(netsrc_t sock, netadr_t *net_from, msg_t *net_message);
 void NET_Sleep(int64_t usec);
+int NET_SleepMargin(void);
+void NET_BeginPacketBatch(void);
+void NET_FlushPacketBatch(void);
 
 /**
  * @def MAX_MSGLEN
@@ -699,6 +704,9 @@ void Cvar_Register(vmCvar_t *vmCvar, const char *varName, const char *defaultVal
 void Cvar_Update(vmCvar_t *vmCvar);
 // updates an interpreted modules' version of a cvar
 
+int Cvar_GetModified(int *sequence, int *handles, int maxHandles);
+// lists the cvars changed since an interpreted modules' last call
+
 void Cvar_Set(const char *varName, const char *value);
 // will create the variable with no flags if it doesn't exist
 
@@ -920,6 +928,7 @@ int FS_FTell(fileHandle_t f);
 // where are we?
 
 void FS_Flush(fileHandle_t f);
+void FS_SetAsync(fileHandle_t f, qboolean async);
 
 void QDECL FS_Printf(fileHandle_t h, const char *fmt, ...);
 // like fprintf
@@ -1077,6 +1086,30 @@ void Com_SetRecommended(void);
 void Com_TrackProfile(const char *profile_path);
 qboolean Com_CheckProfile(void);
 
+// threads.c
+#define MAX_WORKER_THREADS 16
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+typedef void (*threadJob_t)(void *data, int index);
+
+void Com_StartWorkers(int numWorkers);
+void Com_StopWorkers(void);
+int Com_NumWorkers(void);
+void Com_RunJobs(threadJob_t job, void *data, int count);
+qboolean Com_InJob(void);
+int Com_AtomicIncrement(volatile int *value);
+
+qboolean Com_StartLogWriter(void);
+void Com_StopLogWriter(void);
+void Com_FlushLogWriter(void);
+int Com_LogWrite(FILE *file, qboolean sync, const void *data, int length);
+void Com_LogWriterStats_f(void);
+
 extern cvar_t *com_crashed;
 extern cvar_t *com_ignorecrash;
 
@@ -1084,6 +1117,8 @@ extern cvar_t *com_pid;
 extern cvar_t *com_pidfile;
 
 extern cvar_t *com_developer;
+extern cvar_t *com_logAsync;
+extern cvar_t *com_logAsyncWait;
 extern cvar_t *com_dedicated;
 extern cvar_t *com_speeds;
 extern cvar_t *com_timescale;
@@ -1582,6 +1617,38 @@ typedef struct
 	huff_t decompressor;
 } huffman_t;
 
+#define HUFF_TABLE_BITS     8   ///< bits resolved by one decode table lookup
+#define HUFF_MAX_TABLES     64
+#define HUFF_SUBTABLE       -1  ///< decode entry continues in another table
+#define HUFF_SLOW           -2  ///< decode entry must walk the tree
+
+/**
+ * @struct huffDecode_t
+ * @brief
+ */
+typedef struct
+{
+	short symbol;               ///< decoded symbol, HUFF_SUBTABLE or HUFF_SLOW
+	byte length;                ///< bits consumed
+	byte next;                  ///< table to continue with for HUFF_SUBTABLE
+} huffDecode_t;
+
+/**
+ * @struct huffTable_t
+ * @brief Lookup tables for a tree that doesn't change anymore, see Huff_BuildTable
+ */
+typedef struct
+{
+	qboolean valid;
+	huff_t *huff;                                               ///< tree the tables were built from
+
+	uint32_t code[HMAX + 1];                                    ///< prefix code in stream order, first bit in bit 0
+	byte length[HMAX + 1];
+
+	int numTables;
+	huffDecode_t decode[HUFF_MAX_TABLES][1 << HUFF_TABLE_BITS];
+} huffTable_t;
+
 void Huff_Compress(msg_t *mbuf, int offset);
 void Huff_Decompress(msg_t *mbuf, int offset);
 void Huff_Init(huffman_t *huff);
@@ -1592,6 +1659,9 @@ void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxof
 void Huff_offsetTransmit(huff_t *huff, int ch, byte *fout, int *offset, int maxoffset);
 void Huff_putBit(int bit, byte *fout, int *offset);
 int Huff_getBit(byte *fin, int *offset);
+void Huff_BuildTable(huffTable_t *table, huff_t *huff);
+void Huff_tableReceive(const huffTable_t *table, int *ch, byte *fin, int *offset, int maxoffset);
+qboolean Huff_tableTransmitBytes(const huffTable_t *table, unsigned int value, int count, byte *fout, int *offset, int maxoffset);
 
 extern huffman_t clientHuffTables;
 
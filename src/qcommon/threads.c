@@ -0,0 +1,783 @@
+/*
+ * ET: Legacy
+ * Copyright (C) 2012-2024 ET:Legacy team <mail@etlegacy.com>
+ *
+ * This file is part of ET: Legacy - http://www.etlegacy.com
+ *
+ * ET: Legacy is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ET: Legacy is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ET: Legacy. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file threads.c
+ * @brief Minimal worker pool used to spread independent per-frame jobs over several cores,
+ * and the background writer for log files
+ *
+ * Jobs must not call Com_Error, print, touch the VMs or any other non thread safe
+ * engine state. The calling thread takes part in the work and Com_RunJobs only
+ * returns once every job has finished.
+ */
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE             threadHandle_t;
+typedef DWORD              threadId_t;
+typedef CRITICAL_SECTION   threadMutex_t;
+typedef CONDITION_VARIABLE threadCond_t;
+
+#define Thread_MutexInit(m)         InitializeCriticalSection(m)
+#define Thread_MutexDestroy(m)      DeleteCriticalSection(m)
+#define Thread_MutexLock(m)         EnterCriticalSection(m)
+#define Thread_MutexUnlock(m)       LeaveCriticalSection(m)
+#define Thread_CondInit(c)          InitializeConditionVariable(c)
+#define Thread_CondDestroy(c)
+#define Thread_CondWait(c, m)       SleepConditionVariableCS(c, m, INFINITE)
+#define Thread_CondSignal(c)        WakeConditionVariable(c)
+#define Thread_CondBroadcast(c)     WakeAllConditionVariable(c)
+
+#define Thread_AtomicIncrement(v)   InterlockedIncrement((volatile LONG *)(v))
+#define Thread_AtomicLoad(v)        InterlockedCompareExchange((volatile LONG *)(v), 0, 0)
+#define Thread_AtomicStore(v, x)    InterlockedExchange((volatile LONG *)(v), (x))
+#define Thread_Sleep(msec)          Sleep(msec)
+#define Thread_Self()               GetCurrentThreadId()
+#define Thread_Equal(a, b)          ((a) == (b))
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t       threadHandle_t;
+typedef pthread_t       threadId_t;
+typedef pthread_mutex_t threadMutex_t;
+typedef pthread_cond_t  threadCond_t;
+
+#define Thread_MutexInit(m)         pthread_mutex_init(m, NULL)
+#define Thread_MutexDestroy(m)      pthread_mutex_destroy(m)
+#define Thread_MutexLock(m)         pthread_mutex_lock(m)
+#define Thread_MutexUnlock(m)       pthread_mutex_unlock(m)
+#define Thread_CondInit(c)          pthread_cond_init(c, NULL)
+#define Thread_CondDestroy(c)       pthread_cond_destroy(c)
+#define Thread_CondWait(c, m)       pthread_cond_wait(c, m)
+#define Thread_CondSignal(c)        pthread_cond_signal(c)
+#define Thread_CondBroadcast(c)     pthread_cond_broadcast(c)
+
+#define Thread_AtomicIncrement(v)   __sync_add_and_fetch(v, 1)
+#define Thread_AtomicLoad(v)        __atomic_load_n(v, __ATOMIC_SEQ_CST)
+#define Thread_AtomicStore(v, x)    __atomic_store_n(v, x, __ATOMIC_SEQ_CST)
+#define Thread_Sleep(msec)          usleep((msec) * 1000)
+#define Thread_Self()               pthread_self()
+#define Thread_Equal(a, b)          pthread_equal(a, b)
+#endif
+
+/**
+ * @struct workerPool_s
+ * @typedef workerPool_t
+ * @brief
+ */
+typedef struct workerPool_s
+{
+	int numWorkers;
+	threadHandle_t workers[MAX_WORKER_THREADS];
+
+	threadMutex_t lock;
+	threadCond_t wake;                  ///< signalled when a new batch of jobs is available
+	threadCond_t done;                  ///< signalled when the last job of a batch has finished
+
+	threadJob_t job;                    ///< NULL while no batch is running
+	void *data;
+	int count;                          ///< number of jobs in the current batch
+	int next;                           ///< next job index to hand out
+	int pending;                        ///< jobs handed out but not yet finished
+	qboolean quit;
+} workerPool_t;
+
+static workerPool_t workerPool;
+
+static THREAD_LOCAL qboolean inJob;     ///< set while this thread runs a job, see Com_InJob
+
+/**
+ * @brief Takes jobs from the current batch until it is empty
+ * @note Must be called with the pool locked, returns with the pool locked
+ */
+static void Com_WorkerDrainJobs(void)
+{
+	while (workerPool.job && workerPool.next < workerPool.count)
+	{
+		threadJob_t job   = workerPool.job;
+		void        *data = workerPool.data;
+		int         index = workerPool.next++;
+
+		Thread_MutexUnlock(&workerPool.lock);
+		inJob = qtrue;
+		job(data, index);
+		inJob = qfalse;
+		Thread_MutexLock(&workerPool.lock);
+
+		if (--workerPool.pending == 0)
+		{
+			Thread_CondSignal(&workerPool.done);
+		}
+	}
+}
+
+/**
+ * @brief Com_WorkerLoop
+ */
+static void Com_WorkerLoop(void)
+{
+	Thread_MutexLock(&workerPool.lock);
+
+	while (!workerPool.quit)
+	{
+		Com_WorkerDrainJobs();
+
+		if (!workerPool.quit)
+		{
+			Thread_CondWait(&workerPool.wake, &workerPool.lock);
+		}
+	}
+
+	Thread_MutexUnlock(&workerPool.lock);
+}
+
+#ifdef _WIN32
+/**
+ * @brief Com_WorkerThread
+ * @param arg - unused
+ * @return
+ */
+static DWORD WINAPI Com_WorkerThread(LPVOID arg)
+{
+	Com_WorkerLoop();
+	return 0;
+}
+#else
+/**
+ * @brief Com_WorkerThread
+ * @param arg - unused
+ * @return
+ */
+static void *Com_WorkerThread(void *arg)
+{
+	Com_WorkerLoop();
+	return NULL;
+}
+#endif
+
+/**
+ * @brief Stops all worker threads, jobs are run on the calling thread afterwards
+ */
+void Com_StopWorkers(void)
+{
+	int i;
+
+	if (!workerPool.numWorkers)
+	{
+		return;
+	}
+
+	Thread_MutexLock(&workerPool.lock);
+	workerPool.quit = qtrue;
+	Thread_CondBroadcast(&workerPool.wake);
+	Thread_MutexUnlock(&workerPool.lock);
+
+	for (i = 0; i < workerPool.numWorkers; i++)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(workerPool.workers[i], INFINITE);
+		CloseHandle(workerPool.workers[i]);
+#else
+		pthread_join(workerPool.workers[i], NULL);
+#endif
+	}
+
+	Thread_CondDestroy(&workerPool.done);
+	Thread_CondDestroy(&workerPool.wake);
+	Thread_MutexDestroy(&workerPool.lock);
+
+	Com_Memset(&workerPool, 0, sizeof(workerPool));
+}
+
+/**
+ * @brief (Re)starts the worker pool
+ * @param[in] numWorkers Number of additional threads, 0 runs all jobs on the calling thread
+ */
+void Com_StartWorkers(int numWorkers)
+{
+	int i;
+
+	numWorkers = MIN(MAX(numWorkers, 0), MAX_WORKER_THREADS);
+
+	if (numWorkers == workerPool.numWorkers)
+	{
+		return;
+	}
+
+	Com_StopWorkers();
+
+	if (!numWorkers)
+	{
+		return;
+	}
+
+	Thread_MutexInit(&workerPool.lock);
+	Thread_CondInit(&workerPool.wake);
+	Thread_CondInit(&workerPool.done);
+
+	for (i = 0; i < numWorkers; i++)
+	{
+#ifdef _WIN32
+		workerPool.workers[i] = CreateThread(NULL, 0, Com_WorkerThread, NULL, 0, NULL);
+		if (workerPool.workers[i] == NULL)
+#else
+		if (pthread_create(&workerPool.workers[i], NULL, Com_WorkerThread, NULL) != 0)
+#endif
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: could only start %i of %i worker threads\n", i, numWorkers);
+			break;
+		}
+		workerPool.numWorkers++;
+	}
+
+	if (!workerPool.numWorkers)
+	{
+		Thread_CondDestroy(&workerPool.done);
+		Thread_CondDestroy(&workerPool.wake);
+		Thread_MutexDestroy(&workerPool.lock);
+	}
+}
+
+/**
+ * @brief Com_NumWorkers
+ * @return Number of running worker threads
+ */
+int Com_NumWorkers(void)
+{
+	return workerPool.numWorkers;
+}
+
+/**
+ * @brief Runs job(data, 0) .. job(data, count - 1) spread over the worker pool
+ * and the calling thread, returns when all of them are done
+ * @param[in] job
+ * @param[in] data
+ * @param[in] count
+ */
+void Com_RunJobs(threadJob_t job, void *data, int count)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (!workerPool.numWorkers || count == 1)
+	{
+		int i;
+
+		inJob = qtrue;
+		for (i = 0; i < count; i++)
+		{
+			job(data, i);
+		}
+		inJob = qfalse;
+		return;
+	}
+
+	Thread_MutexLock(&workerPool.lock);
+
+	workerPool.job     = job;
+	workerPool.data    = data;
+	workerPool.count   = count;
+	workerPool.next    = 0;
+	workerPool.pending = count;
+	Thread_CondBroadcast(&workerPool.wake);
+
+	// help out instead of idling
+	Com_WorkerDrainJobs();
+
+	while (workerPool.pending > 0)
+	{
+		Thread_CondWait(&workerPool.done, &workerPool.lock);
+	}
+
+	workerPool.job  = NULL;
+	workerPool.data = NULL;
+
+	Thread_MutexUnlock(&workerPool.lock);
+}
+
+/**
+ * @brief Com_InJob
+ * @return qtrue if the calling thread is running a job of Com_RunJobs,
+ * which may happen in parallel to other jobs
+ */
+qboolean Com_InJob(void)
+{
+	return inJob;
+}
+
+/**
+ * @brief Increments an integer shared between threads
+ * @param[in,out] value
+ * @return The incremented value, unique to the caller
+ */
+int Com_AtomicIncrement(volatile int *value)
+{
+	return Thread_AtomicIncrement(value);
+}
+
+/*
+==============================================================================
+LOG WRITER
+
+Appends to log files are queued in a single producer ring buffer and written
+by a background thread, so a slow disk doesn't stall the frame. Only the main
+thread may queue writes. Records of a full buffer wait at most com_logAsyncWait
+milliseconds for the writer and are dropped afterwards.
+==============================================================================
+*/
+
+#define LOGWRITER_BUFFER_SIZE   (1 << 20)   ///< must be a power of two
+#define LOGWRITER_MAX_RECORD    (LOGWRITER_BUFFER_SIZE / 4)
+
+/**
+ * @struct logRecord_s
+ * @typedef logRecord_t
+ * @brief Header of a queued write, followed by the data
+ */
+typedef struct logRecord_s
+{
+	FILE *file;
+	int length;
+	int time;                           ///< Sys_Milliseconds when queued
+	qboolean sync;                      ///< flush the file after writing
+} logRecord_t;
+
+/**
+ * @struct logWriter_s
+ * @typedef logWriter_t
+ * @brief
+ */
+typedef struct logWriter_s
+{
+	byte buffer[LOGWRITER_BUFFER_SIZE];
+	volatile unsigned int head;         ///< end of the queued records, only moved by the producer
+	volatile unsigned int tail;         ///< start of the queued records, only moved by the writer
+	volatile int sleeping;              ///< set while the writer waits for records
+
+	qboolean running;
+	qboolean quit;
+	threadId_t producer;                ///< the thread which started the writer, the only one queueing writes
+	int flushing;                       ///< number of threads waiting in Com_FlushLogWriter
+	threadHandle_t thread;
+	threadMutex_t lock;
+	threadCond_t wake;                  ///< signalled when records were queued
+	threadCond_t drained;               ///< signalled when the buffer ran empty
+
+	// producer statistics
+	int records;
+	int bytes;
+	int dropped;
+	int droppedBytes;
+	int stalls;                         ///< writes which had to wait for free space
+	int stallTime;
+	int maxQueued;
+
+	// writer statistics
+	int written;
+	int maxLatency;
+	double totalLatency;
+} logWriter_t;
+
+static logWriter_t logWriter;
+
+/**
+ * @brief Copies out of the ring buffer, wrapping around its end
+ * @param[out] dest
+ * @param[in] pos
+ * @param[in] length
+ */
+static void Com_LogWriterRead(void *dest, unsigned int pos, int length)
+{
+	int offset = pos & (LOGWRITER_BUFFER_SIZE - 1);
+	int first  = MIN(length, LOGWRITER_BUFFER_SIZE - offset);
+
+	Com_Memcpy(dest, logWriter.buffer + offset, first);
+	Com_Memcpy((byte *)dest + first, logWriter.buffer, length - first);
+}
+
+/**
+ * @brief Copies into the ring buffer, wrapping around its end
+ * @param[in] pos
+ * @param[in] src
+ * @param[in] length
+ */
+static void Com_LogWriterStore(unsigned int pos, const void *src, int length)
+{
+	int offset = pos & (LOGWRITER_BUFFER_SIZE - 1);
+	int first  = MIN(length, LOGWRITER_BUFFER_SIZE - offset);
+
+	Com_Memcpy(logWriter.buffer + offset, src, first);
+	Com_Memcpy(logWriter.buffer, (const byte *)src + first, length - first);
+}
+
+/**
+ * @brief Writes all records queued up to head
+ * @param[in] head
+ * @note Runs on the writer thread, or on the main thread while the writer isn't running
+ */
+static void Com_LogWriterWriteRecords(unsigned int head)
+{
+	logRecord_t  record;
+	unsigned int tail = logWriter.tail;
+	int          offset, first, latency;
+
+	while (tail != head)
+	{
+		Com_LogWriterRead(&record, tail, sizeof(record));
+		tail += sizeof(record);
+
+		offset = tail & (LOGWRITER_BUFFER_SIZE - 1);
+		first  = MIN(record.length, LOGWRITER_BUFFER_SIZE - offset);
+
+		fwrite(logWriter.buffer + offset, 1, first, record.file);
+		if (first < record.length)
+		{
+			fwrite(logWriter.buffer, 1, record.length - first, record.file);
+		}
+		if (record.sync)
+		{
+			fflush(record.file);
+		}
+		tail += record.length;
+
+		latency                  = Sys_Milliseconds() - record.time;
+		logWriter.maxLatency     = MAX(logWriter.maxLatency, latency);
+		logWriter.totalLatency  += latency;
+		logWriter.written++;
+
+		// hand the space back to the producer
+		Thread_AtomicStore(&logWriter.tail, tail);
+	}
+}
+
+/**
+ * @brief Com_LogWriterLoop
+ */
+static void Com_LogWriterLoop(void)
+{
+	unsigned int head;
+
+	Thread_MutexLock(&logWriter.lock);
+
+	while (!logWriter.quit)
+	{
+		head = Thread_AtomicLoad(&logWriter.head);
+
+		if (head != logWriter.tail)
+		{
+			Thread_MutexUnlock(&logWriter.lock);
+			Com_LogWriterWriteRecords(head);
+			Thread_MutexLock(&logWriter.lock);
+			continue;
+		}
+
+		if (logWriter.flushing)
+		{
+			Thread_CondBroadcast(&logWriter.drained);
+		}
+
+		// announce the nap before checking once more, so a record queued
+		// in between either shows up here or wakes us up
+		Thread_AtomicStore(&logWriter.sleeping, 1);
+		if (Thread_AtomicLoad(&logWriter.head) == logWriter.tail && !logWriter.quit)
+		{
+			Thread_CondWait(&logWriter.wake, &logWriter.lock);
+		}
+		Thread_AtomicStore(&logWriter.sleeping, 0);
+	}
+
+	Thread_MutexUnlock(&logWriter.lock);
+}
+
+#ifdef _WIN32
+/**
+ * @brief Com_LogWriterThread
+ * @param arg - unused
+ * @return
+ */
+static DWORD WINAPI Com_LogWriterThread(LPVOID arg)
+{
+	Com_LogWriterLoop();
+	return 0;
+}
+#else
+/**
+ * @brief Com_LogWriterThread
+ * @param arg - unused
+ * @return
+ */
+static void *Com_LogWriterThread(void *arg)
+{
+	Com_LogWriterLoop();
+	return NULL;
+}
+#endif
+
+/**
+ * @brief Wakes the writer thread if it waits for records
+ */
+static void Com_WakeLogWriter(void)
+{
+	if (Thread_AtomicLoad(&logWriter.sleeping))
+	{
+		Thread_MutexLock(&logWriter.lock);
+		Thread_CondSignal(&logWriter.wake);
+		Thread_MutexUnlock(&logWriter.lock);
+	}
+}
+
+/**
+ * @brief Starts the log writer thread unless it is disabled by com_logAsync or running already
+ * @return qtrue if writes to a newly opened log can be queued with Com_LogWrite
+ */
+qboolean Com_StartLogWriter(void)
+{
+	// checked first so logs opened after com_logAsync 0 are written synchronously
+	if (!com_logAsync || !com_logAsync->integer)
+	{
+		return qfalse;
+	}
+
+	if (logWriter.running)
+	{
+		return qtrue;
+	}
+
+	Thread_MutexInit(&logWriter.lock);
+	Thread_CondInit(&logWriter.wake);
+	Thread_CondInit(&logWriter.drained);
+
+	logWriter.quit     = qfalse;
+	logWriter.producer = Thread_Self();
+
+#ifdef _WIN32
+	logWriter.thread = CreateThread(NULL, 0, Com_LogWriterThread, NULL, 0, NULL);
+	if (logWriter.thread == NULL)
+#else
+	if (pthread_create(&logWriter.thread, NULL, Com_LogWriterThread, NULL) != 0)
+#endif
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: could not start the log writer thread, writing logs synchronously\n");
+		Thread_CondDestroy(&logWriter.drained);
+		Thread_CondDestroy(&logWriter.wake);
+		Thread_MutexDestroy(&logWriter.lock);
+		return qfalse;
+	}
+
+	logWriter.running = qtrue;
+	return qtrue;
+}
+
+/**
+ * @brief Writes out everything queued so far, returns when it is on its way to the files
+ */
+void Com_FlushLogWriter(void)
+{
+	if (!logWriter.running)
+	{
+		Com_LogWriterWriteRecords(logWriter.head);
+		return;
+	}
+
+	Thread_MutexLock(&logWriter.lock);
+
+	logWriter.flushing++;
+	Thread_CondSignal(&logWriter.wake);
+
+	while (Thread_AtomicLoad(&logWriter.tail) != logWriter.head)
+	{
+		Thread_CondWait(&logWriter.drained, &logWriter.lock);
+	}
+
+	logWriter.flushing--;
+
+	Thread_MutexUnlock(&logWriter.lock);
+}
+
+/**
+ * @brief Writes out all queued records and stops the log writer thread
+ */
+void Com_StopLogWriter(void)
+{
+	if (!logWriter.running)
+	{
+		return;
+	}
+
+	Com_FlushLogWriter();
+
+	Thread_MutexLock(&logWriter.lock);
+	logWriter.quit = qtrue;
+	Thread_CondSignal(&logWriter.wake);
+	Thread_MutexUnlock(&logWriter.lock);
+
+#ifdef _WIN32
+	WaitForSingleObject(logWriter.thread, INFINITE);
+	CloseHandle(logWriter.thread);
+#else
+	pthread_join(logWriter.thread, NULL);
+#endif
+
+	Thread_CondDestroy(&logWriter.drained);
+	Thread_CondDestroy(&logWriter.wake);
+	Thread_MutexDestroy(&logWriter.lock);
+
+	logWriter.running  = qfalse;
+	logWriter.sleeping = 0;
+}
+
+/**
+ * @brief Queues a write for the log writer thread
+ * @param[in] file
+ * @param[in] sync Flush the file after writing
+ * @param[in] data
+ * @param[in] length
+ * @return length, also when the write was dropped
+ */
+int Com_LogWrite(FILE *file, qboolean sync, const void *data, int length)
+{
+	logRecord_t  record;
+	unsigned int head = logWriter.head;
+	unsigned int queued;
+	int          size = sizeof(record) + length;
+	int          start;
+
+	if (length <= 0)
+	{
+		return 0;
+	}
+
+	if (logWriter.running && !Thread_Equal(Thread_Self(), logWriter.producer))
+	{
+		// prints of other threads (IRC) can't use the single producer queue
+		fwrite(data, 1, length, file);
+		if (sync)
+		{
+			fflush(file);
+		}
+		return length;
+	}
+
+	if (length > LOGWRITER_MAX_RECORD)
+	{
+		// too big to queue, keep the order and write it right here
+		Com_FlushLogWriter();
+		fwrite(data, 1, length, file);
+		if (sync)
+		{
+			fflush(file);
+		}
+		return length;
+	}
+
+	queued = head - Thread_AtomicLoad(&logWriter.tail);
+
+	if (LOGWRITER_BUFFER_SIZE - queued < (unsigned int)size)
+	{
+		int maxWait = com_logAsyncWait ? com_logAsyncWait->integer : 0;
+
+		// the writer can't keep up, give it some time before dropping the record
+		start = Sys_Milliseconds();
+		logWriter.stalls++;
+
+		do
+		{
+			Com_WakeLogWriter();
+			if (Sys_Milliseconds() - start >= maxWait)
+			{
+				break;
+			}
+			Thread_Sleep(1);
+			queued = head - Thread_AtomicLoad(&logWriter.tail);
+		}
+		while (LOGWRITER_BUFFER_SIZE - queued < (unsigned int)size);
+
+		logWriter.stallTime += Sys_Milliseconds() - start;
+
+		if (LOGWRITER_BUFFER_SIZE - queued < (unsigned int)size)
+		{
+			logWriter.dropped++;
+			logWriter.droppedBytes += length;
+			return length;
+		}
+	}
+
+	record.file   = file;
+	record.length = length;
+	record.time   = Sys_Milliseconds();
+	record.sync   = sync;
+
+	Com_LogWriterStore(head, &record, sizeof(record));
+	Com_LogWriterStore(head + sizeof(record), data, length);
+
+	// publish the record
+	Thread_AtomicStore(&logWriter.head, head + size);
+
+	logWriter.records++;
+	logWriter.bytes    += length;
+	logWriter.maxQueued = MAX(logWriter.maxQueued, (int)(queued + size));
+
+	if (logWriter.running)
+	{
+		Com_WakeLogWriter();
+	}
+	else
+	{
+		Com_LogWriterWriteRecords(logWriter.head);
+	}
+
+	return length;
+}
+
+/**
+ * @brief Prints the log writer counters, 'reset' clears them
+ */
+void Com_LogWriterStats_f(void)
+{
+	if (Cmd_Argc() > 1 && !Q_stricmp(Cmd_Argv(1), "reset"))
+	{
+		logWriter.records      = 0;
+		logWriter.bytes        = 0;
+		logWriter.dropped      = 0;
+		logWriter.droppedBytes = 0;
+		logWriter.stalls       = 0;
+		logWriter.stallTime    = 0;
+		logWriter.maxQueued    = 0;
+		logWriter.written      = 0;
+		logWriter.maxLatency   = 0;
+		logWriter.totalLatency = 0;
+		return;
+	}
+
+	Com_Printf("log writer %s, %i of %i KB queued\n", logWriter.running ? "running" : "stopped",
+	           (int)(logWriter.head - logWriter.tail) / 1024, LOGWRITER_BUFFER_SIZE / 1024);
+	Com_Printf("%i writes (%i KB) queued, %i written, %i KB max queued\n",
+	           logWriter.records, logWriter.bytes / 1024, logWriter.written, logWriter.maxQueued / 1024);
+	Com_Printf("latency: %.1f msec avg, %i msec max\n",
+	           logWriter.written ? logWriter.totalLatency / logWriter.written : 0.0, logWriter.maxLatency);
+	Com_Printf("buffer full: %i times, %i msec waited, %i writes (%i bytes) dropped\n",
+	           logWriter.stalls, logWriter.stallTime, logWriter.dropped, logWriter.droppedBytes);
+}
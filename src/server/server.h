@@ -76,7 +76,6 @@ typedef struct svEntity_s
 	int clusternums[MAX_ENT_CLUSTERS];
 	int lastCluster;                    ///< if all the clusters don't fit in clusternums
 	int areanum, areanum2;
-	int snapshotCounter;                ///< used to prevent double adding from portal views
 	int originCluster;                  ///< calced upon linking, for origin only bmodel vis checks
 } svEntity_t;
 
@@ -103,11 +102,11 @@ typedef struct
 	int checksumFeed;                   ///< the feed key that we use to compute the pure checksum strings
 	/// the serverId associated with the current checksumFeed (always <= serverId)
 	int checksumFeedServerId;
-	int snapshotCounter;                ///< incremented for each snapshot built
 	int timeResidual;                   ///< <= 1000 / sv_frame->value
 	int nextFrameTime;                  ///< when time > nextFrameTime, process world
 	char *configstrings[MAX_CONFIGSTRINGS];
 	qboolean configstringsmodified[MAX_CONFIGSTRINGS];
+	char *configstringsSent[MAX_CONFIGSTRINGS];     ///< value the clients hold while a change is pending, NULL if unknown
 	svEntity_t svEntities[MAX_GENTITIES];
 
 	char *entityParsePoint;             ///< used during game VM init
@@ -492,6 +491,8 @@ extern cvar_t *sv_wh_active;
 extern cvar_t *sv_wh_bbox_horz;
 extern cvar_t *sv_wh_bbox_vert;
 extern cvar_t *sv_wh_check_fov;
+extern cvar_t *sv_wh_cache_dist;
+extern cvar_t *sv_wh_budget;
 #endif
 
 // server side demo recording
@@ -515,6 +516,8 @@ extern cvar_t *sv_etltv_shownet;
 extern cvar_t *sv_etltv_queue_ms;
 extern cvar_t *sv_etltv_netblast;
 
+extern cvar_t *sv_workerThreads;
+
 //===========================================================
 
 // sv_demo.c
@@ -580,6 +583,8 @@ extern leakyBucket_t outboundLeakyBucket;
 void SV_SetConfigstringNoUpdate(int index, const char *val);
 void SV_SetConfigstring(int index, const char *val);
 void SV_UpdateConfigStrings(void);
+void SV_ForgetSentConfigstrings(void);
+void SV_ConfigstringStats_f(void);
 void SV_GetConfigstring(int index, char *buffer, unsigned int bufferSize);
 void SV_SetUserinfo(int index, const char *val);
 void SV_GetUserinfo(int index, char *buffer, unsigned int bufferSize);
@@ -660,6 +665,9 @@ void SV_InitWallhack(void);
 void SV_RestorePos(int cli);
 int SV_CanSee(int player, int other);
 int SV_PositionChanged(int cli);
+void SV_WallhackFrame(void);
+int SV_WallhackCanSee(int player, int other);
+void SV_WallhackStats_f(void);
 #endif
 
 //============================================================
@@ -683,6 +691,7 @@ void SV_LinkEntity(sharedEntity_t *gEnt);
 clipHandle_t SV_ClipHandleForEntity(const sharedEntity_t *ent);
 
 void SV_SectorList_f(void);
+void SV_SectorBench_f(void);
 
 int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount);
 // fills in a table of entity numbers with entities that have bounding boxes
@@ -745,6 +745,8 @@ void SV_AddOperatorCommands(void)
 	Cmd_AddCommand("map_restart", SV_MapRestart_f, "Restarts given map.");
 	Cmd_AddCommand("fieldinfo", SV_FieldInfo_f, "Prints field info.");
 	Cmd_AddCommand("sectorlist", SV_SectorList_f, "Prints sector list.");
+	Cmd_AddCommand("sectorbench", SV_SectorBench_f, "Compares the entity query cost of the uniform and the adaptive sector tree.");
+	Cmd_AddCommand("csstats", SV_ConfigstringStats_f, "Prints how often configstrings change and what their updates cost.");
 	Cmd_AddCommand("gameCompleteStatus", SV_GameCompleteStatus_f, "Sends a game complete status message to all master servers.");
 	Cmd_AddCommand("map", SV_Map_f, "Loads a specific map.", SV_CompleteMapName);
 	Cmd_AddCommand("devmap", SV_Map_f, "Loads a specific map in developer mode.", SV_CompleteMapName);
@@ -753,6 +755,10 @@ void SV_AddOperatorCommands(void)
 
 	Cmd_AddCommand("tv", SV_CL_Commands_f, "tv commands.");
 
+#ifdef FEATURE_ANTICHEAT
+	Cmd_AddCommand("whstats", SV_WallhackStats_f, "Prints the per frame cost of the anti-wallhack visibility checks.");
+#endif
+
 #ifdef ETLEGACY_DEBUG
 	Cmd_AddCommand("net_overhead_print", SV_PrintNetworkOverhead_f, "Prints network overhead stats.");
 	Cmd_AddCommand("net_overhead_clear", SV_ClearNetworkOverhead_f, "Clears network overhead stats.");
@@ -887,6 +887,9 @@ void SV_SendClientGameState(client_t *client)
 	MSG_WriteByte(&msg, svc_gamestate);
 	MSG_WriteLong(&msg, client->reliableSequence);
 
+	// this client gets the pending values right away, so changing them back is no longer a no-op
+	SV_ForgetSentConfigstrings();
+
 	// write the configstrings
 	for (start = 0 ; start < MAX_CONFIGSTRINGS ; start++)
 	{
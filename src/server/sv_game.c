@@ -50,6 +50,7 @@ static ext_trap_keys_t g_extensionTraps[] =
 	{ "trap_DemoSupport_Legacy",           G_DEMOSUPPORT,            qfalse },
 	{ "trap_SnapshotCallbackExt_Legacy",   G_SNAPSHOT_CALLBACK_EXT,  qfalse },
 	{ "trap_SnapshotSetClientMask_Legacy", G_SNAPSHOT_SETCLIENTMASK, qfalse },
+	{ "trap_Cvar_GetModified_Legacy",      G_CVAR_GETMODIFIED,       qfalse },
 	{ NULL,                                -1,                       qfalse }
 };
 
@@ -716,6 +717,9 @@ intptr_t SV_GameSystemCalls(intptr_t *args)
 		SV_SnapshotSetClientMask(args[1], VMU64(2));
 		return 0;
 
+	case G_CVAR_GETMODIFIED:
+		return Cvar_GetModified(VMA(1), VMA(2), args[3]);
+
 	default:
 		Com_Error(ERR_DROP, "Bad game system trap: %ld", (long int) args[0]);
 		break;
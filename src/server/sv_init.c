@@ -70,10 +70,32 @@ void SV_SetConfigstringNoUpdate(int index, const char *val)
 	sv.configstrings[index] = CopyString(val);
 }
 
+/**
+ * @struct configstringStats_s
+ * @typedef configstringStats_t
+ * @brief Per index configstring churn, see SV_ConfigstringStats_f
+ */
+typedef struct configstringStats_s
+{
+	int sets;                   ///< calls of SV_SetConfigstring
+	int unchanged;              ///< sets to the current value
+	int coalesced;              ///< changes overwritten again before they were sent
+	int reverted;               ///< changes set back to the value the clients hold before they were sent
+	int broadcasts;             ///< changes sent to the clients
+	int commands;               ///< reliable commands queued for those changes
+	int bytes;                  ///< size of those commands
+} configstringStats_t;
+
+static configstringStats_t csStats[MAX_CONFIGSTRINGS];
+
 /**
  * @brief SV_SetConfigstring
  * @param[in] index
  * @param[in] val
+ *
+ * @note Changes are only queued here and sent once per frame by SV_UpdateConfigStrings,
+ * so a string which is changed several times in a frame costs a single update and
+ * one which is changed back to the value the clients hold costs none at all.
  */
 void SV_SetConfigstring(int index, const char *val)
 {
@@ -87,16 +109,45 @@ void SV_SetConfigstring(int index, const char *val)
 		val = "";
 	}
 
+	csStats[index].sets++;
+
 	// don't bother broadcasting an update if no change
 	if (!strcmp(val, sv.configstrings[index]))
 	{
+		csStats[index].unchanged++;
 		return;
 	}
 
-	// change the string in sv
-	Z_Free(sv.configstrings[index]);
-	sv.configstrings[index]         = CopyString(val);
-	sv.configstringsmodified[index] = qtrue;
+	if (sv.configstringsSent[index] && !strcmp(val, sv.configstringsSent[index]))
+	{
+		// changed back before anything was sent, the clients are up to date again
+		Z_Free(sv.configstrings[index]);
+		sv.configstrings[index]         = sv.configstringsSent[index];
+		sv.configstringsSent[index]     = NULL;
+		sv.configstringsmodified[index] = qfalse;
+		csStats[index].reverted++;
+	}
+	else
+	{
+		if (sv.configstringsmodified[index])
+		{
+			Z_Free(sv.configstrings[index]);
+			csStats[index].coalesced++;
+		}
+		else if (sv.state == SS_GAME || sv.restarting)
+		{
+			// keep what the clients have until the change is sent
+			sv.configstringsSent[index] = sv.configstrings[index];
+		}
+		else
+		{
+			Z_Free(sv.configstrings[index]);
+		}
+
+		// change the string in sv
+		sv.configstrings[index]         = CopyString(val);
+		sv.configstringsmodified[index] = qtrue;
+	}
 
 	if (svcls.isTVGame && svcls.state != CA_LOADING &&
 	    (index == CS_SERVERINFO || index == CS_WOLFINFO))
@@ -111,6 +162,55 @@ void SV_SetConfigstring(int index, const char *val)
 	}
 }
 
+/**
+ * @brief Drops the values kept to detect reverted configstring changes
+ *
+ * @details Called whenever a gamestate goes out, the receiving client already holds
+ * the pending values so a change back has to be sent to it after all.
+ */
+void SV_ForgetSentConfigstrings(void)
+{
+	int index;
+
+	for (index = 0; index < MAX_CONFIGSTRINGS; index++)
+	{
+		if (sv.configstringsSent[index])
+		{
+			Z_Free(sv.configstringsSent[index]);
+			sv.configstringsSent[index] = NULL;
+		}
+	}
+}
+
+/**
+ * @brief Queues a configstring command for all clients which get configstring updates
+ * @param[in] index
+ * @param[in] cmd
+ */
+static void SV_BroadcastConfigstringCommand(int index, const char *cmd)
+{
+	client_t *client;
+	int      i, len = strlen(cmd);
+
+	for (i = 0, client = svs.clients; i < sv_maxclients->integer ; i++, client++)
+	{
+		if (client->state < CS_PRIMED || client->demoClient)
+		{
+			continue;
+		}
+		// do not always send server info to all clients
+		if (index == CS_SERVERINFO && client->gentity && (client->gentity->r.svFlags & SVF_NOSERVERINFO))
+		{
+			continue;
+		}
+
+		SV_AddServerCommand(client, cmd);
+
+		csStats[index].commands++;
+		csStats[index].bytes += len;
+	}
+}
+
 #define NEXT_WARNING_TIME 5000
 
 /**
@@ -119,8 +219,7 @@ void SV_SetConfigstring(int index, const char *val)
  */
 void SV_UpdateConfigStrings(void)
 {
-	client_t   *client;
-	int        len, i, index, sent, remaining, cstotal = 0;
+	int        len, index, sent, remaining, cstotal = 0;
 	int        maxChunkSize = MAX_STRING_CHARS - 24;
 	const char *cmd;
 	char       buf[MAX_STRING_CHARS];
@@ -157,57 +256,52 @@ void SV_UpdateConfigStrings(void)
 		}
 		sv.configstringsmodified[index] = qfalse;
 
+		if (sv.configstringsSent[index])
+		{
+			Z_Free(sv.configstringsSent[index]);
+			sv.configstringsSent[index] = NULL;
+		}
+
 		// send it to all the clients if we aren't
 		// spawning a new server
 		if (sv.state == SS_GAME || sv.restarting)
 		{
-			// send the data to all relevent clients
-			for (i = 0, client = svs.clients; i < sv_maxclients->integer ; i++, client++)
+			csStats[index].broadcasts++;
+
+			// the commands are the same for every client, build them once
+			len = strlen(sv.configstrings[index]);
+			if (len >= maxChunkSize)
 			{
-				if (client->state < CS_PRIMED)
-				{
-					continue;
-				}
-				// do not always send server info to all clients
-				if (index == CS_SERVERINFO && client->gentity && (client->gentity->r.svFlags & SVF_NOSERVERINFO))
-				{
-					continue;
-				}
+				sent      = 0;
+				remaining = len;
 
-				len = strlen(sv.configstrings[index]);
-				if (len >= maxChunkSize)
+				while (remaining > 0)
 				{
-					sent      = 0;
-					remaining = len;
-
-					while (remaining > 0)
+					if (sent == 0)
 					{
-						if (sent == 0)
-						{
-							cmd = "bcs0";
-						}
-						else if (remaining < maxChunkSize)
-						{
-							cmd = "bcs2";
-						}
-						else
-						{
-							cmd = "bcs1";
-						}
-
-						Q_strncpyz(buf, &sv.configstrings[index][sent], maxChunkSize);
-
-						SV_SendServerCommand(client, "%s %i \"%s\"\n", cmd, index, buf);
-
-						sent      += (maxChunkSize - 1);
-						remaining -= (maxChunkSize - 1);
+						cmd = "bcs0";
 					}
+					else if (remaining < maxChunkSize)
+					{
+						cmd = "bcs2";
+					}
+					else
+					{
+						cmd = "bcs1";
+					}
+
+					Q_strncpyz(buf, &sv.configstrings[index][sent], maxChunkSize);
+
+					SV_BroadcastConfigstringCommand(index, va("%s %i \"%s\"\n", cmd, index, buf));
+
+					sent      += (maxChunkSize - 1);
+					remaining -= (maxChunkSize - 1);
 				}
-				else
-				{
-					// standard cs, just send it
-					SV_SendServerCommand(client, "cs %i \"%s\"\n", index, sv.configstrings[index]);
-				}
+			}
+			else
+			{
+				// standard cs, just send it
+				SV_BroadcastConfigstringCommand(index, va("cs %i \"%s\"\n", index, sv.configstrings[index]));
 			}
 		}
 
@@ -224,6 +318,77 @@ void SV_UpdateConfigStrings(void)
 	}
 }
 
+/**
+ * @brief Sorts configstring indexes by the number of sets, most first
+ * @param[in] a
+ * @param[in] b
+ * @return
+ */
+static int QDECL SV_SortConfigstringStats(const void *a, const void *b)
+{
+	return csStats[*(const int *)b].sets - csStats[*(const int *)a].sets;
+}
+
+/**
+ * @brief Prints the configstrings changed most often and what their updates cost,
+ * 'reset' clears the counters
+ */
+void SV_ConfigstringStats_f(void)
+{
+	int                 order[MAX_CONFIGSTRINGS];
+	int                 i, count = 0;
+	configstringStats_t total;
+
+	if (Cmd_Argc() > 1 && !Q_stricmp(Cmd_Argv(1), "reset"))
+	{
+		Com_Memset(csStats, 0, sizeof(csStats));
+		return;
+	}
+
+	Com_Memset(&total, 0, sizeof(total));
+
+	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		if (!csStats[i].sets)
+		{
+			continue;
+		}
+
+		order[count++] = i;
+
+		total.sets       += csStats[i].sets;
+		total.unchanged  += csStats[i].unchanged;
+		total.coalesced  += csStats[i].coalesced;
+		total.reverted   += csStats[i].reverted;
+		total.broadcasts += csStats[i].broadcasts;
+		total.commands   += csStats[i].commands;
+		total.bytes      += csStats[i].bytes;
+	}
+
+	if (!count)
+	{
+		Com_Printf("No configstrings set.\n");
+		return;
+	}
+
+	qsort(order, count, sizeof(order[0]), SV_SortConfigstringStats);
+
+	Com_Printf("index   sets unchanged coalesced reverted    sent commands    bytes value\n");
+	Com_Printf("----- ------ --------- --------- -------- ------- -------- -------- -----\n");
+
+	for (i = 0; i < count && i < 32; i++)
+	{
+		configstringStats_t *stats = &csStats[order[i]];
+
+		Com_Printf("%5i %6i %9i %9i %8i %7i %8i %8i %.24s\n", order[i], stats->sets, stats->unchanged, stats->coalesced,
+		           stats->reverted, stats->broadcasts, stats->commands, stats->bytes,
+		           sv.configstrings[order[i]] ? sv.configstrings[order[i]] : "");
+	}
+
+	Com_Printf("total %6i %9i %9i %8i %7i %8i %8i (%i indexes)\n", total.sets, total.unchanged, total.coalesced,
+	           total.reverted, total.broadcasts, total.commands, total.bytes, count);
+}
+
 /**
  * @brief SV_GetConfigstring
  * @param[in] index
@@ -651,6 +816,10 @@ static void SV_ClearServer(void)
 		{
 			Z_Free(sv.configstrings[i]);
 		}
+		if (sv.configstringsSent[i])
+		{
+			Z_Free(sv.configstringsSent[i]);
+		}
 	}
 
 	if (!sv_serverTimeReset->integer)
@@ -1139,6 +1308,9 @@ void SV_Init(void)
 
 	sv_wh_check_fov = Cvar_Get("wh_check_fov", "0", CVAR_ARCHIVE);
 
+	sv_wh_cache_dist = Cvar_GetAndDescribe("sv_wh_cache_dist", "0", CVAR_ARCHIVE, "Distance players may move before their anti-wallhack visibility is traced again, 0 traces every frame.");
+	sv_wh_budget     = Cvar_GetAndDescribe("sv_wh_budget", "0", CVAR_ARCHIVE, "Microseconds per frame the anti-wallhack traces may take, 0 for no limit. Pairs left over are shown, unless they were hidden a moment ago and nobody moved.");
+
 	SV_InitWallhack();
 #endif
 
@@ -1241,6 +1413,8 @@ void SV_Init(void)
 	sv_etltv_queue_ms   = Cvar_Get("ettv_queue_ms", "-1", CVAR_ROM);    // ettv_queue_ms for ettv backward compatibility
 	sv_etltv_netblast   = Cvar_GetAndDescribe("sv_etltv_netblast", "1", CVAR_ARCHIVE_ND, "Send all message fragments at once.");
 
+	sv_workerThreads = Cvar_GetAndDescribe("sv_workerThreads", "0", CVAR_ARCHIVE_ND, "Number of worker threads used to build client snapshots on dedicated servers, 0 builds them on the main thread.");
+
 #if defined(FEATURE_IRC_SERVER) && defined(DEDICATED)
 	IRC_Init();
 #endif
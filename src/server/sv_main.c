@@ -117,6 +117,8 @@ cvar_t *sv_wh_active;
 cvar_t *sv_wh_bbox_horz;
 cvar_t *sv_wh_bbox_vert;
 cvar_t *sv_wh_check_fov;
+cvar_t *sv_wh_cache_dist;
+cvar_t *sv_wh_budget;
 #endif
 
 cvar_t *sv_demopath;
@@ -139,6 +141,8 @@ cvar_t *sv_etltv_shownet;
 cvar_t *sv_etltv_queue_ms;
 cvar_t *sv_etltv_netblast;
 
+cvar_t *sv_workerThreads;
+
 static void SVC_Status(const netadr_t *from, qboolean force);
 
 /*
@@ -1673,6 +1677,9 @@ static void SV_Frame_Ext(int frameMsec)
 		svs.time        += frameMsec;
 		sv.time         += frameMsec;
 
+		// world trace results are only reused within one game frame
+		CM_InvalidateTraceCache();
+
 		// let everything in the world think and move
 		VM_Call(gvm, GAME_RUN_FRAME, sv.time);
 
@@ -1782,6 +1789,13 @@ void SV_Frame(int msec)
 	}
 	frameMsec = 1000 / sv_fps->integer;
 
+	// (re)size the worker pool used for building snapshots
+	if (sv_workerThreads->modified)
+	{
+		Com_StartWorkers(sv_workerThreads->integer);
+		sv_workerThreads->modified = qfalse;
+	}
+
 	sv.timeResidual += msec;
 
 	// if time is about to hit the 32nd bit, kick all clients
@@ -130,11 +130,14 @@ static void SV_TrackCommandOverhead(const int offset, const msg_t *msg, const ch
 
 /**
  * @brief Writes a delta update of an entityState_t list to the message.
+ * @param[in] client
  * @param[in] from
  * @param[in] to
+ * @param[in] toEntityNums if set, the new entity states are read from the game entities
+ * with these numbers instead of the snapshot entity ring (parallel snapshot building)
  * @param[in] msg
  */
-static void SV_EmitPacketEntities(client_t *client, clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg)
+static void SV_EmitPacketEntities(client_t *client, clientSnapshot_t *from, clientSnapshot_t *to, const int *toEntityNums, msg_t *msg)
 {
 	entityState_t  *oldent = NULL, *newent = NULL;
 	entityShared_t *oldSharedent = NULL, *newSharedent = NULL;
@@ -159,6 +162,14 @@ static void SV_EmitPacketEntities(client_t *client, clientSnapshot_t *from, clie
 		{
 			newnum = 9999;
 		}
+		else if (toEntityNums)
+		{
+			sharedEntity_t *gEnt = SV_GentityNum(toEntityNums[newindex]);
+
+			newent       = &gEnt->s;
+			newSharedent = &gEnt->r;
+			newnum       = newent->number;
+		}
 		else
 		{
 			newent       = &svs.snapshotEntities[(to->first_entity + newindex) % svs.numSnapshotEntities];
@@ -324,18 +335,15 @@ static void SV_ETTV_EmitPlayerstates(client_t *client, msg_t *msg)
 #endif // DEDICATED
 
 /**
- * @brief SV_WriteSnapshotToClient
- * @param[in] client
- * @param[in] msg
+ * @brief Picks the previous frame the current snapshot is delta compressed against
+ * @param[in,out] client
+ * @param[in] nextSnapshotEntities svs.nextSnapshotEntities as it is right after this client's snapshot was built
+ * @param[out] lastframe
+ * @return The frame to delta from or NULL for an uncompressed snapshot
  */
-static void SV_WriteSnapshotToClient(client_t *client, msg_t *msg)
+static clientSnapshot_t *SV_SelectDeltaFrame(client_t *client, int nextSnapshotEntities, int *lastframe)
 {
-	clientSnapshot_t *frame, *oldframe;
-	int              lastframe;
-	int              snapFlags;
-
-	// this is the snapshot we are creating
-	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+	clientSnapshot_t *oldframe;
 
 	// if we are about to go over MAX_PARSE_ENTITIES send uncompressed snapshot
 	if (client->parseEntitiesNum > MAX_PARSE_ENTITIES - 128)
@@ -349,31 +357,50 @@ static void SV_WriteSnapshotToClient(client_t *client, msg_t *msg)
 	if (client->deltaMessage <= 0 || client->state != CS_ACTIVE)
 	{
 		// client is asking for a retransmit
-		oldframe  = NULL;
-		lastframe = 0;
+		oldframe   = NULL;
+		*lastframe = 0;
 	}
 	else if (client->netchan.outgoingSequence - client->deltaMessage >= (PACKET_BACKUP - 3))
 	{
 		// client hasn't gotten a good message through in a long time
 		Com_DPrintf("%s: Delta request from out of date packet.\n", client->name);
-		oldframe  = NULL;
-		lastframe = 0;
+		oldframe   = NULL;
+		*lastframe = 0;
 	}
 	else
 	{
 		// we have a valid snapshot to delta from
-		oldframe  = &client->frames[client->deltaMessage & PACKET_MASK];
-		lastframe = client->netchan.outgoingSequence - client->deltaMessage;
+		oldframe   = &client->frames[client->deltaMessage & PACKET_MASK];
+		*lastframe = client->netchan.outgoingSequence - client->deltaMessage;
 
 		// the snapshot's entities may still have rolled off the buffer, though
-		if (oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities)
+		if (oldframe->first_entity <= nextSnapshotEntities - svs.numSnapshotEntities)
 		{
 			Com_DPrintf("%s: Delta request from out of date entities.\n", client->name);
-			oldframe  = NULL;
-			lastframe = 0;
+			oldframe   = NULL;
+			*lastframe = 0;
 		}
 	}
 
+	return oldframe;
+}
+
+/**
+ * @brief SV_WriteSnapshotToClient
+ * @param[in] client
+ * @param[in] msg
+ * @param[in] oldframe see SV_SelectDeltaFrame
+ * @param[in] lastframe
+ * @param[in] entityNums see SV_EmitPacketEntities
+ */
+static void SV_WriteSnapshotToClient(client_t *client, msg_t *msg, clientSnapshot_t *oldframe, int lastframe, const int *entityNums)
+{
+	clientSnapshot_t *frame;
+	int              snapFlags;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
 	MSG_WriteByte(msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -421,7 +448,7 @@ static void SV_WriteSnapshotToClient(client_t *client, msg_t *msg)
 	//}
 
 	// delta encode the entities
-	SV_EmitPacketEntities(client, oldframe, frame, msg);
+	SV_EmitPacketEntities(client, oldframe, frame, entityNums, msg);
 
 #ifdef DEDICATED
 	if (client->ettvClient && client->state > CS_ZOMBIE)
@@ -483,8 +510,15 @@ typedef struct
 {
 	int numSnapshotEntities;
 	int snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	byte added[MAX_GENTITIES / 8];          ///< used to prevent double adding from portal views
+	qboolean deferCallbacks;                ///< leave the game snapshot callbacks to SV_RunDeferredSnapshotCallbacks
+	byte deferred[MAX_GENTITIES / 8];       ///< entities still waiting for their snapshot callback
+	int visCacheHits;                       ///< see SV_VisCacheLookup
+	int visCacheMisses;
 } snapshotEntityNumbers_t;
 
+#define SV_SnapshotEntityAdded(eNums, num) ((eNums)->added[(num) >> 3] & (1 << ((num) & 7)))
+
 /**
  * @brief SV_QsortEntityNumbers
  * @param[in] a
@@ -511,21 +545,41 @@ static int QDECL SV_QsortEntityNumbers(const void *a, const void *b)
 	return 1;
 }
 
+/**
+ * @brief Asks the game module whether an entity flagged with r.snapshotCallback should be sent
+ * @param[in] cl
+ * @param[in] clientEnt
+ * @param[in] gEnt
+ * @return
+ */
+static qboolean SV_SnapshotCallback(client_t *cl, sharedEntity_t *clientEnt, sharedEntity_t *gEnt)
+{
+	if (sv.snapshotCallbackExt)
+	{
+		return (qboolean)(VM_Call(gvm, GAME_SNAPSHOT_CALLBACK_EXT, gEnt->s.number, clientEnt->s.number, cl - svs.clients));
+	}
+
+	return (qboolean)(VM_Call(gvm, GAME_SNAPSHOT_CALLBACK, gEnt->s.number, clientEnt->s.number));
+}
+
 /**
  * @brief SV_AddEntToSnapshot
+ * @param[in] cl
  * @param[in] clientEnt
- * @param[in,out] svEnt
+ * @param[in] svEnt - unused
  * @param[in] gEnt
  * @param[in,out] eNums
  */
 static void SV_AddEntToSnapshot(client_t *cl, sharedEntity_t *clientEnt, svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums)
 {
+	int num = gEnt->s.number;
+
 	// if we have already added this entity to this snapshot, don't add again
-	if (svEnt->snapshotCounter == sv.snapshotCounter)
+	if (SV_SnapshotEntityAdded(eNums, num))
 	{
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->added[num >> 3] |= 1 << (num & 7);
 
 	// if we are full, silently discard entities
 	if (eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES)
@@ -536,23 +590,267 @@ static void SV_AddEntToSnapshot(client_t *cl, sharedEntity_t *clientEnt, svEntit
 
 	if (gEnt->r.snapshotCallback)
 	{
-		if (sv.snapshotCallbackExt)
+		// the game module can't be called from a worker thread
+		if (eNums->deferCallbacks)
 		{
-			if (!(qboolean)(VM_Call(gvm, GAME_SNAPSHOT_CALLBACK_EXT, gEnt->s.number, clientEnt->s.number, cl - svs.clients)))
-			{
-				return;
-			}
+			eNums->deferred[num >> 3] |= 1 << (num & 7);
 		}
-		else if (!(qboolean)(VM_Call(gvm, GAME_SNAPSHOT_CALLBACK, gEnt->s.number, clientEnt->s.number)))
+		else if (!SV_SnapshotCallback(cl, clientEnt, gEnt))
 		{
 			return;
 		}
 	}
 
-	eNums->snapshotEntities[eNums->numSnapshotEntities] = gEnt->s.number;
+	eNums->snapshotEntities[eNums->numSnapshotEntities] = num;
 	eNums->numSnapshotEntities++;
 }
 
+/**
+ * @brief Runs the game snapshot callbacks skipped while building the snapshot
+ * on a worker thread and removes the entities the game module rejects
+ * @param[in] cl
+ * @param[in,out] eNums
+ */
+static void SV_RunDeferredSnapshotCallbacks(client_t *cl, snapshotEntityNumbers_t *eNums)
+{
+	sharedEntity_t *clientEnt = SV_GentityNum(cl->frames[cl->netchan.outgoingSequence & PACKET_MASK].ps.clientNum);
+	int            i, num, count = 0;
+
+	for (i = 0; i < eNums->numSnapshotEntities; i++)
+	{
+		num = eNums->snapshotEntities[i];
+
+		if ((eNums->deferred[num >> 3] & (1 << (num & 7))) && !SV_SnapshotCallback(cl, clientEnt, SV_GentityNum(num)))
+		{
+			continue;
+		}
+
+		eNums->snapshotEntities[count++] = num;
+	}
+
+	eNums->numSnapshotEntities = count;
+}
+
+/*
+=============================================================================
+Visibility cache
+
+Clients standing in the same cluster and area see the same set of entities
+through the PVS, so the PVS and area tests are done once per cluster/area
+and frame. The cache is only used inside SV_SendClientMessages, entities
+and area portals can't change while the snapshots are built.
+=============================================================================
+*/
+
+#define VISCACHE_SIZE 256   // must be a power of 2
+
+/**
+ * @struct visCacheEntry_s
+ * @typedef visCacheEntry_t
+ * @brief
+ */
+typedef struct visCacheEntry_s
+{
+	int generation;                     ///< entry is valid if it matches visCache.generation
+	int cluster;
+	int area;
+	byte visible[MAX_GENTITIES / 8];    ///< entities passing the PVS and area tests
+} visCacheEntry_t;
+
+/**
+ * @struct visCache_s
+ * @typedef visCache_t
+ * @brief
+ */
+typedef struct visCache_s
+{
+	qboolean active;
+	int generation;
+	unsigned int hits;
+	unsigned int misses;
+	visCacheEntry_t entries[VISCACHE_SIZE];
+} visCache_t;
+
+static visCache_t visCache;
+
+/**
+ * @brief Tests an entity against the PVS of a client cluster and the connectivity of the client area
+ * @param[in] ent
+ * @param[in] svEnt
+ * @param[in] clientarea
+ * @param[in] bitvector PVS of the client cluster
+ * @return
+ */
+static qboolean SV_EntityInPVS(sharedEntity_t *ent, svEntity_t *svEnt, int clientarea, const byte *bitvector)
+{
+	int i, l;
+
+	// just check origin for being in pvs, ignore bmodel extents
+	if (ent->r.svFlags & SVF_IGNOREBMODELEXTENTS)
+	{
+		return (bitvector[svEnt->originCluster >> 3] & (1 << (svEnt->originCluster & 7))) ? qtrue : qfalse;
+	}
+
+	// ignore if not touching a PV leaf
+	// check area
+	if (!CM_AreasConnected(clientarea, svEnt->areanum))
+	{
+		// doors can legally straddle two areas, so
+		// we may need to check another one
+		if (!CM_AreasConnected(clientarea, svEnt->areanum2))
+		{
+			return qfalse;
+		}
+	}
+
+	// check individual leafs
+	if (!svEnt->numClusters)
+	{
+		return qfalse;
+	}
+	l = 0;
+	for (i = 0 ; i < svEnt->numClusters ; i++)
+	{
+		l = svEnt->clusternums[i];
+		if (bitvector[l >> 3] & (1 << (l & 7)))
+		{
+			break;
+		}
+	}
+
+	// if we haven't found it to be visible,
+	// check overflow clusters that coudln't be stored
+	if (i == svEnt->numClusters)
+	{
+		if (svEnt->lastCluster)
+		{
+			for ( ; l <= svEnt->lastCluster ; l++)
+			{
+				if (bitvector[l >> 3] & (1 << (l & 7)))
+				{
+					break;
+				}
+			}
+			if (l == svEnt->lastCluster)
+			{
+				return qfalse; // not visible
+			}
+		}
+		else
+		{
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Starts a new generation of the visibility cache, called once per SV_SendClientMessages
+ */
+static void SV_VisCacheBegin(void)
+{
+	visCache.active = qtrue;
+	visCache.generation++;
+}
+
+/**
+ * @brief Throws away all cached entries, entities were changed in the middle of sending snapshots
+ */
+static void SV_VisCacheInvalidate(void)
+{
+	visCache.generation++;
+}
+
+/**
+ * @brief SV_VisCacheEnd
+ */
+static void SV_VisCacheEnd(void)
+{
+	visCache.active = qfalse;
+}
+
+/**
+ * @brief Gets the entities passing the PVS and area tests for a client cluster and area
+ * @param[in] clientcluster
+ * @param[in] clientarea
+ * @param[in] insert compute and store missing entries, only allowed on the main thread
+ * @param[in,out] eNums receives the hit and miss counts
+ * @return The entity bitset or NULL if the tests have to be done per entity
+ */
+static const byte *SV_VisCacheLookup(int clientcluster, int clientarea, qboolean insert, snapshotEntityNumbers_t *eNums)
+{
+	visCacheEntry_t *entry;
+	sharedEntity_t  *ent;
+	const byte      *clientpvs;
+	int             i, e, hash;
+
+	if (!visCache.active)
+	{
+		return NULL;
+	}
+
+	hash = (clientcluster * 31 + clientarea) & (VISCACHE_SIZE - 1);
+
+	for (i = 0; i < VISCACHE_SIZE; i++)
+	{
+		entry = &visCache.entries[(hash + i) & (VISCACHE_SIZE - 1)];
+
+		if (entry->generation != visCache.generation)
+		{
+			break;
+		}
+
+		if (entry->cluster == clientcluster && entry->area == clientarea)
+		{
+			eNums->visCacheHits++;
+			return entry->visible;
+		}
+	}
+
+	eNums->visCacheMisses++;
+
+	// table is full or we may not write to it
+	if (i == VISCACHE_SIZE || !insert)
+	{
+		return NULL;
+	}
+
+	entry->generation = visCache.generation;
+	entry->cluster    = clientcluster;
+	entry->area       = clientarea;
+	Com_Memset(entry->visible, 0, sizeof(entry->visible));
+
+	clientpvs = CM_ClusterPVS(clientcluster);
+
+	for (e = 0 ; e < sv.num_entities ; e++)
+	{
+		ent = SV_GentityNum(e);
+
+		if (!ent->r.linked)
+		{
+			continue;
+		}
+
+		if (SV_EntityInPVS(ent, SV_SvEntityForGentity(ent), clientarea, clientpvs))
+		{
+			entry->visible[e >> 3] |= 1 << (e & 7);
+		}
+	}
+
+	return entry->visible;
+}
+
+/**
+ * @brief Adds the visibility cache counters of a built snapshot to the totals
+ * @param[in] eNums
+ */
+static void SV_VisCacheAddStats(const snapshotEntityNumbers_t *eNums)
+{
+	visCache.hits   += eNums->visCacheHits;
+	visCache.misses += eNums->visCacheMisses;
+}
+
 #ifdef FEATURE_ANTICHEAT
 /**
  * @brief SV_AddEntitiesVisibleFromPoint
@@ -572,17 +870,16 @@ static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSn
 static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSnapshot_t *frame, snapshotEntityNumbers_t *eNums)
 #endif
 {
-	int            e, i;
+	int            e;
 	sharedEntity_t *ent, *playerEnt, *ment;
 #ifdef FEATURE_ANTICHEAT
 	sharedEntity_t *client;
 #endif
 	svEntity_t *svEnt;
-	int        l;
 	int        clientarea, clientcluster;
 	int        leafnum;
 	byte       *clientpvs;
-	byte       *bitvector;
+	const byte *visible;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -601,6 +898,9 @@ static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSn
 
 	clientpvs = CM_ClusterPVS(clientcluster);
 
+	// workers may only read the cache, it was filled for their viewpoints beforehand
+	visible = SV_VisCacheLookup(clientcluster, clientarea, !eNums->deferCallbacks, eNums);
+
 	playerEnt = SV_GentityNum(frame->ps.clientNum);
 	if (playerEnt->r.svFlags & SVF_SELF_PORTAL)
 	{
@@ -653,7 +953,7 @@ static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSn
 		svEnt = SV_SvEntityForGentity(ent);
 
 		// don't double add an entity through portals
-		if (svEnt->snapshotCounter == sv.snapshotCounter)
+		if (SV_SnapshotEntityAdded(eNums, e))
 		{
 			continue;
 		}
@@ -677,68 +977,23 @@ static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSn
 			continue;
 		}
 
-		bitvector = clientpvs;
-
-		// just check origin for being in pvs, ignore bmodel extents
-		if (ent->r.svFlags & SVF_IGNOREBMODELEXTENTS)
-		{
-			if (bitvector[svEnt->originCluster >> 3] & (1 << (svEnt->originCluster & 7)))
-			{
-				SV_AddEntToSnapshot(cl, playerEnt, svEnt, ent, eNums);
-			}
-
-			continue;
-		}
-
-		// ignore if not touching a PV leaf
-		// check area
-		if (!CM_AreasConnected(clientarea, svEnt->areanum))
+		if (visible)
 		{
-			// doors can legally straddle two areas, so
-			// we may need to check another one
-			if (!CM_AreasConnected(clientarea, svEnt->areanum2))
+			if (!(visible[e >> 3] & (1 << (e & 7))))
 			{
 				continue;
 			}
 		}
-
-		// check individual leafs
-		if (!svEnt->numClusters)
+		else if (!SV_EntityInPVS(ent, svEnt, clientarea, clientpvs))
 		{
 			continue;
 		}
-		l = 0;
-		for (i = 0 ; i < svEnt->numClusters ; i++)
-		{
-			l = svEnt->clusternums[i];
-			if (bitvector[l >> 3] & (1 << (l & 7)))
-			{
-				break;
-			}
-		}
 
-		// if we haven't found it to be visible,
-		// check overflow clusters that coudln't be stored
-		if (i == svEnt->numClusters)
+		// just check origin for being in pvs, ignore bmodel extents
+		if (ent->r.svFlags & SVF_IGNOREBMODELEXTENTS)
 		{
-			if (svEnt->lastCluster)
-			{
-				for ( ; l <= svEnt->lastCluster ; l++)
-				{
-					if (bitvector[l >> 3] & (1 << (l & 7)))
-					{
-						break;
-					}
-				}
-				if (l == svEnt->lastCluster)
-				{
-					continue; // not visible
-				}
-			}
-			else
-			{
-				continue;
-			}
+			SV_AddEntToSnapshot(cl, playerEnt, svEnt, ent, eNums);
+			continue;
 		}
 
 		// added "visibility dummies"
@@ -752,7 +1007,7 @@ static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSn
 				svEntity_t *master = 0;
 				master = SV_SvEntityForGentity(ment);
 
-				if (master->snapshotCounter == sv.snapshotCounter || !ment->r.linked)
+				if (SV_SnapshotEntityAdded(eNums, ment->s.number) || !ment->r.linked)
 				{
 					continue;
 				}
@@ -801,7 +1056,7 @@ static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSn
 					continue;
 				}
 
-				if (master->snapshotCounter == sv.snapshotCounter)
+				if (SV_SnapshotEntityAdded(eNums, ment->s.number))
 				{
 					continue;
 				}
@@ -830,7 +1085,7 @@ static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSn
 			// exclude bots and free flying specs
 			if (!portal && !(client->r.svFlags & SVF_BOT) && (frame->ps.persistant[PERS_TEAM] != TEAM_SPECTATOR) && !(frame->ps.pm_flags & PMF_FOLLOW))
 			{
-				if (!SV_CanSee(frame->ps.clientNum, e))
+				if (!SV_WallhackCanSee(frame->ps.clientNum, e))
 				{
 					SV_RandomizePos(frame->ps.clientNum, e);
 					SV_AddEntToSnapshot(cl, client, svEnt, ent, eNums);
@@ -857,6 +1112,37 @@ static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSn
 	}
 }
 
+/**
+ * @brief Finds the point a client views the world from
+ * @param[in] clent
+ * @param[in] ps
+ * @param[out] org
+ */
+static void SV_ClientViewOrigin(sharedEntity_t *clent, playerState_t *ps, vec3_t org)
+{
+	if (clent->r.svFlags & SVF_SELF_PORTAL_EXCLUSIVE)
+	{
+		// find the client's viewpoint
+		VectorCopy(clent->s.origin2, org);
+	}
+	else
+	{
+		VectorCopy(ps->origin, org);
+	}
+	org[2] += ps->viewheight;
+
+	// added for 'lean'
+	// need to account for lean, so areaportal doors draw properly
+	if (ps->leanf != 0.f)
+	{
+		vec3_t right, v3ViewAngles;
+		VectorCopy(ps->viewangles, v3ViewAngles);
+		v3ViewAngles[2] += ps->leanf / 2.0f;
+		angles_vectors(v3ViewAngles, NULL, right, NULL);
+		VectorMA(org, ps->leanf, right, org);
+	}
+}
+
 /**
  * @brief Decides which entities are going to be visible to the client, and
  * copies off the playerstate and areabits.
@@ -867,29 +1153,30 @@ static void SV_AddEntitiesVisibleFromPoint(client_t *cl, vec3_t origin, clientSn
  * For viewing through other player's eyes, clent can be something other than client->gentity
  *
  * @param[in,out] client
+ * @param[out] entityNumbers sorted numbers of the entities to send
+ *
+ * @return qfalse if there is nothing to build, the entity states are left untouched then
+ *
+ * @note Safe to run on a worker thread when entityNumbers->deferCallbacks is set, see SV_SendClientMessagesParallel
  */
-static void SV_BuildClientSnapshot(client_t *client)
+static qboolean SV_BuildClientSnapshotEntities(client_t *client, snapshotEntityNumbers_t *entityNumbers)
 {
-	vec3_t                  org;
-	clientSnapshot_t        *frame;
-	snapshotEntityNumbers_t entityNumbers;
-	int                     i;
-	sharedEntity_t          *ent;
-	entityState_t           *state;
-	entityShared_t          *stateShared;
-	svEntity_t              *svEnt;
-	sharedEntity_t          *clent;
-	int                     clientNum;
-	playerState_t           *ps;
-
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
+	vec3_t           org;
+	clientSnapshot_t *frame;
+	int              i;
+	sharedEntity_t   *clent;
+	int              clientNum;
+	playerState_t    *ps;
 
 	// this is the frame we are creating
 	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	entityNumbers->numSnapshotEntities = 0;
+	entityNumbers->visCacheHits        = 0;
+	entityNumbers->visCacheMisses      = 0;
+	Com_Memset(entityNumbers->added, 0, sizeof(entityNumbers->added));
+	Com_Memset(entityNumbers->deferred, 0, sizeof(entityNumbers->deferred));
 	Com_Memset(frame->areabits, 0, sizeof(frame->areabits));
 
 	frame->num_entities = 0;
@@ -897,7 +1184,7 @@ static void SV_BuildClientSnapshot(client_t *client)
 	clent = client->gentity;
 	if (!clent || client->state == CS_ZOMBIE)
 	{
-		return;
+		return qfalse;
 	}
 
 	// grab the current playerState_t
@@ -911,38 +1198,17 @@ static void SV_BuildClientSnapshot(client_t *client)
 	{
 		Com_Error(ERR_DROP, "SV_BuildClientSnapshot: bad gEnt");
 	}
-	svEnt = &sv.svEntities[clientNum];
 
-	svEnt->snapshotCounter = sv.snapshotCounter;
-
-	if (clent->r.svFlags & SVF_SELF_PORTAL_EXCLUSIVE)
-	{
-		// find the client's viewpoint
-		VectorCopy(clent->s.origin2, org);
-	}
-	else
-	{
-		VectorCopy(ps->origin, org);
-	}
-	org[2] += ps->viewheight;
+	entityNumbers->added[clientNum >> 3] |= 1 << (clientNum & 7);
 
-	// added for 'lean'
-	// need to account for lean, so areaportal doors draw properly
-	if (frame->ps.leanf != 0.f)
-	{
-		vec3_t right, v3ViewAngles;
-		VectorCopy(ps->viewangles, v3ViewAngles);
-		v3ViewAngles[2] += frame->ps.leanf / 2.0f;
-		angles_vectors(v3ViewAngles, NULL, right, NULL);
-		VectorMA(org, frame->ps.leanf, right, org);
-	}
+	SV_ClientViewOrigin(clent, ps, org);
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
 #ifdef FEATURE_ANTICHEAT
-	SV_AddEntitiesVisibleFromPoint(client, org, frame, &entityNumbers, qfalse /*client->netchan.remoteAddress.type == NA_LOOPBACK*/);
+	SV_AddEntitiesVisibleFromPoint(client, org, frame, entityNumbers, qfalse /*client->netchan.remoteAddress.type == NA_LOOPBACK*/);
 #else
-	SV_AddEntitiesVisibleFromPoint(client, org, frame, &entityNumbers /*, qfalse, client->netchan.remoteAddress.type == NA_LOOPBACK*/);
+	SV_AddEntitiesVisibleFromPoint(client, org, frame, entityNumbers /*, qfalse, client->netchan.remoteAddress.type == NA_LOOPBACK*/);
 #endif
 
 	// clear the mask for next frame
@@ -952,8 +1218,8 @@ static void SV_BuildClientSnapshot(client_t *client)
 	// in the list which will need to be resorted for the delta compression
 	// to work correctly.  This also catches the error condition
 	// of an entity being included twice.
-	qsort(entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-	      sizeof(entityNumbers.snapshotEntities[0]), SV_QsortEntityNumbers);
+	qsort(entityNumbers->snapshotEntities, entityNumbers->numSnapshotEntities,
+	      sizeof(entityNumbers->snapshotEntities[0]), SV_QsortEntityNumbers);
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
@@ -962,42 +1228,91 @@ static void SV_BuildClientSnapshot(client_t *client)
 		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
 	}
 
-	// copy the entity states out
-	frame->num_entities = 0;
-	frame->first_entity = svs.nextSnapshotEntities;
-	for (i = 0 ; i < entityNumbers.numSnapshotEntities ; i++)
+	return qtrue;
+}
+
+/**
+ * @brief Reserves slots in the snapshot entity ring
+ * @param[in] count
+ * @return The first reserved slot (not anded off)
+ */
+static int SV_ReserveSnapshotEntities(int count)
+{
+	int firstEntity = svs.nextSnapshotEntities;
+
+	svs.nextSnapshotEntities += count;
+	// this should never hit, map should always be restarted first in SV_Frame
+	if (svs.nextSnapshotEntities >= 0x7FFFFFFE)
 	{
-		ent    = SV_GentityNum(entityNumbers.snapshotEntities[i]);
-		state  = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
-		*state = ent->s;
+		Com_Error(ERR_FATAL, "SV_BuildClientSnapshot: svs.nextSnapshotEntities wrapped");
+	}
+
+	return firstEntity;
+}
+
+/**
+ * @brief Copies the entity states of a built snapshot into the snapshot entity ring
+ * @param[in,out] client
+ * @param[in] entityNumbers
+ * @param[in] firstEntity see SV_ReserveSnapshotEntities
+ */
+static void SV_StoreClientSnapshotEntities(client_t *client, const snapshotEntityNumbers_t *entityNumbers, int firstEntity)
+{
+	clientSnapshot_t *frame;
+	int              i;
+	sharedEntity_t   *ent;
+	entityState_t    *state;
+	entityShared_t   *stateShared;
+
+	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
+	// copy the entity states out
+	frame->num_entities = 0;
+	frame->first_entity = firstEntity;
+	for (i = 0 ; i < entityNumbers->numSnapshotEntities ; i++)
+	{
+		ent    = SV_GentityNum(entityNumbers->snapshotEntities[i]);
+		state  = &svs.snapshotEntities[(firstEntity + i) % svs.numSnapshotEntities];
+		*state = ent->s;
 
 		if (client->ettvClient)
 		{
-			stateShared  = &svs.snapshotEntitiesShared[svs.nextSnapshotEntities % svs.numSnapshotEntities];
+			stateShared  = &svs.snapshotEntitiesShared[(firstEntity + i) % svs.numSnapshotEntities];
 			*stateShared = ent->r;
 		}
 
 #ifdef FEATURE_ANTICHEAT
-		if (sv_wh_active->integer && entityNumbers.snapshotEntities[i] < sv_maxclients->integer)
+		if (sv_wh_active->integer && entityNumbers->snapshotEntities[i] < sv_maxclients->integer)
 		{
-			if (SV_PositionChanged(entityNumbers.snapshotEntities[i]))
+			if (SV_PositionChanged(entityNumbers->snapshotEntities[i]))
 			{
-				SV_RestorePos(entityNumbers.snapshotEntities[i]);
+				SV_RestorePos(entityNumbers->snapshotEntities[i]);
 			}
 		}
 #endif
 
-		svs.nextSnapshotEntities++;
-		// this should never hit, map should always be restarted first in SV_Frame
-		if (svs.nextSnapshotEntities >= 0x7FFFFFFE)
-		{
-			Com_Error(ERR_FATAL, "SV_BuildClientSnapshot: svs.nextSnapshotEntities wrapped");
-		}
-
 		frame->num_entities++;
 	}
 }
 
+/**
+ * @brief SV_BuildClientSnapshot
+ * @param[in,out] client
+ */
+static void SV_BuildClientSnapshot(client_t *client)
+{
+	snapshotEntityNumbers_t entityNumbers;
+
+	entityNumbers.deferCallbacks = qfalse;
+
+	if (SV_BuildClientSnapshotEntities(client, &entityNumbers))
+	{
+		SV_StoreClientSnapshotEntities(client, &entityNumbers, SV_ReserveSnapshotEntities(entityNumbers.numSnapshotEntities));
+	}
+
+	SV_VisCacheAddStats(&entityNumbers);
+}
+
 #define UDPIP_HEADER_SIZE 28
 #define UDPIP6_HEADER_SIZE 48
 
@@ -1131,6 +1446,8 @@ void SV_SendClientIdle(client_t *client)
 
 	if (SV_CheckForMsgOverflow(client, &msg))
 	{
+		// the game module may have unlinked entities
+		SV_VisCacheInvalidate();
 		return;
 	}
 
@@ -1149,8 +1466,10 @@ void SV_SendClientIdle(client_t *client)
  */
 void SV_SendClientSnapshot(client_t *client)
 {
-	byte  msg_buf[MAX_MSGLEN];
-	msg_t msg;
+	byte             msg_buf[MAX_MSGLEN];
+	msg_t            msg;
+	clientSnapshot_t *oldframe;
+	int              lastframe;
 
 	if (client->state < CS_ACTIVE)
 	{
@@ -1190,10 +1509,13 @@ void SV_SendClientSnapshot(client_t *client)
 
 	// send over all the relevant entityState_t
 	// and the playerState_t
-	SV_WriteSnapshotToClient(client, &msg);
+	oldframe = SV_SelectDeltaFrame(client, svs.nextSnapshotEntities, &lastframe);
+	SV_WriteSnapshotToClient(client, &msg, oldframe, lastframe, NULL);
 
 	if (SV_CheckForMsgOverflow(client, &msg))
 	{
+		// the game module may have unlinked entities
+		SV_VisCacheInvalidate();
 		return;
 	}
 
@@ -1204,96 +1526,542 @@ void SV_SendClientSnapshot(client_t *client)
 }
 
 /**
- * @brief SV_SendClientMessages
+ * @brief Checks whether a client is due for a new snapshot, clients whose netchan download
+ * timed out are dropped here
+ * @param[in,out] c
+ * @return
  */
-void SV_SendClientMessages(void)
+static qboolean SV_ClientNeedsSnapshot(client_t *c)
 {
-	int      i;
-	client_t *c;
-	int      numclients = 0;    // net debugging
+	// changed <= CS_ZOMBIE to < CS_ZOMBIE so that the
+	// disconnect reason is properly sent in the network stream
+	// do not send a packet to a democlient, this will cause the engine to crash
+	if (c->state < CS_ZOMBIE || c->demoClient)
+	{
+		return qfalse;  // not connected
+	}
 
-	sv.bpsTotalBytes  = 0;      // net debugging
-	sv.ubpsTotalBytes = 0;      // net debugging
+	// needed to insert this otherwise bots would cause error drops in sv_net_chan.c:
+	// --> "netchan queue is not properly initialized in SV_Netchan_TransmitNextFragment\n"
+	if (c->gentity && (c->gentity->r.svFlags & SVF_BOT))
+	{
+		return qfalse;
+	}
 
-	// update any changed configstrings from this frame
-	SV_UpdateConfigStrings();
+	if (svs.time - c->lastSnapshotTime < c->snapshotMsec * com_timescale->value)
+	{
+		return qfalse;  // It's not time yet
+	}
+
+	if (*c->downloadName)
+	{
+		// If the client is downloading via netchan and has not acknowledged a package in 4secs drop it
+		if (c->download && (svs.time - c->downloadAckTime) > 4000)
+		{
+			SV_DropClient(c, "Download failed");
+
+			// the game module may have unlinked entities
+			SV_VisCacheInvalidate();
+		}
+		c->lastValidGamestate = svs.time;
+		return qfalse;  // Client is downloading, don't send snapshots
+	}
+	else if (c->state == CS_ACTIVE)
+	{
+		c->lastValidGamestate = svs.time;
+	}
+
+	if (c->netchan.unsentFragments || c->netchan_start_queue)
+	{
+		c->rateDelayed = qtrue;
+		return qfalse;  // Drop this snapshot if the packet queue is still full or delta compression will break
+	}
+
+	if (!(c->netchan.remoteAddress.type == NA_LOOPBACK ||
+	      (sv_lanForceRate->integer && Sys_IsLANAddress(&c->netchan.remoteAddress))))
+	{
+		// rate control for clients not on LAN
+		if (SV_RateMsec(c) > 0)
+		{
+			// Not enough time since last packet passed through the line
+			c->rateDelayed = qtrue;
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Bookkeeping after a new message was sent to a client
+ * @param[in,out] c
+ */
+static void SV_ClientSnapshotSent(client_t *c)
+{
+	c->lastSnapshotTime = svs.time;
+	c->rateDelayed      = qfalse;
+
+	if (!c->ettvClient || !sv_etltv_netblast->integer)
+	{
+		return;
+	}
 
-	// send a message to each connected client
-	for (i = 0; i < sv_maxclients->integer; i++)
+	while (c->netchan.unsentFragments)
 	{
-		c = &svs.clients[i];
+		SV_Netchan_TransmitNextFragment(c);
+	}
+}
+
+/*
+=============================================================================
+Parallel snapshot building
+
+With sv_workerThreads set, the visibility checks and the delta encoding of
+all clients due for a snapshot are spread over the worker pool. Everything
+touching the game module, the console or the network stays on the main
+thread and runs in client order, so the messages sent are the same the
+serial path produces.
+
+The game snapshot callbacks of a batch of clients all run before the first
+of them is sent. Only dropping a client changes the game entities in between,
+so batches end at clients dropped for a stalled download or an overflowed
+message. The jobs after an overflow are built again, and the game module
+sees their snapshot callbacks twice.
+=============================================================================
+*/
+
+/**
+ * @struct snapshotJob_s
+ * @typedef snapshotJob_t
+ * @brief
+ */
+typedef struct snapshotJob_s
+{
+	client_t *client;
+	qboolean idle;                          ///< client is loading, gets an idle packet instead
+	qboolean built;                         ///< see SV_BuildClientSnapshotEntities
+	int firstEntity;                        ///< reserved slots in svs.snapshotEntities
+	clientSnapshot_t *oldframe;             ///< see SV_SelectDeltaFrame
+	int lastframe;
+	int parseEntitiesNum;                   ///< client state to undo a job with, see SV_RunSnapshotJobs
+	int deltaMessage;
+	snapshotEntityNumbers_t entityNumbers;
+	msg_t msg;
+	byte msgBuf[MAX_MSGLEN];
+} snapshotJob_t;
+
+static snapshotJob_t *snapshotJobs;
+
+/**
+ * @brief SV_BuildSnapshotJob
+ * @param[in,out] data
+ * @param[in] index
+ */
+static void SV_BuildSnapshotJob(void *data, int index)
+{
+	snapshotJob_t *job = &((snapshotJob_t *)data)[index];
+
+	if (job->idle)
+	{
+		return;
+	}
+
+	job->entityNumbers.deferCallbacks = qtrue;
+	job->built                        = SV_BuildClientSnapshotEntities(job->client, &job->entityNumbers);
+}
+
+/**
+ * @brief Writes the complete snapshot message of a job, same as SV_SendClientSnapshot does,
+ * an idle job gets the message of SV_SendClientIdle
+ * @param[in,out] job
+ */
+static void SV_EncodeSnapshot(snapshotJob_t *job)
+{
+	client_t *client = job->client;
+
+	MSG_Init(&job->msg, job->msgBuf, sizeof(job->msgBuf));
+	job->msg.allowoverflow = qtrue;
+
+	if (!Com_IsCompatible(&client->agent, 0x1))
+	{
+		MSG_EnableCharStrip(&job->msg);
+	}
+
+	MSG_WriteLong(&job->msg, client->lastClientCommand);
+	SV_UpdateServerCommandsToClient(client, &job->msg);
 
-		// changed <= CS_ZOMBIE to < CS_ZOMBIE so that the
-		// disconnect reason is properly sent in the network stream
-		// do not send a packet to a democlient, this will cause the engine to crash
-		if (c->state < CS_ZOMBIE || c->demoClient)
+	if (job->idle)
+	{
+		return;
+	}
+
+	// the entity states aren't in the snapshot entity ring yet, read them from the game entities
+	SV_WriteSnapshotToClient(client, &job->msg, job->oldframe, job->lastframe, job->entityNumbers.snapshotEntities);
+}
+
+/**
+ * @brief SV_EncodeSnapshotJob
+ * @param[in,out] data
+ * @param[in] index
+ */
+static void SV_EncodeSnapshotJob(void *data, int index)
+{
+	snapshotJob_t *job = &((snapshotJob_t *)data)[index];
+
+	// ettv slaves are written on the main thread, see SV_SendClientMessagesParallel
+	if (!job->idle && job->client->ettvClient)
+	{
+		return;
+	}
+
+	SV_EncodeSnapshot(job);
+}
+
+/**
+ * @brief Decides whether snapshots of this frame can be built by the worker pool
+ *
+ * Also fixes up entity numbers and validates what SV_AddEntitiesVisibleFromPoint
+ * would otherwise do on the fly, so the workers never have to print or error out.
+ *
+ * @return
+ */
+static qboolean SV_ParallelSnapshots(void)
+{
+	sharedEntity_t *ent;
+	int            i, otherEntityNum;
+
+	if (!Com_NumWorkers())
+	{
+		if (snapshotJobs)
 		{
-			continue;       // not connected
+			Com_Dealloc(snapshotJobs);
+			snapshotJobs = NULL;
 		}
+		return qfalse;
+	}
+
+	// listen servers print net debugging output while writing deltas
+	if (!com_dedicated->integer || !sv.state)
+	{
+		return qfalse;
+	}
+
+#ifdef FEATURE_ANTICHEAT
+	// the anti-wallhack code moves player entities around while building snapshots
+	if (sv_wh_active->integer)
+	{
+		return qfalse;
+	}
+#endif
+
+#ifdef ETLEGACY_DEBUG
+	if (net_overhead.numSlices)
+	{
+		return qfalse;
+	}
+#endif
+
+	for (i = 0; i < sv.num_entities; i++)
+	{
+		ent = SV_GentityNum(i);
 
-		// needed to insert this otherwise bots would cause error drops in sv_net_chan.c:
-		// --> "netchan queue is not properly initialized in SV_Netchan_TransmitNextFragment\n"
-		if (c->gentity && (c->gentity->r.svFlags & SVF_BOT))
+		if (!ent->r.linked)
 		{
 			continue;
 		}
 
-		if (svs.time - c->lastSnapshotTime < c->snapshotMsec * com_timescale->value)
+		if (ent->s.number != i)
 		{
-			continue;       // It's not time yet
+			Com_DPrintf("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = i;
 		}
 
-		if (*c->downloadName)
+		if (ent->r.svFlags & SVF_VISDUMMY)
 		{
-			// If the client is downloading via netchan and has not acknowledged a package in 4secs drop it
-			if (c->download && (svs.time - c->downloadAckTime) > 4000)
+			otherEntityNum = SV_GentityNum(ent->s.otherEntityNum)->s.number;
+
+			if (otherEntityNum < 0 || otherEntityNum >= MAX_GENTITIES)
 			{
-				SV_DropClient(c, "Download failed");
+				return qfalse;  // let the serial path deal with it
 			}
-			c->lastValidGamestate = svs.time;
-			continue;       // Client is downloading, don't send snapshots
 		}
-		else if (c->state == CS_ACTIVE)
+	}
+
+	if (!snapshotJobs)
+	{
+		snapshotJobs = Com_Allocate(sizeof(*snapshotJobs) * MAX_CLIENTS);
+
+		if (!snapshotJobs)
 		{
-			c->lastValidGamestate = svs.time;
+			return qfalse;
 		}
+	}
 
-		if (c->netchan.unsentFragments || c->netchan_start_queue)
+	return qtrue;
+}
+
+/**
+ * @brief Builds, encodes and sends the snapshots of the picked clients
+ *
+ * A client dropped for an overflowed message can change the game entities,
+ * so the jobs after it are undone and have to be run again, the serial path
+ * builds those snapshots after the drop as well.
+ *
+ * @param[in] numJobs
+ * @return Number of jobs done
+ */
+static int SV_RunSnapshotJobs(int numJobs)
+{
+	int              i, numDone;
+	client_t         *c;
+	snapshotJob_t    *job;
+	clientSnapshot_t *frame;
+
+	Com_RunJobs(SV_BuildSnapshotJob, snapshotJobs, numJobs);
+
+	// finish the snapshots in client order, just like the serial path would
+	for (i = 0; i < numJobs; i++)
+	{
+		job              = &snapshotJobs[i];
+		job->firstEntity = svs.nextSnapshotEntities;
+
+		if (job->idle)
 		{
-			c->rateDelayed = qtrue;
-			continue;       // Drop this snapshot if the packet queue is still full or delta compression will break
+			continue;
+		}
+
+		if (job->built)
+		{
+			SV_RunDeferredSnapshotCallbacks(job->client, &job->entityNumbers);
+
+			frame               = &job->client->frames[job->client->netchan.outgoingSequence & PACKET_MASK];
+			job->firstEntity    = SV_ReserveSnapshotEntities(job->entityNumbers.numSnapshotEntities);
+			frame->first_entity = job->firstEntity;
+			frame->num_entities = job->entityNumbers.numSnapshotEntities;
 		}
 
-		if (!(c->netchan.remoteAddress.type == NA_LOOPBACK ||
-		      (sv_lanForceRate->integer && Sys_IsLANAddress(&c->netchan.remoteAddress))))
+		job->parseEntitiesNum = job->client->parseEntitiesNum;
+		job->deltaMessage     = job->client->deltaMessage;
+		job->oldframe         = SV_SelectDeltaFrame(job->client, svs.nextSnapshotEntities, &job->lastframe);
+
+		if (job->client->ettvClient)
+		{
+			SV_EncodeSnapshot(job);
+		}
+	}
+
+	Com_RunJobs(SV_EncodeSnapshotJob, snapshotJobs, numJobs);
+
+	// everything up to the first client dropped for an overflowed message is sent
+	for (numDone = 0; numDone < numJobs; )
+	{
+		job = &snapshotJobs[numDone++];
+
+		// idle messages carry the reliable commands and can overflow as well
+		if (job->msg.overflowed)
+		{
+			break;
+		}
+	}
+
+	for (i = numDone; i < numJobs; i++)
+	{
+		job = &snapshotJobs[i];
+
+		if (!job->idle)
+		{
+			job->client->parseEntitiesNum = job->parseEntitiesNum;
+			job->client->deltaMessage     = job->deltaMessage;
+		}
+	}
+
+	if (numDone < numJobs)
+	{
+		svs.nextSnapshotEntities = snapshotJobs[numDone].firstEntity;
+	}
+
+	// the old frames aren't read anymore, fill in the snapshot entity ring
+	// before anything (dropping a client) can touch the game entities
+	for (i = 0; i < numDone; i++)
+	{
+		job = &snapshotJobs[i];
+
+		if (job->idle)
+		{
+			continue;
+		}
+
+		SV_VisCacheAddStats(&job->entityNumbers);
+
+		if (job->built)
+		{
+			SV_StoreClientSnapshotEntities(job->client, &job->entityNumbers, job->firstEntity);
+		}
+	}
+
+	for (i = 0; i < numDone; i++)
+	{
+		job = &snapshotJobs[i];
+		c   = job->client;
+
+		if (SV_CheckForMsgOverflow(c, &job->msg))
+		{
+			// the game module may have unlinked entities
+			SV_VisCacheInvalidate();
+		}
+		else
+		{
+			SV_SendMessageToClient(&job->msg, c, !job->idle);
+
+			sv.bpsTotalBytes  += job->msg.cursize;          // net debugging
+			sv.ubpsTotalBytes += job->msg.uncompsize / 8;   // net debugging
+		}
+
+		SV_ClientSnapshotSent(c);
+	}
+
+	return numDone;
+}
+
+/**
+ * @brief Checks whether SV_ClientNeedsSnapshot may drop a client for a stalled download
+ * @param[in] c
+ * @return
+ */
+static qboolean SV_DownloadTimedOut(client_t *c)
+{
+	return c->state > CS_ZOMBIE && *c->downloadName && c->download && (svs.time - c->downloadAckTime) > 4000;
+}
+
+/**
+ * @brief SV_SendClientMessages using the worker pool
+ *
+ * Clients are handed to SV_RunSnapshotJobs in batches, a batch ends where
+ * a client gets dropped so the snapshots of the clients before it are
+ * built from the game entities as they were before the drop.
+ *
+ * @return Number of clients a message was sent to
+ */
+static int SV_SendClientMessagesParallel(void)
+{
+	int           i = 0, numJobs, numDone, numClients = 0;
+	client_t      *c;
+	snapshotJob_t *job;
+
+	while (i < sv_maxclients->integer)
+	{
+		// pick the clients due for a snapshot
+		for (numJobs = 0; i < sv_maxclients->integer; i++)
 		{
-			// rate control for clients not on LAN
-			if (SV_RateMsec(c) > 0)
+			c = &svs.clients[i];
+
+			if (numJobs && SV_DownloadTimedOut(c))
+			{
+				break;
+			}
+
+			if (!SV_ClientNeedsSnapshot(c))
 			{
-				// Not enough time since last packet passed through the line
-				c->rateDelayed = qtrue;
 				continue;
 			}
+
+			job         = &snapshotJobs[numJobs++];
+			job->client = c;
+			job->built  = qfalse;
+
+			// zombie clients need full snaps so they can still process reliable commands
+			// (eg so they can pick up the disconnect reason)
+			job->idle = (c->state < CS_ACTIVE && c->state != CS_ZOMBIE);
+
+			if (!job->idle && c->gentity && c->state != CS_ZOMBIE)
+			{
+				playerState_t *ps = SV_GameClientNum(i);
+				vec3_t        org;
+				int           leafnum;
+
+				if (ps->clientNum < 0 || ps->clientNum >= MAX_GENTITIES)
+				{
+					Com_Error(ERR_DROP, "SV_BuildClientSnapshot: bad gEnt");
+				}
+
+				// workers can't fill the visibility cache, do it for them
+				SV_ClientViewOrigin(c->gentity, ps, org);
+				leafnum = CM_PointLeafnum(org);
+				SV_VisCacheLookup(CM_LeafCluster(leafnum), CM_LeafArea(leafnum), qtrue, &job->entityNumbers);
+			}
 		}
 
-		numclients++; // net debugging
+		if (!numJobs)
+		{
+			break;
+		}
 
-		// generate and send a new message
-		SV_SendClientSnapshot(c);
-		c->lastSnapshotTime = svs.time;
-		c->rateDelayed      = qfalse;
+		numDone     = SV_RunSnapshotJobs(numJobs);
+		numClients += numDone;
 
-		if (!c->ettvClient || !sv_etltv_netblast->integer)
+		// pick the undone clients again
+		if (numDone < numJobs)
 		{
-			continue;
+			i = (int)(snapshotJobs[numDone].client - svs.clients);
 		}
+	}
+
+	return numClients;
+}
 
-		while (c->netchan.unsentFragments)
+/**
+ * @brief SV_SendClientMessages
+ */
+void SV_SendClientMessages(void)
+{
+	int      i;
+	client_t *c;
+	int      numclients = 0;    // net debugging
+
+	sv.bpsTotalBytes  = 0;      // net debugging
+	sv.ubpsTotalBytes = 0;      // net debugging
+
+	// update any changed configstrings from this frame
+	SV_UpdateConfigStrings();
+
+	SV_VisCacheBegin();
+	NET_BeginPacketBatch();
+
+#ifdef FEATURE_ANTICHEAT
+	// player to player visibility is worked out once for all snapshots
+	if (sv_wh_active->integer > 0)
+	{
+		SV_WallhackFrame();
+	}
+#endif
+
+	if (SV_ParallelSnapshots())
+	{
+		numclients = SV_SendClientMessagesParallel();
+	}
+	else
+	{
+		// send a message to each connected client
+		for (i = 0; i < sv_maxclients->integer; i++)
 		{
-			SV_Netchan_TransmitNextFragment(c);
+			c = &svs.clients[i];
+
+			if (!SV_ClientNeedsSnapshot(c))
+			{
+				continue;
+			}
+
+			numclients++; // net debugging
+
+			// generate and send a new message
+			SV_SendClientSnapshot(c);
+			SV_ClientSnapshotSent(c);
 		}
 	}
 
+	NET_FlushPacketBatch();
+	SV_VisCacheEnd();
+
 	// net debugging
 	if (sv_showAverageBPS->integer && numclients > 0)
 	{
@@ -1395,6 +2163,12 @@ void SV_PrintNetworkOverhead_f(void)
 {
 	int i;
 
+	if (visCache.hits + visCache.misses)
+	{
+		Com_Printf("vis cache hits:     %u (%.2f%%)\n", visCache.hits, visCache.hits * 100.0 / (visCache.hits + visCache.misses));
+		Com_Printf("vis cache misses:   %u\n", visCache.misses);
+	}
+
 	if (net_overhead.numBytesSent == 0)
 	{
 		return;
@@ -1444,6 +2218,9 @@ void SV_ClearNetworkOverhead_f(void)
 {
 	int i;
 
+	visCache.hits   = 0;
+	visCache.misses = 0;
+
 	net_overhead.numBytesSent = 0;
 	net_overhead.numSent      = 0;
 	for (i = 0; i < net_overhead.numSlices; i++)
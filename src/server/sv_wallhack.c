@@ -39,6 +39,7 @@ static vec3_t delta[8];
 
 static int bbox_horz;
 static int bbox_vert;
+static int bbox_generation;     ///< changes with the deltas, invalidates cached visibility
 
 //======================================================================
 // local functions
@@ -461,6 +462,43 @@ static int is_visible(vec3_t start, vec3_t end)
 
 //======================================================================
 
+#define VOFS              6
+
+/**
+ * @brief Checks if any corner of the bounding box around 'org' can be seen from 'viewpoint'
+ * @param[in] viewpoint
+ * @param[in] org
+ * @param[in,out] traces Number of traces done is added, may be NULL
+ * @return
+ */
+static int bbox_visible(vec3_t viewpoint, vec3_t org, int *traces)
+{
+	vec3_t tmp;
+	int    i;
+
+	for (i = 0; i < 8; i++)
+	{
+		VectorCopy(org, tmp);
+		tmp[0] += delta[i][0];
+		tmp[1] += delta[i][1];
+		tmp[2] += delta[i][2] + VOFS;
+
+		if (traces)
+		{
+			(*traces)++;
+		}
+
+		if (is_visible(viewpoint, tmp))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+//======================================================================
+
 /**
  * @brief init_horz_delta
  */
@@ -469,6 +507,7 @@ static void init_horz_delta(void)
 	int i;
 
 	bbox_horz = sv_wh_bbox_horz->integer;
+	bbox_generation++;
 
 	for (i = 0; i < 8; i++)
 	{
@@ -487,6 +526,7 @@ static void init_vert_delta(void)
 	int i;
 
 	bbox_vert = sv_wh_bbox_vert->integer;
+	bbox_generation++;
 
 	for (i = 0; i < 8; i++)
 	{
@@ -510,7 +550,6 @@ void SV_InitWallhack(void)
 //======================================================================
 
 #define PREDICT_TIME      0.1f
-#define VOFS              6
 
 /**
  * @brief Checks if 'player' can see 'other' or not.
@@ -537,8 +576,7 @@ int SV_CanSee(int player, int other)
 {
 	sharedEntity_t *pent, *oent;
 	playerState_t  *ps;
-	vec3_t         viewpoint, tmp;
-	int            i;
+	vec3_t         viewpoint;
 
 	// check if bounding box has been changed
 	if (sv_wh_bbox_horz->integer != bbox_horz)
@@ -567,17 +605,9 @@ int SV_CanSee(int player, int other)
 	// check if visible in this frame
 	calc_viewpoint(ps, pent->s.pos.trBase, viewpoint);
 
-	for (i = 0; i < 8; i++)
+	if (bbox_visible(viewpoint, oent->s.pos.trBase, NULL))
 	{
-		VectorCopy(oent->s.pos.trBase, tmp);
-		tmp[0] += delta[i][0];
-		tmp[1] += delta[i][1];
-		tmp[2] += delta[i][2] + VOFS;
-
-		if (is_visible(viewpoint, tmp))
-		{
-			return 1;
-		}
+		return 1;
 	}
 
 	// predict player positions
@@ -602,20 +632,421 @@ int SV_CanSee(int player, int other)
 	// check if expected to be visible in the next frame
 	calc_viewpoint(ps, pred_ppos, viewpoint);
 
-	for (i = 0; i < 8; i++)
+	return bbox_visible(viewpoint, pred_opos, NULL);
+}
+
+//======================================================================
+// visibility matrix
+//======================================================================
+
+/**
+ * @struct whClient_s
+ * @typedef whClient_t
+ * @brief Per client input of the visibility matrix
+ */
+typedef struct whClient_s
+{
+	qboolean viewer;            ///< due for a snapshot that may hide other players
+	qboolean target;            ///< linked in, may be hidden from viewers
+	vec3_t angles;
+	vec3_t origin;
+	vec3_t viewpoint;
+	vec3_t pred_origin;         ///< origin extrapolated by PREDICT_TIME
+	vec3_t pred_viewpoint;
+} whClient_t;
+
+/**
+ * @struct whMatrix_s
+ * @typedef whMatrix_t
+ * @brief Which players can see which other players in the current frame
+ */
+typedef struct whMatrix_s
+{
+	whClient_t clients[MAX_CLIENTS];
+	int viewers[MAX_CLIENTS];
+	int numViewers;
+
+	byte computed[MAX_CLIENTS][MAX_CLIENTS / 8];    ///< pairs worked out by SV_WallhackFrame
+	byte visible[MAX_CLIENTS][MAX_CLIENTS / 8];
+	int traces[MAX_CLIENTS];                        ///< traces done for each viewer, written by the jobs
+	int reused[MAX_CLIENTS];                        ///< pairs answered from the pair cache, per viewer
+	int deferred[MAX_CLIENTS];                      ///< pairs skipped because the budget ran out, per viewer
+	int64_t deadline;                               ///< Sys_Microseconds after which pairs are deferred, 0 for no limit
+	int serverId;
+
+	// statistics, see SV_WallhackStats_f
+	int lastTime;                                   ///< usec spent on the last frame
+	int maxTime;
+	int lastPairs;
+	int lastTraces;
+	int lastReused;
+	int lastDeferred;
+	int64_t totalTime;
+	int64_t totalPairs;
+	int64_t totalTraces;
+	int64_t totalReused;
+	int64_t totalDeferred;
+	int frames;
+	int fallbacks;                                  ///< pairs that weren't in the matrix and were traced serially
+} whMatrix_t;
+
+static whMatrix_t wh_matrix;
+
+#define WH_CACHE_MAXAGE   1000  ///< msec a pair result is reused at most
+#define WH_DEFER_MAXAGE   200   ///< msec a hidden result is kept for a pair deferred by sv_wh_budget
+#define WH_CACHE_ANGLE    1.0f  ///< degrees the view may turn before a fov checked pair is traced again
+
+/**
+ * @struct whPair_s
+ * @typedef whPair_t
+ * @brief Last traced result of a viewer and target pair and the positions it was traced for
+ */
+typedef struct whPair_s
+{
+	vec3_t viewpoint;
+	vec3_t pred_viewpoint;
+	vec3_t origin;
+	vec3_t pred_origin;
+	vec3_t angles;
+	int time;                   ///< svs.time of the traces, 0 if unused
+	int generation;             ///< bbox_generation of the traces
+	int check_fov;
+	int visible;
+} whPair_t;
+
+static whPair_t wh_pairs[MAX_CLIENTS][MAX_CLIENTS];
+
+/**
+ * @brief Checks if a cached pair result still applies
+ *
+ * The world traces only depend on the viewpoints and target positions, now and predicted.
+ * The view angles only matter when the fov is checked.
+ *
+ * @param[in] pair
+ * @param[in] p
+ * @param[in] o
+ * @param[in] maxAge msec
+ * @return
+ */
+static qboolean pair_unchanged(whPair_t *pair, whClient_t *p, whClient_t *o, int maxAge)
+{
+	float dist = sv_wh_cache_dist->value * sv_wh_cache_dist->value;
+	int   i;
+
+	if (!pair->time || svs.time - pair->time > maxAge || pair->generation != bbox_generation
+	    || pair->check_fov != sv_wh_check_fov->integer)
 	{
-		VectorCopy(pred_opos, tmp);
-		tmp[0] += delta[i][0];
-		tmp[1] += delta[i][1];
-		tmp[2] += delta[i][2] + VOFS;
+		return qfalse;
+	}
 
-		if (is_visible(viewpoint, tmp))
+	if (DistanceSquared(pair->viewpoint, p->viewpoint) > dist || DistanceSquared(pair->pred_viewpoint, p->pred_viewpoint) > dist
+	    || DistanceSquared(pair->origin, o->origin) > dist || DistanceSquared(pair->pred_origin, o->pred_origin) > dist)
+	{
+		return qfalse;
+	}
+
+	if (pair->check_fov > 0)
+	{
+		for (i = 0; i < 3; i++)
 		{
-			return 1;
+			if (Q_fabs(AngleDelta(pair->angles[i], p->angles[i])) > WH_CACHE_ANGLE)
+			{
+				return qfalse;
+			}
 		}
 	}
 
-	return 0;
+	return qtrue;
+}
+
+/**
+ * @brief Same test as SV_CanSee, for a pair of clients prepared by SV_WallhackFrame
+ *
+ * @note Only does world traces, so it can run on the worker pool
+ *
+ * @param[in] player
+ * @param[in] other
+ * @param[in,out] traces
+ * @return
+ */
+static int pair_visible(int player, int other, int *traces)
+{
+	whClient_t *p = &wh_matrix.clients[player];
+	whClient_t *o = &wh_matrix.clients[other];
+
+	// check if 'other' is in the maximum fov allowed
+	if (sv_wh_check_fov->integer > 0 && !player_in_fov(p->angles, p->origin, o->origin))
+	{
+		return 0;
+	}
+
+	// check if visible in this frame
+	if (bbox_visible(p->viewpoint, o->origin, traces))
+	{
+		return 1;
+	}
+
+	if (sv_wh_check_fov->integer > 0 && !player_in_fov(p->angles, p->pred_origin, o->pred_origin))
+	{
+		return 0;
+	}
+
+	// check if expected to be visible in the next frame
+	return bbox_visible(p->pred_viewpoint, o->pred_origin, traces);
+}
+
+/**
+ * @brief Fills the matrix row of one viewer
+ * @param data - unused
+ * @param[in] index
+ */
+static void SV_WallhackJob(void *data, int index)
+{
+	int        player = wh_matrix.viewers[index];
+	whClient_t *p     = &wh_matrix.clients[player];
+	whClient_t *o;
+	whPair_t   *pair;
+	int        i, other, visible, traces = 0, reused = 0, deferred = 0;
+
+	// start at a different client every frame so a short budget doesn't always defer the same pairs
+	for (i = 0; i < sv_maxclients->integer; i++)
+	{
+		other = (i + wh_matrix.frames) % sv_maxclients->integer;
+
+		if (!(wh_matrix.computed[player][other >> 3] & (1 << (other & 7))))
+		{
+			continue;
+		}
+
+		o    = &wh_matrix.clients[other];
+		pair = &wh_pairs[player][other];
+
+		if (sv_wh_cache_dist->value > 0 && pair_unchanged(pair, p, o, WH_CACHE_MAXAGE))
+		{
+			visible = pair->visible;
+			reused++;
+		}
+		else if (wh_matrix.deadline && Sys_Microseconds() > wh_matrix.deadline)
+		{
+			// out of time, rather show a player than hide a visible one, a hidden result
+			// is only kept while it is recent and neither player moved past sv_wh_cache_dist
+			visible = pair->visible || !pair_unchanged(pair, p, o, WH_DEFER_MAXAGE);
+			deferred++;
+		}
+		else
+		{
+			visible = pair_visible(player, other, &traces);
+
+			VectorCopy(p->viewpoint, pair->viewpoint);
+			VectorCopy(p->pred_viewpoint, pair->pred_viewpoint);
+			VectorCopy(o->origin, pair->origin);
+			VectorCopy(o->pred_origin, pair->pred_origin);
+			VectorCopy(p->angles, pair->angles);
+			pair->time       = svs.time;
+			pair->generation = bbox_generation;
+			pair->check_fov  = sv_wh_check_fov->integer;
+			pair->visible    = visible;
+		}
+
+		if (visible)
+		{
+			wh_matrix.visible[player][other >> 3] |= 1 << (other & 7);
+		}
+	}
+
+	wh_matrix.traces[player]   = traces;
+	wh_matrix.reused[player]   = reused;
+	wh_matrix.deferred[player] = deferred;
+}
+
+/**
+ * @brief Works out which players can see each other before the snapshots of this
+ * frame are built, spread over the worker pool
+ *
+ * Player positions are predicted once per client instead of once per pair. Pairs
+ * which aren't potentially visible from the viewpoint are left out, snapshots fall
+ * back to SV_CanSee for them.
+ */
+void SV_WallhackFrame(void)
+{
+	int64_t        start = Sys_Microseconds();
+	int            i, j, pairs = 0, traces = 0, reused = 0, deferred = 0;
+	client_t       *cl;
+	whClient_t     *c;
+	sharedEntity_t *ent;
+	playerState_t  *ps;
+	vec3_t         org;
+
+	// check if bounding box has been changed
+	if (sv_wh_bbox_horz->integer != bbox_horz)
+	{
+		init_horz_delta();
+	}
+
+	if (sv_wh_bbox_vert->integer != bbox_vert)
+	{
+		init_vert_delta();
+	}
+
+	// cached pairs belong to the previous map
+	if (wh_matrix.serverId != sv.serverId)
+	{
+		Com_Memset(wh_pairs, 0, sizeof(wh_pairs));
+		wh_matrix.serverId = sv.serverId;
+	}
+
+	Com_Memset(wh_matrix.computed, 0, sizeof(wh_matrix.computed));
+	Com_Memset(wh_matrix.visible, 0, sizeof(wh_matrix.visible));
+	wh_matrix.numViewers = 0;
+
+	for (i = 0; i < sv_maxclients->integer; i++)
+	{
+		cl = &svs.clients[i];
+		c  = &wh_matrix.clients[i];
+
+		c->viewer = qfalse;
+		c->target = qfalse;
+
+		if (cl->state < CS_CONNECTED)
+		{
+			continue;
+		}
+
+		ent = SV_GentityNum(i);
+		if (!ent->r.linked)
+		{
+			continue;
+		}
+
+		c->target = qtrue;
+		VectorCopy(ent->s.pos.trBase, c->origin);
+		VectorCopy(ent->s.apos.trBase, c->angles);
+
+		// predict player positions
+		copy_trajectory(&ent->s.pos, &traject);
+		predict_move(ent, PREDICT_TIME, &traject, c->pred_origin);
+
+		// same exclusions as the snapshot code: bots, free flying specs and clients not due for a snapshot
+		ps = SV_GameClientNum(i);
+		if (cl->state != CS_ACTIVE || (ent->r.svFlags & SVF_BOT) || ps->persistant[PERS_TEAM] == TEAM_SPECTATOR || (ps->pm_flags & PMF_FOLLOW)
+		    || svs.time - cl->lastSnapshotTime < cl->snapshotMsec * com_timescale->value)
+		{
+			continue;
+		}
+
+		// calc_viewpoint may move the origin it is given
+		VectorCopy(c->origin, org);
+		calc_viewpoint(ps, org, c->viewpoint);
+		VectorCopy(c->pred_origin, org);
+		calc_viewpoint(ps, org, c->pred_viewpoint);
+
+		c->viewer                                 = qtrue;
+		wh_matrix.viewers[wh_matrix.numViewers++] = i;
+	}
+
+	for (i = 0; i < wh_matrix.numViewers; i++)
+	{
+		c = &wh_matrix.clients[wh_matrix.viewers[i]];
+
+		for (j = 0; j < sv_maxclients->integer; j++)
+		{
+			if (j == wh_matrix.viewers[i] || !wh_matrix.clients[j].target)
+			{
+				continue;
+			}
+
+			if (!SV_inPVS(c->viewpoint, wh_matrix.clients[j].origin))
+			{
+				continue;
+			}
+
+			wh_matrix.computed[wh_matrix.viewers[i]][j >> 3] |= 1 << (j & 7);
+			pairs++;
+		}
+	}
+
+	// the budget covers the traces only, preparing the clients is needed anyway
+	wh_matrix.deadline = sv_wh_budget->integer > 0 ? Sys_Microseconds() + sv_wh_budget->integer : 0;
+
+	Com_RunJobs(SV_WallhackJob, NULL, wh_matrix.numViewers);
+
+	for (i = 0; i < wh_matrix.numViewers; i++)
+	{
+		traces   += wh_matrix.traces[wh_matrix.viewers[i]];
+		reused   += wh_matrix.reused[wh_matrix.viewers[i]];
+		deferred += wh_matrix.deferred[wh_matrix.viewers[i]];
+	}
+
+	wh_matrix.lastTime       = (int)(Sys_Microseconds() - start);
+	wh_matrix.lastPairs      = pairs;
+	wh_matrix.lastTraces     = traces;
+	wh_matrix.lastReused     = reused;
+	wh_matrix.lastDeferred   = deferred;
+	wh_matrix.maxTime        = MAX(wh_matrix.maxTime, wh_matrix.lastTime);
+	wh_matrix.totalTime     += wh_matrix.lastTime;
+	wh_matrix.totalPairs    += pairs;
+	wh_matrix.totalTraces   += traces;
+	wh_matrix.totalReused   += reused;
+	wh_matrix.totalDeferred += deferred;
+	wh_matrix.frames++;
+}
+
+/**
+ * @brief Looks up if 'player' can see 'other' in the matrix of this frame
+ * @param[in] player
+ * @param[in] other
+ * @return
+ */
+int SV_WallhackCanSee(int player, int other)
+{
+	if (wh_matrix.computed[player][other >> 3] & (1 << (other & 7)))
+	{
+		return (wh_matrix.visible[player][other >> 3] & (1 << (other & 7))) ? 1 : 0;
+	}
+
+	wh_matrix.fallbacks++;
+	return SV_CanSee(player, other);
+}
+
+/**
+ * @brief Prints the cost of the anti-wallhack visibility checks, 'reset' clears the counters
+ */
+void SV_WallhackStats_f(void)
+{
+	if (Cmd_Argc() > 1 && !Q_stricmp(Cmd_Argv(1), "reset"))
+	{
+		wh_matrix.maxTime       = 0;
+		wh_matrix.totalTime     = 0;
+		wh_matrix.totalPairs    = 0;
+		wh_matrix.totalTraces   = 0;
+		wh_matrix.totalReused   = 0;
+		wh_matrix.totalDeferred = 0;
+		wh_matrix.frames        = 0;
+		wh_matrix.fallbacks     = 0;
+		return;
+	}
+
+	if (!sv_wh_active->integer)
+	{
+		Com_Printf("Anti-wallhack is disabled (sv_wh_active 0).\n");
+	}
+
+	if (!wh_matrix.frames)
+	{
+		Com_Printf("No frames measured.\n");
+		return;
+	}
+
+	Com_Printf("last frame: %i usec, %i pairs (%i reused, %i deferred), %i traces, %i viewers\n",
+	           wh_matrix.lastTime, wh_matrix.lastPairs, wh_matrix.lastReused, wh_matrix.lastDeferred,
+	           wh_matrix.lastTraces, wh_matrix.numViewers);
+	Com_Printf("%i frames: %.1f usec avg, %i usec max, %.1f pairs and %.1f traces per frame, %i fallbacks, %i worker threads\n",
+	           wh_matrix.frames, (double)wh_matrix.totalTime / wh_matrix.frames, wh_matrix.maxTime,
+	           (double)wh_matrix.totalPairs / wh_matrix.frames, (double)wh_matrix.totalTraces / wh_matrix.frames,
+	           wh_matrix.fallbacks, Com_NumWorkers());
+	Com_Printf("pair cache: %.1f%% reused, %.1f%% deferred by the budget\n",
+	           wh_matrix.totalPairs ? 100.0 * wh_matrix.totalReused / wh_matrix.totalPairs : 0.0,
+	           wh_matrix.totalPairs ? 100.0 * wh_matrix.totalDeferred / wh_matrix.totalPairs : 0.0);
 }
 
 //======================================================================
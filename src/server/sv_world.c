@@ -66,9 +66,14 @@ clipHandle_t SV_ClipHandleForEntity(const sharedEntity_t *ent)
 ENTITY CHECKING
 
 To avoid linearly searching through lists of entities during environment testing,
-the world is carved up with an evenly spaced, axially aligned bsp tree.  Entities
-are kept in chains either at the final leafs, or at the first node that splits
-them, which prevents having to deal with multiple fragments of a single entity.
+the world is carved up with an axially aligned bsp tree.  Entities are kept in
+chains either at the final leafs, or at the first node that splits them, which
+prevents having to deal with multiple fragments of a single entity.
+
+The tree starts out evenly spaced, leafs collecting too many entities are split
+again at the median of the entities they hold, so crowded spots of a map get a
+finer subdivision than empty ones. Such a split is turned back into a leaf once
+all of its entities are gone.
 ===============================================================================
 */
 
@@ -76,16 +81,30 @@ typedef struct worldSector_s
 {
 	int axis;                         // -1 = leaf node
 	float dist;
-	struct     worldSector_s *children[2];
+	struct     worldSector_s *children[2];   // children[0] links the free sectors
+	struct     worldSector_s *parent;
 	svEntity_t *entities;
+	vec3_t mins, maxs;
+	int depth;                        // -1 = free, see SV_FreeWorldSector
+	int numEntities;                  // entities linked to this node
+	int splitCount;                   // leaf is split when it holds more entities
 } worldSector_t;
 
-#define AREA_DEPTH  4
-#define AREA_NODES  64
+#define AREA_DEPTH          4       // initial uniform subdivision
+#define AREA_MAX_DEPTH      12
+#define AREA_NODES          1024
+#define AREA_SPLIT_COUNT    16
+#define AREA_MIN_SIZE       256     // sectors aren't split below this size
 
 worldSector_t sv_worldSectors[AREA_NODES];
 int           sv_numworldSectors;
 
+static worldSector_t *sv_freeWorldSectors;      // given back by SV_CollapseWorldSector
+static int           sv_numFreeWorldSectors;
+
+static qboolean sv_worldSectorsFixed;   // no adaptive splits, see SV_SectorBench_f
+static int      sv_areaEntitiesChecked; // entities tested by SV_AreaEntities, see SV_SectorBench_f
+
 /**
  * @brief SV_SectorList_f
  */
@@ -95,18 +114,53 @@ void SV_SectorList_f(void)
 	worldSector_t *sec;
 	svEntity_t    *ent;
 
-	for (i = 0 ; i < AREA_NODES ; i++)
+	for (i = 0 ; i < sv_numworldSectors ; i++)
 	{
 		sec = &sv_worldSectors[i];
 
+		if (sec->depth < 0)
+		{
+			continue;
+		}
+
 		c = 0;
 		for (ent = sec->entities ; ent ; ent = ent->nextEntityInWorldSector)
 		{
 			c++;
 		}
 
-		Com_Printf("sector %i: %i entities\n", i, c);
+		Com_Printf("sector %i (depth %i%s): %i entities\n", i, sec->depth, sec->axis == -1 ? ", leaf" : "", c);
+	}
+}
+
+/**
+ * @brief Takes a sector from the free list or the end of sv_worldSectors
+ * @return
+ */
+static worldSector_t *SV_AllocWorldSector(void)
+{
+	worldSector_t *node = sv_freeWorldSectors;
+
+	if (node)
+	{
+		sv_freeWorldSectors = node->children[0];
+		sv_numFreeWorldSectors--;
+		return node;
 	}
+
+	return &sv_worldSectors[sv_numworldSectors++];
+}
+
+/**
+ * @brief SV_FreeWorldSector
+ * @param[in,out] node
+ */
+static void SV_FreeWorldSector(worldSector_t *node)
+{
+	node->depth         = -1;
+	node->children[0]   = sv_freeWorldSectors;
+	sv_freeWorldSectors = node;
+	sv_numFreeWorldSectors++;
 }
 
 /**
@@ -118,13 +172,19 @@ void SV_SectorList_f(void)
  */
 worldSector_t *SV_CreateworldSector(int depth, vec3_t mins, vec3_t maxs)
 {
-	worldSector_t *anode = &sv_worldSectors[sv_numworldSectors];
+	worldSector_t *anode = SV_AllocWorldSector();
 	vec3_t        size;
 	vec3_t        mins1, maxs1, mins2, maxs2;
 
-	sv_numworldSectors++;
+	VectorCopy(mins, anode->mins);
+	VectorCopy(maxs, anode->maxs);
+	anode->depth       = depth;
+	anode->parent      = NULL;
+	anode->entities    = NULL;
+	anode->numEntities = 0;
+	anode->splitCount  = AREA_SPLIT_COUNT;
 
-	if (depth == AREA_DEPTH)
+	if (depth >= AREA_DEPTH)
 	{
 		anode->axis        = -1;
 		anode->children[0] = anode->children[1] = NULL;
@@ -149,12 +209,185 @@ worldSector_t *SV_CreateworldSector(int depth, vec3_t mins, vec3_t maxs)
 
 	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
 
-	anode->children[0] = SV_CreateworldSector(depth + 1, mins2, maxs2);
-	anode->children[1] = SV_CreateworldSector(depth + 1, mins1, maxs1);
+	anode->children[0]         = SV_CreateworldSector(depth + 1, mins2, maxs2);
+	anode->children[1]         = SV_CreateworldSector(depth + 1, mins1, maxs1);
+	anode->children[0]->parent = anode->children[1]->parent = anode;
 
 	return anode;
 }
 
+/**
+ * @brief SV_SortFloats
+ * @param[in] a
+ * @param[in] b
+ * @return
+ */
+static int QDECL SV_SortFloats(const void *a, const void *b)
+{
+	float fa = *(const float *)a;
+	float fb = *(const float *)b;
+
+	if (fa < fb)
+	{
+		return -1;
+	}
+
+	return fa > fb;
+}
+
+/**
+ * @brief Splits a crowded leaf at the median of its entities and moves
+ * the entities not crossing the split down to the new leafs
+ * @param[in,out] node
+ */
+static void SV_SplitWorldSector(worldSector_t *node)
+{
+	static float   centers[MAX_GENTITIES];
+	svEntity_t     *ent, *next;
+	sharedEntity_t *gEnt;
+	worldSector_t  *child;
+	vec3_t         size, mins1, maxs1, mins2, maxs2;
+	int            axis, count, crossing;
+	float          dist;
+
+	// try again once it got a lot more crowded
+	node->splitCount *= 2;
+
+	if (node->depth >= AREA_MAX_DEPTH || AREA_NODES - sv_numworldSectors + sv_numFreeWorldSectors < 2)
+	{
+		return;
+	}
+
+	VectorSubtract(node->maxs, node->mins, size);
+	axis = (size[0] > size[1]) ? 0 : 1;
+
+	if (size[axis] < 2 * AREA_MIN_SIZE)
+	{
+		return;
+	}
+
+	count = 0;
+	for (ent = node->entities ; ent ; ent = ent->nextEntityInWorldSector)
+	{
+		gEnt             = SV_GEntityForSvEntity(ent);
+		centers[count++] = 0.5f * (gEnt->r.absmin[axis] + gEnt->r.absmax[axis]);
+	}
+
+	qsort(centers, count, sizeof(centers[0]), SV_SortFloats);
+	dist = centers[count / 2];
+
+	// keep both halves reasonably sized
+	if (dist < node->mins[axis] + AREA_MIN_SIZE)
+	{
+		dist = node->mins[axis] + AREA_MIN_SIZE;
+	}
+	else if (dist > node->maxs[axis] - AREA_MIN_SIZE)
+	{
+		dist = node->maxs[axis] - AREA_MIN_SIZE;
+	}
+
+	// not worth it if most entities would stay here anyway
+	crossing = 0;
+	for (ent = node->entities ; ent ; ent = ent->nextEntityInWorldSector)
+	{
+		gEnt = SV_GEntityForSvEntity(ent);
+		if (gEnt->r.absmin[axis] <= dist && gEnt->r.absmax[axis] >= dist)
+		{
+			crossing++;
+		}
+	}
+
+	if (crossing * 2 > count)
+	{
+		return;
+	}
+
+	VectorCopy(node->mins, mins1);
+	VectorCopy(node->mins, mins2);
+	VectorCopy(node->maxs, maxs1);
+	VectorCopy(node->maxs, maxs2);
+
+	maxs1[axis] = mins2[axis] = dist;
+
+	node->axis        = axis;
+	node->dist        = dist;
+	node->children[0]         = SV_CreateworldSector(node->depth + 1, mins2, maxs2);
+	node->children[1]         = SV_CreateworldSector(node->depth + 1, mins1, maxs1);
+	node->children[0]->parent = node->children[1]->parent = node;
+
+	// move everything not crossing the split down
+	ent               = node->entities;
+	node->entities    = NULL;
+	node->numEntities = 0;
+
+	for ( ; ent ; ent = next)
+	{
+		next = ent->nextEntityInWorldSector;
+		gEnt = SV_GEntityForSvEntity(ent);
+
+		if (gEnt->r.absmin[axis] > dist)
+		{
+			child = node->children[0];
+		}
+		else if (gEnt->r.absmax[axis] < dist)
+		{
+			child = node->children[1];
+		}
+		else
+		{
+			child = node;
+		}
+
+		ent->worldSector             = child;
+		ent->nextEntityInWorldSector = child->entities;
+		child->entities              = ent;
+		child->numEntities++;
+	}
+}
+
+/**
+ * @brief Links an entity into the sector tree, its absmin and absmax have to be set
+ * @param[in,out] ent
+ * @param[in] gEnt
+ */
+static void SV_LinkEntityToSector(svEntity_t *ent, sharedEntity_t *gEnt)
+{
+	worldSector_t *node;
+
+	// find the first world sector node that the ent's box crosses
+	node = sv_worldSectors;
+	while (1)
+	{
+		if (node->axis == -1)
+		{
+			break;
+		}
+		if (gEnt->r.absmin[node->axis] > node->dist)
+		{
+			node = node->children[0];
+		}
+		else if (gEnt->r.absmax[node->axis] < node->dist)
+		{
+			node = node->children[1];
+		}
+		else
+		{
+			break;      // crosses the node
+		}
+	}
+
+	// link it in
+	ent->worldSector             = node;
+	ent->nextEntityInWorldSector = node->entities;
+	node->entities               = ent;
+	node->numEntities++;
+
+	if (node->axis == -1 && node->numEntities > node->splitCount && !sv_worldSectorsFixed)
+	{
+		SV_SplitWorldSector(node);
+	}
+}
+
 /**
  * @brief SV_ClearWorld
  */
@@ -164,7 +397,10 @@ void SV_ClearWorld(void)
 	vec3_t       mins, maxs;
 
 	Com_Memset(sv_worldSectors, 0, sizeof(sv_worldSectors));
-	sv_numworldSectors = 0;
+	sv_numworldSectors     = 0;
+	sv_freeWorldSectors    = NULL;
+	sv_numFreeWorldSectors = 0;
+	sv_worldSectorsFixed   = qfalse;
 
 	// get world map bounds
 	h = CM_InlineModel(0);
@@ -172,6 +408,66 @@ void SV_ClearWorld(void)
 	SV_CreateworldSector(0, mins, maxs);
 }
 
+/**
+ * @brief Throws away the sector tree and links all linked entities into a new one
+ * @param[in] fixed keep the initial uniform subdivision
+ */
+static void SV_RebuildWorldSectors(qboolean fixed)
+{
+	svEntity_t *ent;
+	int        e;
+
+	SV_ClearWorld();
+	sv_worldSectorsFixed = fixed;
+
+	for (e = 0 ; e < sv.num_entities ; e++)
+	{
+		ent = &sv.svEntities[e];
+
+		// old sector pointers are only checked for being set
+		if (!ent->worldSector)
+		{
+			continue;
+		}
+
+		SV_LinkEntityToSector(ent, SV_GentityNum(e));
+	}
+}
+
+/**
+ * @brief Turns splits made by SV_SplitWorldSector back into leafs once none
+ * of their sectors holds an entity anymore
+ * @param[in,out] node Sector an entity was just removed from
+ */
+static void SV_CollapseWorldSector(worldSector_t *node)
+{
+	// the uniform subdivision down to AREA_DEPTH stays
+	for ( ; node && node->depth >= AREA_DEPTH ; node = node->parent)
+	{
+		if (node->numEntities)
+		{
+			return;
+		}
+
+		if (node->axis == -1)
+		{
+			continue;
+		}
+
+		if (node->children[0]->axis != -1 || node->children[0]->numEntities
+		    || node->children[1]->axis != -1 || node->children[1]->numEntities)
+		{
+			return;
+		}
+
+		SV_FreeWorldSector(node->children[0]);
+		SV_FreeWorldSector(node->children[1]);
+
+		node->axis        = -1;
+		node->children[0] = node->children[1] = NULL;
+	}
+}
+
 /**
  * @brief SV_UnlinkEntity
  * @param[in,out] gEnt
@@ -192,10 +488,12 @@ void SV_UnlinkEntity(sharedEntity_t *gEnt)
 		return;     // not linked in anywhere
 	}
 	ent->worldSector = NULL;
+	ws->numEntities--;
 
 	if (ws->entities == ent)
 	{
 		ws->entities = ent->nextEntityInWorldSector;
+		SV_CollapseWorldSector(ws);
 		return;
 	}
 
@@ -204,6 +502,7 @@ void SV_UnlinkEntity(sharedEntity_t *gEnt)
 		if (scan->nextEntityInWorldSector == ent)
 		{
 			scan->nextEntityInWorldSector = ent->nextEntityInWorldSector;
+			SV_CollapseWorldSector(ws);
 			return;
 		}
 	}
@@ -219,15 +518,14 @@ void SV_UnlinkEntity(sharedEntity_t *gEnt)
  */
 void SV_LinkEntity(sharedEntity_t *gEnt)
 {
-	worldSector_t *node;
-	int           leafs[MAX_TOTAL_ENT_LEAFS];
-	int           cluster;
-	int           num_leafs;
-	int           i, j, k;
-	int           area;
-	int           lastLeaf;
-	float         *origin, *angles;
-	svEntity_t    *ent;
+	int        leafs[MAX_TOTAL_ENT_LEAFS];
+	int        cluster;
+	int        num_leafs;
+	int        i, j, k;
+	int        area;
+	int        lastLeaf;
+	float      *origin, *angles;
+	svEntity_t *ent;
 
 	ent = SV_SvEntityForGentity(gEnt);
 
@@ -401,32 +699,7 @@ void SV_LinkEntity(sharedEntity_t *gEnt)
 
 	gEnt->r.linkcount++;
 
-	// find the first world sector node that the ent's box crosses
-	node = sv_worldSectors;
-	while (1)
-	{
-		if (node->axis == -1)
-		{
-			break;
-		}
-		if (gEnt->r.absmin[node->axis] > node->dist)
-		{
-			node = node->children[0];
-		}
-		else if (gEnt->r.absmax[node->axis] < node->dist)
-		{
-			node = node->children[1];
-		}
-		else
-		{
-			break;      // crosses the node
-		}
-	}
-
-	// link it in
-	ent->worldSector             = node;
-	ent->nextEntityInWorldSector = node->entities;
-	node->entities               = ent;
+	SV_LinkEntityToSector(ent, gEnt);
 
 	gEnt->r.linked = qtrue;
 }
@@ -463,6 +736,7 @@ void SV_AreaEntities_r(worldSector_t *node, areaParms_t *ap)
 		next = check->nextEntityInWorldSector;
 
 		gcheck = SV_GEntityForSvEntity(check);
+		sv_areaEntitiesChecked++;
 
 		if (!gcheck->r.linked)
 		{
@@ -528,6 +802,86 @@ int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int *entityList, int m
 	return ap.count;
 }
 
+#define SECTORBENCH_RANGE 64    // grow the entity boxes by about a player move
+
+/**
+ * @brief Compares the SV_AreaEntities cost of the uniform and the adaptive sector tree,
+ * the boxes of all linked entities are used as queries
+ */
+void SV_SectorBench_f(void)
+{
+	static vec3_t  boxes[MAX_GENTITIES][2];
+	static int     list[MAX_GENTITIES];
+	sharedEntity_t *gEnt;
+	int            numBoxes = 0;
+	int            iterations, pass, i, j, e;
+	int64_t        start, usec;
+	double         numQueries, found;
+
+	if (!com_sv_running->integer || sv.state != SS_GAME)
+	{
+		Com_Printf("Server is not running.\n");
+		return;
+	}
+
+	iterations = (Cmd_Argc() > 1) ? Q_atoi(Cmd_Argv(1)) : 100;
+	if (iterations < 1)
+	{
+		iterations = 1;
+	}
+
+	for (e = 0 ; e < sv.num_entities ; e++)
+	{
+		gEnt = SV_GentityNum(e);
+
+		if (!gEnt->r.linked)
+		{
+			continue;
+		}
+
+		for (i = 0 ; i < 3 ; i++)
+		{
+			boxes[numBoxes][0][i] = gEnt->r.absmin[i] - SECTORBENCH_RANGE;
+			boxes[numBoxes][1][i] = gEnt->r.absmax[i] + SECTORBENCH_RANGE;
+		}
+		numBoxes++;
+	}
+
+	if (!numBoxes)
+	{
+		Com_Printf("No linked entities.\n");
+		return;
+	}
+
+	numQueries = (double)numBoxes * iterations;
+
+	Com_Printf("%i entities, %i iterations\n", numBoxes, iterations);
+
+	// the adaptive tree goes last, that's the one the server keeps using
+	for (pass = 0 ; pass < 2 ; pass++)
+	{
+		SV_RebuildWorldSectors(pass == 0);
+
+		sv_areaEntitiesChecked = 0;
+		found                  = 0.0;
+		start                  = Sys_Microseconds();
+
+		for (i = 0 ; i < iterations ; i++)
+		{
+			for (j = 0 ; j < numBoxes ; j++)
+			{
+				found += SV_AreaEntities(boxes[j][0], boxes[j][1], list, MAX_GENTITIES);
+			}
+		}
+
+		usec = Sys_Microseconds() - start;
+
+		Com_Printf("%-8s: %4i sectors, %.3f usec/query, %.1f entities tested/query, %.1f found/query\n",
+		           pass ? "adaptive" : "uniform", sv_numworldSectors - sv_numFreeWorldSectors, usec / numQueries,
+		           sv_areaEntitiesChecked / numQueries, found / numQueries);
+	}
+}
+
 //===========================================================================
 
 typedef struct
@@ -716,7 +716,9 @@ NORETURN_MSVC void QDECL G_Error(const char *fmt, ...) _attribute((noreturn, for
 
 // extension interface
 qboolean trap_GetValue(char *value, int valueSize, const char *key);
+int trap_Cvar_GetModified(int *sequence, int *handles, int maxHandles);
 extern int dll_com_trapGetValue;
+extern int dll_trap_Cvar_GetModified;
 
 qboolean trap_TVG_GetPlayerstate(int clientNum, playerState_t *ps);
 
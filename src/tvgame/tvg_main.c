@@ -237,6 +237,7 @@ qboolean TVG_SnapshotCallback(int entityNum, int clientNum)
 }
 
 int dll_com_trapGetValue;
+int dll_trap_Cvar_GetModified;
 
 /**
  * @brief This is the only way control passes into the module.
@@ -389,6 +390,9 @@ qboolean TVG_ServerIsFloodProtected(void)
 	return (!tvg_floodProtection.integer || !tvg_floodWait.integer || !tvg_floodLimit.integer) ? qfalse : qtrue;
 }
 
+/// position in the engine cvar change log, -1 updates the whole gameCvarTable
+static int cvarChangeSequence = -1;
+
 /**
  * @brief TVG_RegisterCvars
  */
@@ -397,6 +401,8 @@ void TVG_RegisterCvars(void)
 	int           i;
 	tvcvarTable_t *cv;
 
+	cvarChangeSequence = -1;
+
 	G_Printf("%d cvars in use\n", gameCvarTableSize);
 
 	for (i = 0, cv = gameCvarTable; i < gameCvarTableSize; i++, cv++)
@@ -416,10 +422,19 @@ void TVG_UpdateCvars(void)
 {
 	int           i;
 	tvcvarTable_t *cv;
+	int           changed[MAX_CVAR_CHANGES];
+	int           numChanged;
+
+	// only look at the cvars changed since the last call
+	numChanged = trap_Cvar_GetModified(&cvarChangeSequence, changed, MAX_CVAR_CHANGES);
+	if (!numChanged)
+	{
+		return;
+	}
 
 	for (i = 0, cv = gameCvarTable ; i < gameCvarTableSize ; i++, cv++)
 	{
-		if (cv->vmCvar)
+		if (cv->vmCvar && Com_CvarModified(cv->vmCvar, changed, numChanged))
 		{
 			trap_Cvar_Update(cv->vmCvar);
 
@@ -462,6 +477,8 @@ static ID_INLINE void TVG_SetupExtensions(void)
 	if (value[0])
 	{
 		dll_com_trapGetValue = Q_atoi(value);
+
+		TVG_SetupExtensionTrap(value, MAX_CVAR_VALUE_STRING, &dll_trap_Cvar_GetModified, "trap_Cvar_GetModified_Legacy");
 	}
 }
 
@@ -821,3 +821,21 @@ qboolean trap_TVG_GetPlayerstate(int clientNum, playerState_t *ps)
 {
 	return (qboolean)SystemCall(TVG_GET_PLAYERSTATE, clientNum, ps);
 }
+
+/**
+* @brief Extension for listing the cvars changed since the last call,
+*        so that not every registered cvar has to be updated each frame
+* @param[in,out] sequence
+* @param[out] handles
+* @param[in] maxHandles
+* @return Number of changed cvar handles, -1 if all cvars have to be updated
+*/
+int trap_Cvar_GetModified(int *sequence, int *handles, int maxHandles)
+{
+	if (dll_trap_Cvar_GetModified)
+	{
+		return (int)SystemCall(dll_trap_Cvar_GetModified, sequence, handles, maxHandles);
+	}
+
+	return -1;
+}